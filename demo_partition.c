@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "segy.h"
+#include "segy_part.h"
+
+#define NRANKS 4
+
+// one rank: copy its gathers of output.segy to the shared file
+static int run_rank(int rank, const char* inname, const char* outname) {
+  FILE* fin = fopen(inname, "rb");
+  segyfile segyin = segyfile_init_read(fin);
+
+  // no fldr gather is split between ranks
+  segy_range range = segyfile_partition(segyin, rank, NRANKS, SEGY_PART_GATHER);
+  printf("rank %d: traces %zu to %zu\n", rank, range.itr0, range.itr0 + range.ntrace);
+
+  FILE* fout = segyfile_fopen_shared(outname);
+  segyfile segyout = segyfile_init_collective(fout, rank, segyin->ns, segyin->dt,
+                                              segyin->format, segyin->ntrace);
+  if (0 == rank) {
+    // only rank 0 writes the text and binary headers
+    memcpy(segyout->textraw, segyin->textraw, SEGY_EBCBYTES);
+    segywrite_texthead(segyout, 0, 0);
+    segywrite_binaryhead(segyout);
+  }
+
+  size_t n = range.ntrace;
+  int* theads = (int*)malloc(sizeof(int) * SEGY_THNKEYS * (n + 1));
+  float* traces = (float*)malloc(sizeof(float) * segyin->ns * (n + 1));
+  size_t* idx = (size_t*)malloc(sizeof(size_t) * (n + 1));
+  for (size_t i = 0; i < n; i++)
+    idx[i] = range.itr0 + i;
+  segyread_tracelist(segyin, idx, n, theads, traces, 1);
+  size_t nw = segywrite_tracerange(segyout, range.itr0, theads, traces, n);
+
+  free(idx);
+  free(traces);
+  free(theads);
+  segyfile_free(segyout);
+  segyfile_free(segyin);
+  fclose(fout);
+  fclose(fin);
+  return nw == n ? 0 : 1;
+}
+
+int main() {
+  const char* inname = "output.segy";  // written by demo_write
+  const char* outname = "partition.segy";
+  remove(outname);
+
+  for (int rank = 0; rank < NRANKS; rank++) {
+    if (0 == fork())
+      exit(run_rank(rank, inname, outname));
+  }
+  int failed = 0;
+  for (int rank = 0; rank < NRANKS; rank++) {
+    int status;
+    wait(&status);
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+  }
+
+  // check the shared output against the input
+  FILE* fin = fopen(inname, "rb");
+  FILE* fout = fopen(outname, "rb");
+  segyfile segyin = segyfile_init_read(fin);
+  segyfile segyout = segyfile_init_read(fout);
+  float* a = (float*)malloc(sizeof(float) * segyin->ns);
+  float* b = (float*)malloc(sizeof(float) * segyin->ns);
+  int ha[SEGY_THNKEYS], hb[SEGY_THNKEYS];
+  size_t nbad = segyin->ntrace != segyout->ntrace;
+  for (size_t i = 0; i < segyin->ntrace && !nbad; i++) {
+    segyread_onetrace(segyin, ha, a);
+    segyread_onetrace(segyout, hb, b);
+    if (memcmp(ha, hb, sizeof(ha)))
+      nbad++;
+    if (memcmp(a, b, sizeof(float) * segyin->ns))
+      nbad++;
+  }
+  warninginfo("%d ranks wrote %zu traces to %s, %zu mismatches", NRANKS,
+              segyout->ntrace, outname, nbad);
+  free(a);
+  free(b);
+  segyfile_free(segyin);
+  segyfile_free(segyout);
+  fclose(fin);
+  fclose(fout);
+  return failed || nbad;
+}
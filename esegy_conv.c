@@ -0,0 +1,150 @@
+/* esegy_conv: convert SEGY to headerless float32 or Seismic Unix files and back
+
+usage: esegy_conv in=file.segy out=file.bin [to=raw] [heads=file.heads] [keys=fldr,tracf]
+       esegy_conv in=file.segy out=file.su to=su
+       esegy_conv in=file.bin out=file.segy from=raw ns=1500 dt=0.002 [heads=] [keys=]
+       esegy_conv in=file.su out=file.segy from=su [format=5] [quant=trwf]
+       esegy_conv in=file.segy inplace=5 [marker=file.segy.conv]
+       [nthreads=0]
+
+raw files hold little-endian float32 samples, ns per trace; heads= is a table of
+little-endian int32 rows of keys= per trace, all trace header keys when keys= is empty;
+SU files hold native-endian 240 bytes headers and float32 samples; format= is the
+sample format of a SEGY output (1 IBM, 2 int4, 3 int2, 5 IEEE, 8 int1); quant= names
+the header key of the per-trace scale exponent of integer samples, the SEGY side is
+quantized on output and rescaled on input;
+inplace= converts the samples of in between IBM (1) and IEEE (5) without a copy, a
+run that stopped continues from the marker when started again
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segy.h"
+#include "segy_conv.h"
+#include "segy_io.h"
+
+static int conv_kind(const char* s) {
+  if (!strcmp(s, "raw"))
+    return SEGY_CONV_RAW;
+  if (!strcmp(s, "su"))
+    return SEGY_CONV_SU;
+  if (!strcmp(s, "segy"))
+    return -1;
+  errorinfo("unknown file kind %s, expected segy, raw or su", s);
+  return -1;
+}
+
+/* comma separated key names, return their number */
+static int parse_keys(char* s, int* keys) {
+  int n = 0;
+  for (char* k = strtok(s, ","); k; k = strtok(NULL, ","))
+    if (n < SEGY_THNKEYS)
+      keys[n++] = segykey(k);
+  return n;
+}
+
+int main(int argc, char** argv) {
+  const char* in = NULL;
+  const char* out = NULL;
+  const char* hpath = NULL;
+  const char* marker = NULL;
+  int from = -1, to = -2, nthreads = 0, ns = 0, format = 5, nkey = 0, inplace = 0;
+  int qkey = -1;
+  float dt = 0;
+  int keys[SEGY_THNKEYS];
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    char* val = eq + 1;
+
+    if (!strcmp(key, "in"))
+      in = val;
+    else if (!strcmp(key, "out"))
+      out = val;
+    else if (!strcmp(key, "from"))
+      from = conv_kind(val);
+    else if (!strcmp(key, "to"))
+      to = conv_kind(val);
+    else if (!strcmp(key, "heads"))
+      hpath = val;
+    else if (!strcmp(key, "keys"))
+      nkey = parse_keys(val, keys);
+    else if (!strcmp(key, "ns"))
+      ns = atoi(val);
+    else if (!strcmp(key, "dt"))
+      dt = (float)atof(val);
+    else if (!strcmp(key, "format"))
+      format = atoi(val);
+    else if (!strcmp(key, "quant"))
+      qkey = segykey(val);
+    else if (!strcmp(key, "inplace"))
+      inplace = atoi(val);
+    else if (!strcmp(key, "marker"))
+      marker = val;
+    else if (!strcmp(key, "nthreads"))
+      nthreads = atoi(val);
+    else
+      errorinfo("unknown argument %s", key);
+  }
+  if (in && inplace) {
+    if (!segyconv_inplace(in, inplace, marker, nthreads))
+      errorinfo("conversion of %s stopped, run again to resume", in);
+    warninginfo("%s is in format %d", in, inplace);
+    return 0;
+  }
+  if (!in || !out)
+    errorinfo("usage: esegy_conv in= out= [from=segy|raw|su] [to=raw|su|segy] [heads=] "
+              "[keys=] [ns=] [dt=] [format=5] [quant=] [inplace=1|5] [marker=] [nthreads=0]");
+  if (-2 == to)
+    to = from < 0 ? SEGY_CONV_RAW : -1;
+  if ((from < 0) == (to < 0))
+    errorinfo("one of from= and to= must be segy");
+
+  segy_io* iio = segyio_open(in, "r");
+  segy_io* oio = segyio_open(out, "w");
+  segy_io* hio = NULL;
+  if (!iio || !oio)
+    return 1;
+
+  size_t n, want;
+  if (from < 0) {
+    if (hpath && !(hio = segyio_open(hpath, "w")))
+      return 1;
+    segyfile segyf = segyfile_init_read_io(iio);
+    segyfile_set_quantize(segyf, qkey);
+    n = segyconv_export(segyf, oio, to, hio, nkey ? keys : NULL, nkey, nthreads);
+    want = segyf->ntrace;
+    warninginfo("converted %zu of %zu traces to %s", n, want, out);
+    segyfile_free(segyf);
+    segyio_close(oio);
+  } else {
+    if (SEGY_CONV_SU == from) {
+      int suns;
+      float sudt;
+      if (!segyconv_su_info(iio, &suns, &sudt))
+        errorinfo("%s has no SU trace header with ns", in);
+      ns = ns > 0 ? ns : suns;
+      dt = dt > 0 ? dt : sudt;
+    } else if (hpath && !(hio = segyio_open(hpath, "r"))) {
+      return 1;
+    }
+    if (ns <= 0 || dt <= 0)
+      errorinfo("ns= and dt= are needed to convert a raw file");
+    segyfile segyf = segyfile_init_write_io(oio, ns, dt, format, 0);
+    segyfile_set_quantize(segyf, qkey);
+    /* the complete input records, as counted by segyconv_import */
+    int64_t size = segyio_size(iio);
+    want = size > 0 ? (size_t)size / ((SEGY_CONV_SU == from ? SEGY_THNBYTES : 0) + 4 * (size_t)ns)
+                    : 0;
+    n = segyconv_import(iio, from, hio, nkey ? keys : NULL, nkey, segyf, nthreads);
+    warninginfo("converted %zu of %zu traces to %s", n, want, out);
+    segyfile_free(segyf);
+    segyio_close(iio);
+  }
+  segyio_close(hio);
+  return n == want ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/* esegy_diff: compare two SEGY files
+
+usage: esegy_diff a=file1.segy b=file2.segy [atol=0] [rtol=0] [keys=all] [ignore=]
+                  [quant=] [max=20] [nthreads=0]
+
+samples differ when |a - b| > atol + rtol * max(|a|, |b|); keys= is a comma list of
+the trace header keys compared (all by default) and ignore= a list taken out of it,
+e.g. ignore=tracl,tracr for renumbered files; quant=trwf rescales the integer samples
+of a file quantized with that exponent key; the first max= differences are printed
+in trace order, then the summary; the exit status is 0 when the files are the same
+within the tolerances, 1 when they differ and 2 when a read failed
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segy.h"
+#include "segy_diff.h"
+
+/* set mask of the keys in a comma list to v */
+static void mask_keys(char* mask, char* list, char v) {
+  for (char* k = strtok(list, ","); k; k = strtok(NULL, ","))
+    mask[segykey(k)] = v;
+}
+
+int main(int argc, char** argv) {
+  const char* fa = NULL;
+  const char* fb = NULL;
+  char* keys = NULL;
+  char* ignore = NULL;
+  int qkey = -1;
+  segy_diff_opts o;
+  segydiff_opts_init(&o);
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    char* val = eq + 1;
+
+    if (!strcmp(key, "a"))
+      fa = val;
+    else if (!strcmp(key, "b"))
+      fb = val;
+    else if (!strcmp(key, "atol"))
+      o.atol = atof(val);
+    else if (!strcmp(key, "rtol"))
+      o.rtol = atof(val);
+    else if (!strcmp(key, "keys"))
+      keys = val;
+    else if (!strcmp(key, "ignore"))
+      ignore = val;
+    else if (!strcmp(key, "quant"))
+      qkey = segykey(val);
+    else if (!strcmp(key, "max"))
+      o.maxreport = (size_t)atol(val);
+    else if (!strcmp(key, "nthreads"))
+      o.nthreads = atoi(val);
+    else
+      errorinfo("unknown argument %s", key);
+  }
+  if (!fa || !fb)
+    errorinfo("usage: esegy_diff a=file1.segy b=file2.segy [atol=0] [rtol=0] [keys=all] "
+              "[ignore=] [quant=] [max=20] [nthreads=0]");
+  if (keys && strcmp(keys, "all")) {
+    memset(o.keymask, 0, sizeof(o.keymask));
+    mask_keys(o.keymask, keys, 1);
+  }
+  if (ignore)
+    mask_keys(o.keymask, ignore, 0);
+
+  FILE* fpa = fopen(fa, "rb");
+  if (!fpa)
+    errorinfo("cannot open %s", fa);
+  FILE* fpb = fopen(fb, "rb");
+  if (!fpb)
+    errorinfo("cannot open %s", fb);
+  segyfile a = segyfile_init_read(fpa);
+  segyfile b = segyfile_init_read(fpb);
+  if (qkey >= 0 && 1 != a->format && 5 != a->format)
+    segyfile_set_quantize(a, qkey);
+  if (qkey >= 0 && 1 != b->format && 5 != b->format)
+    segyfile_set_quantize(b, qkey);
+  segy_diff* d = segydiff_run(a, b, &o);
+  segydiff_print(d, stdout);
+  int same = segydiff_same(d);
+  int failed = d->failed;
+  printf("%s\n", failed ? "failed" : same ? "same" : "different");
+
+  segydiff_free(d);
+  segyfile_free(a);
+  segyfile_free(b);
+  fclose(fpa);
+  fclose(fpb);
+  return failed ? 2 : same ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/* esegy_fold: fold map of a SEGY file from its trace headers
+
+usage: esegy_fold in=file.segy [bin=lines|cdpxy] [ikey=iline] [xkey=xline]
+                  [x0=0] [y0=0] [dx=] [dy=] [angle=0] [nx=0] [ny=0]
+                  [noff=0] [off0=0] [doff=] [naz=0] [out=fold.bin] [nthreads=0]
+
+bin=lines counts the traces of every (ikey, xkey) pair, xkey=- for a 2D line;
+bin=cdpxy bins cdpx, cdpy on a grid from corner (x0, y0), rotated by angle degrees;
+nx=0 or ny=0 grows the grid to cover every trace; noff and naz split the map by
+|offset| class and source to receiver azimuth; out= gets the fold as little-endian
+uint32, x fastest, then y, offset class and azimuth sector
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segy.h"
+#include "segy_fold.h"
+
+int main(int argc, char** argv) {
+  const char* in = NULL;
+  const char* out = NULL;
+  int nthreads = 0;
+  segy_fold_grid g;
+  segyfold_grid_init(&g, SEGY_FOLD_LINES);
+  double dx = 0, dy = 0;
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    char* val = eq + 1;
+
+    if (!strcmp(key, "in"))
+      in = val;
+    else if (!strcmp(key, "out"))
+      out = val;
+    else if (!strcmp(key, "bin")) {
+      if (!strcmp(val, "lines"))
+        g.mode = SEGY_FOLD_LINES;
+      else if (!strcmp(val, "cdpxy"))
+        g.mode = SEGY_FOLD_CDPXY;
+      else
+        errorinfo("unknown bin=%s, expected lines or cdpxy", val);
+    } else if (!strcmp(key, "ikey"))
+      g.ikey = segykey(val);
+    else if (!strcmp(key, "xkey"))
+      g.xkey = strcmp(val, "-") ? segykey(val) : -1;
+    else if (!strcmp(key, "x0"))
+      g.x0 = atof(val);
+    else if (!strcmp(key, "y0"))
+      g.y0 = atof(val);
+    else if (!strcmp(key, "dx"))
+      dx = atof(val);
+    else if (!strcmp(key, "dy"))
+      dy = atof(val);
+    else if (!strcmp(key, "angle"))
+      g.angle = atof(val);
+    else if (!strcmp(key, "nx"))
+      g.nx = atoi(val);
+    else if (!strcmp(key, "ny"))
+      g.ny = atoi(val);
+    else if (!strcmp(key, "noff"))
+      g.noff = atoi(val);
+    else if (!strcmp(key, "off0"))
+      g.off0 = atof(val);
+    else if (!strcmp(key, "doff"))
+      g.doff = atof(val);
+    else if (!strcmp(key, "naz"))
+      g.naz = atoi(val);
+    else if (!strcmp(key, "nthreads"))
+      nthreads = atoi(val);
+    else
+      errorinfo("unknown argument %s", key);
+  }
+  if (!in)
+    errorinfo("usage: esegy_fold in=file.segy [bin=lines|cdpxy] [ikey=iline] [xkey=xline] "
+              "[x0=] [y0=] [dx=] [dy=] [angle=] [nx=] [ny=] [noff=] [off0=] [doff=] [naz=] "
+              "[out=] [nthreads=0]");
+  g.dx = dx > 0 ? dx : SEGY_FOLD_LINES == g.mode ? 1 : 25;
+  g.dy = dy > 0 ? dy : SEGY_FOLD_LINES == g.mode ? 1 : g.dx;
+
+  FILE* fp = fopen(in, "rb");
+  if (!fp)
+    errorinfo("cannot open %s", in);
+  segyfile segyf = segyfile_init_read(fp);
+  segy_fold* f = segyfold_run(segyf, &g, nthreads);
+  if (f->ntrace != segyf->ntrace)
+    errorinfo("cannot read every trace header of %s", in);
+  segyfold_print(f, stdout);
+  if (out && segyfold_save_raw(f, out))
+    printf("fold written to %s: %d x %d x %d x %d\n", out, f->g.nx, f->g.ny, f->noff, f->naz);
+
+  segyfold_free(f);
+  segyfile_free(segyf);
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,119 @@
+/* esegy_gen: write a synthetic SEGY file for benchmarks and scale tests
+
+usage: esegy_gen out=file.segy [geometry=2d|3d|shot2d|cdp3d] [ns=1000] [dt=0.002]
+                 [format=5] [quant=] [ncdp=] [nil=] [nxl=] [il0=] [xl0=] [nshot=] [nchan=]
+                 [dx=] [dy=] [dshot=] [offset0=] [doffset=] [vel=] [nevent=]
+                 [noise=] [dead=0] [short=0] [seed=] [nthreads=0] [chunk=1024]
+
+quant=trwf (or another header key) with format=2, 3 or 8 stores every trace rounded
+to the largest power of two scale its peak allows, the exponent in that key
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "segy.h"
+#include "segy_gen.h"
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+int main(int argc, char** argv) {
+  segygen_opt opt;
+  segygen_default(&opt);
+  const char* out = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    const char* val = eq + 1;
+
+    if (!strcmp(key, "out")) {
+      out = val;
+    } else if (!strcmp(key, "geometry")) {
+      if (!strcmp(val, "2d"))
+        opt.geometry = SEGYGEN_2D;
+      else if (!strcmp(val, "3d"))
+        opt.geometry = SEGYGEN_3D;
+      else if (!strcmp(val, "shot2d"))
+        opt.geometry = SEGYGEN_SHOT2D;
+      else if (!strcmp(val, "cdp3d"))
+        opt.geometry = SEGYGEN_CDP3D;
+      else
+        errorinfo("unknown geometry %s", val);
+    } else if (!strcmp(key, "ns")) {
+      opt.ns = atoi(val);
+    } else if (!strcmp(key, "dt")) {
+      opt.dt = atof(val);
+    } else if (!strcmp(key, "format")) {
+      opt.format = atoi(val);
+    } else if (!strcmp(key, "quant")) {
+      opt.qkey = segykey(val);
+    } else if (!strcmp(key, "ncdp")) {
+      opt.ncdp = atoi(val);
+    } else if (!strcmp(key, "nil")) {
+      opt.nil = atoi(val);
+    } else if (!strcmp(key, "nxl")) {
+      opt.nxl = atoi(val);
+    } else if (!strcmp(key, "il0")) {
+      opt.il0 = atoi(val);
+    } else if (!strcmp(key, "xl0")) {
+      opt.xl0 = atoi(val);
+    } else if (!strcmp(key, "nshot")) {
+      opt.nshot = atoi(val);
+    } else if (!strcmp(key, "nchan")) {
+      opt.nchan = atoi(val);
+    } else if (!strcmp(key, "dx")) {
+      opt.dx = atof(val);
+    } else if (!strcmp(key, "dy")) {
+      opt.dy = atof(val);
+    } else if (!strcmp(key, "dshot")) {
+      opt.dshot = atof(val);
+    } else if (!strcmp(key, "offset0")) {
+      opt.offset0 = atof(val);
+    } else if (!strcmp(key, "doffset")) {
+      opt.doffset = atof(val);
+    } else if (!strcmp(key, "vel")) {
+      opt.vel = atof(val);
+    } else if (!strcmp(key, "nevent")) {
+      opt.nevent = atoi(val);
+    } else if (!strcmp(key, "noise")) {
+      opt.noise = atof(val);
+    } else if (!strcmp(key, "dead")) {
+      opt.dead_ratio = atof(val);
+    } else if (!strcmp(key, "short")) {
+      opt.short_ratio = atof(val);
+    } else if (!strcmp(key, "seed")) {
+      opt.seed = strtoull(val, NULL, 10);
+    } else if (!strcmp(key, "nthreads")) {
+      opt.nthreads = atoi(val);
+    } else if (!strcmp(key, "chunk")) {
+      opt.chunk = (size_t)atol(val);
+    } else {
+      errorinfo("unknown parameter %s", key);
+    }
+  }
+  if (!out)
+    errorinfo("usage: esegy_gen out=file.segy [key=value ...]");
+
+  FILE* fp = fopen(out, "wb");
+  if (!fp)
+    errorinfo("cannot open %s", out);
+
+  double t0 = now();
+  size_t ntrace = segygen_write(fp, &opt);
+  if (fclose(fp))
+    errorinfo("error closing %s", out);
+  double sec = now() - t0;
+
+  double bytes = 3600.0 + (double)ntrace * (240.0 + opt.ns * (3 == opt.format ? 2 : 8 == opt.format ? 1 : 4));
+  warninginfo("wrote %zu traces (%.1f MB) to %s in %.2f s, %.1f MB/s", ntrace,
+              bytes / 1e6, out, sec, sec > 0 ? bytes / 1e6 / sec : 0.0);
+  return 0;
+}
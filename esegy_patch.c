@@ -0,0 +1,79 @@
+/* esegy_patch: update trace headers in place
+
+usage: esegy_patch in=file.segy set="offset = gx - sx; scalco = -100"
+                   [lut=name:table.txt[:missing] ...] [dryrun=0] [mmap=0] [nthreads=0]
+
+a table file has "key value" lines and is used as lut(name, x) in set=
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segy.h"
+#include "segy_expr.h"
+#include "segy_patch.h"
+
+#define MAXLUT 16
+
+int main(int argc, char** argv) {
+  const char* in = NULL;
+  const char* set = NULL;
+  int flags = 0, nthreads = 0, nlut = 0;
+  segy_lut* luts[MAXLUT];
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    char* val = eq + 1;
+
+    if (!strcmp(key, "in")) {
+      in = val;
+    } else if (!strcmp(key, "set")) {
+      set = val;
+    } else if (!strcmp(key, "lut")) {
+      char* path = strchr(val, ':');
+      if (!path || nlut == MAXLUT)
+        errorinfo("lut=name:table.txt[:missing], at most %d tables", MAXLUT);
+      *path++ = '\0';
+      char* missing = strchr(path, ':');
+      if (missing)
+        *missing++ = '\0';
+      luts[nlut] = segylut_load(val, path, missing ? atoll(missing) : 0);
+      if (!luts[nlut])
+        errorinfo("cannot read table %s", path);
+      nlut++;
+    } else if (!strcmp(key, "dryrun")) {
+      flags |= atoi(val) ? SEGY_PATCH_DRYRUN : 0;
+    } else if (!strcmp(key, "mmap")) {
+      flags |= atoi(val) ? SEGY_PATCH_MMAP : 0;
+    } else if (!strcmp(key, "nthreads")) {
+      nthreads = atoi(val);
+    } else {
+      errorinfo("unknown argument %s", key);
+    }
+  }
+  if (!in || !set)
+    errorinfo("usage: esegy_patch in=file.segy set=\"key = expression; ...\"");
+
+  segy_patch* p = segypatch_parse(set, luts, nlut);
+  if (!p)
+    errorinfo("cannot compile %s", set);
+  FILE* fp = fopen(in, (flags & SEGY_PATCH_DRYRUN) ? "rb" : "r+b");
+  if (!fp)
+    errorinfo("cannot open %s", in);
+  segyfile segyf = segyfile_init_read(fp);
+
+  segy_patch_result r;
+  int ok = segypatch_apply(segyf, p, flags, nthreads, &r);
+  printf("%llu headers, %llu %s\n", (unsigned long long)r.nscan,
+         (unsigned long long)r.nchanged, (flags & SEGY_PATCH_DRYRUN) ? "would change" : "changed");
+
+  segyfile_free(segyf);
+  fclose(fp);
+  segypatch_free(p);
+  for (int i = 0; i < nlut; i++)
+    segylut_free(luts[i]);
+  return !ok;
+}
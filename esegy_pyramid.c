@@ -0,0 +1,85 @@
+/* esegy_pyramid: build the multi-resolution overview pyramid of a SEGY file
+
+usage: esegy_pyramid in=file.segy [out=file.segy.pyr] [ikey=iline] [xkey=xline]
+                     [di=1] [dx=1] [nlevel=0] [mem=256] [quant=] [nthreads=0]
+
+without ikey= (or ikey=-) the file is a 2D line in trace order; ikey alone (xkey=-)
+gives one cell per ikey value; every level halves the samples and the spatial axes
+of the one below; nlevel=0 adds levels until the larger spatial size is at most 512;
+mem= is the slab budget in MB; quant=trwf rescales the integer samples of a file
+quantized with that exponent key; the levels of the sidecar are printed at the end
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segy.h"
+#include "segy_pyramid.h"
+
+int main(int argc, char** argv) {
+  const char* in = NULL;
+  const char* out = NULL;
+  int qkey = -1;
+  segy_pyr_opts o;
+  segypyr_opts_init(&o);
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    char* val = eq + 1;
+
+    if (!strcmp(key, "in"))
+      in = val;
+    else if (!strcmp(key, "out"))
+      out = val;
+    else if (!strcmp(key, "ikey"))
+      o.ikey = strcmp(val, "-") ? segykey(val) : -1;
+    else if (!strcmp(key, "xkey"))
+      o.xkey = strcmp(val, "-") ? segykey(val) : -1;
+    else if (!strcmp(key, "di"))
+      o.di = atoi(val);
+    else if (!strcmp(key, "dx"))
+      o.dx = atoi(val);
+    else if (!strcmp(key, "nlevel"))
+      o.nlevel = atoi(val);
+    else if (!strcmp(key, "mem"))
+      o.membudget = (size_t)atol(val) << 20;
+    else if (!strcmp(key, "quant"))
+      qkey = segykey(val);
+    else if (!strcmp(key, "nthreads"))
+      o.nthreads = atoi(val);
+    else
+      errorinfo("unknown argument %s", key);
+  }
+  if (!in)
+    errorinfo("usage: esegy_pyramid in=file.segy [out=file.segy.pyr] [ikey=iline] "
+              "[xkey=xline] [di=1] [dx=1] [nlevel=0] [mem=256] [quant=] [nthreads=0]");
+  if (o.ikey < 0)
+    o.xkey = -1;
+
+  char path[4096];
+  if (!out) {
+    snprintf(path, sizeof(path), "%s.pyr", in);
+    out = path;
+  }
+  FILE* fp = fopen(in, "rb");
+  if (!fp)
+    errorinfo("cannot open %s", in);
+  segyfile segyf = segyfile_init_read(fp);
+  if (qkey >= 0 && 1 != segyf->format && 5 != segyf->format)
+    segyfile_set_quantize(segyf, qkey);
+  if (!segypyr_build(segyf, out, &o))
+    errorinfo("cannot build the pyramid of %s", in);
+  segy_pyramid* p = segypyr_open(out, segyf);
+  if (!p)
+    errorinfo("cannot open the pyramid %s", out);
+  printf("%s\n", out);
+  segypyr_print(p, stdout);
+
+  segypyr_free(p);
+  segyfile_free(segyf);
+  fclose(fp);
+  return 0;
+}
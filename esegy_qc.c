@@ -0,0 +1,73 @@
+/* esegy_qc: amplitude statistics and QC report of a SEGY file
+
+usage: esegy_qc in=file.segy [qc=file.segy.qc] [quant=] [nthreads=0] [force=0]
+
+the per-trace statistics are kept in the qc sidecar, a later run reuses it
+without reading the samples unless force=1 or the file has changed; quant=trwf
+rescales the integer samples of a file quantized with that exponent key
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segy.h"
+#include "segy_qc.h"
+
+int main(int argc, char** argv) {
+  const char* in = NULL;
+  const char* side = NULL;
+  int nthreads = 0, force = 0, qkey = -1;
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    const char* val = eq + 1;
+
+    if (!strcmp(key, "in"))
+      in = val;
+    else if (!strcmp(key, "qc"))
+      side = val;
+    else if (!strcmp(key, "quant"))
+      qkey = segykey(val);
+    else if (!strcmp(key, "nthreads"))
+      nthreads = atoi(val);
+    else if (!strcmp(key, "force"))
+      force = atoi(val);
+    else
+      errorinfo("unknown argument %s", key);
+  }
+  if (!in)
+    errorinfo("usage: esegy_qc in=file.segy [qc=file.segy.qc] [quant=] [nthreads=0] "
+              "[force=0]");
+
+  char defside[4096];
+  if (!side) {
+    snprintf(defside, sizeof(defside), "%s.qc", in);
+    side = defside;
+  }
+
+  FILE* fp = fopen(in, "rb");
+  if (!fp)
+    errorinfo("cannot open %s", in);
+  segyfile segyf = segyfile_init_read(fp);
+  if (qkey >= 0 && 1 != segyf->format && 5 != segyf->format)
+    segyfile_set_quantize(segyf, qkey);
+
+  segy_qc* qc = force ? NULL : segyqc_load(side, segyf);
+  if (qc) {
+    printf("statistics from %s\n", side);
+  } else {
+    qc = segyqc_run(segyf, nthreads);
+    if (!qc)
+      errorinfo("cannot compute the statistics of %s", in);
+    segyqc_save(qc, segyf, side);
+  }
+  segyqc_print(qc, stdout);
+
+  segyqc_free(qc);
+  segyfile_free(segyf);
+  fclose(fp);
+  return 0;
+}
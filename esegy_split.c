@@ -0,0 +1,67 @@
+/* esegy_split: split a SEGY file into one file per value or class of a header key
+
+usage: esegy_split in=file.segy key=fldr [out=shot_%d.segy] [width=0] [origin=0]
+                   [mem=256] [maxopen=64] [nthreads=0]
+
+width > 0 makes classes floor((value - origin) / width) of the key, e.g. offset
+classes with key=offset width=500; the first %d of out= (or %05d ...) is replaced by
+the value or class; mem= is the buffer budget in MB; records are copied undecoded
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "segy.h"
+#include "segy_split.h"
+
+int main(int argc, char** argv) {
+  const char* in = NULL;
+  segy_split_opts o;
+  segysplit_opts_init(&o, -1);
+
+  for (int i = 1; i < argc; i++) {
+    char* eq = strchr(argv[i], '=');
+    if (!eq)
+      errorinfo("argument %s is not key=value", argv[i]);
+    *eq = '\0';
+    const char* key = argv[i];
+    char* val = eq + 1;
+
+    if (!strcmp(key, "in"))
+      in = val;
+    else if (!strcmp(key, "key"))
+      o.key = segykey(val);
+    else if (!strcmp(key, "out"))
+      o.path = val;
+    else if (!strcmp(key, "width"))
+      o.width = atof(val);
+    else if (!strcmp(key, "origin"))
+      o.origin = atof(val);
+    else if (!strcmp(key, "mem"))
+      o.membudget = (size_t)atol(val) << 20;
+    else if (!strcmp(key, "maxopen"))
+      o.maxopen = atoi(val);
+    else if (!strcmp(key, "nthreads"))
+      o.nthreads = atoi(val);
+    else
+      errorinfo("unknown argument %s", key);
+  }
+  if (!in || o.key < 0)
+    errorinfo("usage: esegy_split in=file.segy key=fldr [out=shot_%%d.segy] [width=0] "
+              "[origin=0] [mem=256] [maxopen=64] [nthreads=0]");
+
+  FILE* fp = fopen(in, "rb");
+  if (!fp)
+    errorinfo("cannot open %s", in);
+  segyfile segyf = segyfile_init_read(fp);
+  segy_split* s = segysplit_run(segyf, &o);
+  for (size_t i = 0; i < s->nout; i++)
+    printf("%s %zu\n", s->out[i].path, s->out[i].ntrace);
+  printf("%zu traces to %zu files, %llu writes, %llu opens\n", s->ntrace, s->nout,
+         (unsigned long long)s->nwrite, (unsigned long long)s->nopen);
+  int failed = s->failed;
+
+  segysplit_free(s);
+  segyfile_free(segyf);
+  fclose(fp);
+  return failed;
+}
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #ifdef HAVE_SYS_STAT_H
 #include <sys/stat.h>
@@ -31,6 +32,8 @@
 #endif  //HAVE_SYS_STAT_H
 
 #include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
 #ifndef _segy_h
 
 enum {
@@ -63,39 +66,6 @@ typedef struct {
 #define IEMAXIB 0x611FFFFF
 #define IEMINIB 0x21200000
 
-#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-#define HOST_LITTLE_ENDIAN 1
-#else
-#define HOST_LITTLE_ENDIAN 0
-#endif
-
-// Check for compiler intrinsics for byte swapping
-#if defined(__GNUC__) || defined(__clang__)
-#define bswap16(x) __builtin_bswap16(x)
-#define bswap32(x) __builtin_bswap32(x)
-#define bswap64(x) __builtin_bswap64(x)
-#elif defined(_MSC_VER)
-#include <stdlib.h>
-#define bswap16(x) _byteswap_ushort(x)
-#define bswap32(x) _byteswap_ulong(x)
-#define bswap64(x) _byteswap_uint64(x)
-#else
-// Fallback for other compilers
-static inline uint16_t bswap16(uint16_t x) {
-  return (x >> 8) | (x << 8);
-}
-static inline uint32_t bswap32(uint32_t x) {
-  return (x >> 24) | ((x << 8) & 0x00FF0000) | ((x >> 8) & 0x0000FF00) |
-         (x << 24);
-}
-static inline uint64_t bswap64(uint64_t x) {
-  x = (x & 0x00000000FFFFFFFF) << 32 | (x & 0xFFFFFFFF00000000) >> 32;
-  x = (x & 0x0000FFFF0000FFFF) << 16 | (x & 0xFFFF0000FFFF0000) >> 16;
-  x = (x & 0x00FF00FF00FF00FF) << 8 | (x & 0xFF00FF00FF00FF00) >> 8;
-  return x;
-}
-#endif
-
 typedef unsigned char byte;
 
 static byte EBCtoASC[256] = {
@@ -385,25 +355,56 @@ static const segy standard_segy_key[] = {
     {"unass2", 4}  /* unassigned 236 */
 };
 
-/* Big-endian to Little-endian conversion and back */
-static inline uint16_t get16(const char* buf);
-static inline uint32_t get32(const char* buf);
-static inline uint64_t get64(const char* buf);
-static inline float get32f(const char* buf);
-static inline double get64f(const char* buf);
-
-static inline void put16(char* buf, uint16_t val);
-static inline void put32(char* buf, uint32_t val);
-static inline void put64(char* buf, uint64_t val);
-// static inline void put32f(char* buf,float val);
-// static inline void put64f(char* buf,double val);
-
 /* IBM to IEEE float conversion and back */
 static float ibm2ieee(const char* num);
 static void ieee2ibm(char* num, float y);
 
 /* alloc segyfiel */
-static void segyinit_alloc(segyfile segyf);
+static void segyinit_alloc(segyfile segyf, segy_io* io);
+
+/* sequential reads and writes go to the stream of the backend when it has one,
+   else to the positional calls at segyf->pos */
+static size_t segy_seq_read(segyfile segyf, void* buf, size_t n) {
+  segy_io* io = segyf->io;
+  if (io->ops->read)
+    return io->ops->read(io, buf, n);
+  size_t nr = 0;
+  while (nr < n) {
+    size_t m = io->ops->read_at(io, (char*)buf + nr, n - nr, segyf->pos + (int64_t)nr);
+    if (0 == m)
+      break;
+    nr += m;
+  }
+  segyf->pos += (int64_t)nr;
+  return nr;
+}
+
+static size_t segy_seq_write(segyfile segyf, const void* buf, size_t n) {
+  segy_io* io = segyf->io;
+  if (io->ops->write)
+    return io->ops->write(io, buf, n);
+  size_t nw = 0;
+  while (nw < n) {
+    size_t m =
+        io->ops->write_at(io, (const char*)buf + nw, n - nw, segyf->pos + (int64_t)nw);
+    if (0 == m)
+      break;
+    nw += m;
+  }
+  segyf->pos += (int64_t)nw;
+  return nw;
+}
+
+int64_t segy_seek(segyfile segyf, int64_t off, int whence) {
+  segy_io* io = segyf->io;
+  if (io->ops->seek)
+    return io->ops->seek(io, off, whence);
+  int64_t base = SEEK_SET == whence ? 0 : SEEK_CUR == whence ? segyf->pos : segyio_size(io);
+  if (base < 0 || base + off < 0)
+    return -1;
+  segyf->pos = base + off;
+  return segyf->pos;
+}
 
 /* init a segey for read
 * @return SEGY_FILE 
@@ -411,9 +412,14 @@ with binary header and text header already read
 could direct read data 
 */
 segyfile segyfile_init_read(FILE* fp) {
+  return segyfile_init_read_io(segyio_stdio(fp, 0));
+}
+
+/* init a segyfile for read on any backend, the headers are read at the current
+ position (the start of the file for a new backend) */
+segyfile segyfile_init_read_io(segy_io* io) {
   segyfile segyf = (segyfile)malloc(sizeof(SEGY_FILE));
-  segyinit_alloc(segyf);
-  segyf->fp = fp;
+  segyinit_alloc(segyf, io);
 
   segyread_texthead(segyf, 0, 0);
   segyread_binaryhead(segyf);
@@ -432,9 +438,12 @@ segyfile segyfile_init_read(FILE* fp) {
 /* segyfile write init , no write set, should write manual for more flexible write */
 segyfile segyfile_init_write(FILE* fp, int ns, float dt, int format,
                              size_t ntrace) {
+  return segyfile_init_write_io(segyio_stdio(fp, 0), ns, dt, format, ntrace);
+}
+
+segyfile segyfile_init_write_io(segy_io* io, int ns, float dt, int format, size_t ntrace) {
   segyfile segyf = (segyfile)malloc(sizeof(SEGY_FILE));
-  segyinit_alloc(segyf);
-  segyf->fp = fp;
+  segyinit_alloc(segyf, io);
 
   segyf->format = format;
   segyf->ns = ns;
@@ -451,9 +460,91 @@ segyfile segyfile_init_write(FILE* fp, int ns, float dt, int format,
   return segyf;
 }
 
-static void segyinit_alloc(segyfile segyf) {
+/* segyfile append init, fp is opened "r+b" on a file written by an earlier run
+ ns, dt and format must match its binary header (0 takes the value of the file),
+ a partial last trace is cut off and the stream is left after the last complete trace */
+segyfile segyfile_init_append(FILE* fp, int ns, float dt, int format) {
+  return segyfile_init_append_io(segyio_stdio(fp, 0), ns, dt, format);
+}
+
+segyfile segyfile_init_append_io(segy_io* io, int ns, float dt, int format) {
+  int64_t size = segyio_size(io);
+  if (size < SEGY_EBCBYTES + SEGY_BHNBYTES) {
+    warninginfo("append: file of %lld bytes has no complete SEGY headers", (long long)size);
+    segyio_close(io);
+    return NULL;
+  }
+  if (io->ops->seek)
+    io->ops->seek(io, 0, SEEK_SET);
+  segyfile segyf = segyfile_init_read_io(io);
+
+  int filedt = (int)get16(segyf->bhraw + SEGY_BH_DT);
+  int wantdt = (int)(dt > 1 ? dt * 1000. + 0.5 : dt * 1000000. + 0.5);
+  const char* bad = NULL;
+  if (segyf->format != 1 && segyf->format != 2 && segyf->format != 3 && segyf->format != 5 &&
+      segyf->format != 8)
+    bad = "unsupported format";
+  else if (segyf->ns <= 0)
+    bad = "no samples per trace";
+  else if (ns > 0 && ns != segyf->ns)
+    bad = "samples per trace differ";
+  else if (format > 0 && format != segyf->format)
+    bad = "format differs";
+  else if (dt > 0 && abs(filedt - wantdt) > 1)
+    bad = "sample interval differs";
+  if (bad) {
+    warninginfo("append: %s (file ns %d format %d dt %d us)", bad, segyf->ns,
+                segyf->format, filedt);
+    segyfile_free(segyf);
+    return NULL;
+  }
+
+  segyf->bhead[segybhkey("hns")] = segyf->ns;
+  segyf->bhead[segybhkey("hdt")] = filedt;
+  segyf->bhead[segybhkey("format")] = segyf->format;
+  int64_t tail = (size - SEGY_EBCBYTES - SEGY_BHNBYTES) % (int64_t)segyf->nsegy;
+  if (tail > 0) {
+    warninginfo("append: dropping a partial trace of %lld bytes after trace %zu",
+                (long long)tail, segyf->ntrace);
+    if (!segyfile_truncate(segyf, segyf->ntrace)) {
+      segyfile_free(segyf);
+      return NULL;
+    }
+  }
+  segy_seek(segyf, 0, SEEK_END);
+  return segyf;
+}
+
+/*< cut the file after trace ntrace and continue writing there, e.g. to go back to
+-- the trace count of a checkpoint, return 1 on success */
+int segyfile_truncate(segyfile segyf, size_t ntrace) {
+  segy_io* io = segyf->io;
+  if (!io->ops->truncate || io->ops->truncate(io, segy_trace_offset(segyf, ntrace))) {
+    warninginfo("cannot truncate the file after trace %zu", ntrace);
+    return 0;
+  }
+  segy_seek(segyf, segy_trace_offset(segyf, ntrace), SEEK_SET);
+  segyf->ntrace = ntrace;
+  return 1;
+}
+
+/*< make everything written so far durable (fflush and fdatasync on stdio), the number
+-- of complete traces on disk goes to *ntrace if not NULL, return 1 on success */
+int segyfile_checkpoint(segyfile segyf, size_t* ntrace) {
+  int ok = segyio_flush(segyf->io, 1);
+  if (!ok)
+    warninginfo("checkpoint: cannot flush the file to disk");
+  if (ntrace)
+    *ntrace = segycal_ntrace(segyf);
+  return ok;
+}
+
+static void segyinit_alloc(segyfile segyf, segy_io* io) {
   if (!segyf)
     errorinfo("malloc failed for SEGY_FILE");
+  segyf->io = io;
+  segyf->pos = 0;
+  segyf->fp = io->fp;
   segyf->textraw = (char*)malloc(SEGY_EBCBYTES);
   if (!segyf->textraw)
     errorinfo("malloc failed for segy textraw");
@@ -466,11 +557,21 @@ static void segyinit_alloc(segyfile segyf) {
   if (!segyf->bhead)
     errorinfo("malloc failed for segy bhead");
   memset(segyf->bhead, 0, sizeof(int) * SEGY_BHNKEYS);
+  segyf->stats = NULL;
+  segyf->cache = NULL;
+  segyf->qkey = -1;
+  if (getenv("ESEGY_STATS"))
+    segyfile_stats_enable(segyf, 1);
 }
 
 /*< free the segyfile */
 void segyfile_free(segyfile segyf) {
   if (segyf) {
+    if (segyf->stats && getenv("ESEGY_STATS"))
+      segyfile_stats_print(segyf, stderr);
+    segy_cache_free(segyf->cache);
+    segyio_close(segyf->io);
+    free(segyf->stats);
     free(segyf->tracebuf);
     free(segyf->textraw);
     free(segyf->bhraw);
@@ -479,109 +580,53 @@ void segyfile_free(segyfile segyf) {
   }
 }
 
-// Get a 2-byte integer from a big-endian buffer
-static inline uint16_t get16(const char* buf) {
-  uint16_t x;
-  memcpy(&x, buf, 2);
-#ifdef HOST_LITTLE_ENDIAN
-  x = bswap16(x);
-#endif
-  return x;
-}
-
-// Get a 4-byte integer from a big-endian buffer
-static inline uint32_t get32(const char* buf) {
-  uint32_t x;
-  memcpy(&x, buf, 4);
-#ifdef HOST_LITTLE_ENDIAN
-  x = bswap32(x);
-#endif
-  return x;
-}
-
-// Get a 8-byte integer from a big-endian buffer
-static inline uint64_t get64(const char* buf) {
-  uint64_t x;
-  memcpy(&x, buf, 8);
-#ifdef HOST_LITTLE_ENDIAN
-  x = bswap64(x);
-#endif
-  return x;
-}
-
-// Get a 4-byte float from a big-endian buffer
-static inline float get32f(const char* buf) {
-  union {
-    uint32_t u;
-    float f;
-  } x;
-  memcpy(&x.u, buf, 4);
-#ifdef HOST_LITTLE_ENDIAN
-  x.u = bswap32(x.u);
-#endif
-  return x.f;
-}
-
-// Get a 8-byte float from a big-endian buffer
-static inline double get64f(const char* buf) {
-  union {
-    uint64_t u;
-    double d;
-  } x;
-  memcpy(&x.u, buf, 8);
-#ifdef HOST_LITTLE_ENDIAN
-  x.u = bswap64(x.u);
-#endif
-  return x.d;
-}
-
-// Put a 2-byte integer into a big-endian buffer
-static inline void put16(char* buf, uint16_t val) {
-#ifdef HOST_LITTLE_ENDIAN
-  val = bswap16(val);
-#endif
-  memcpy(buf, &val, 2);
+/*< enable or disable the counters, disabled counters cost one branch per call */
+void segyfile_stats_enable(segyfile segyf, int on) {
+  if (on && !segyf->stats) {
+    segyf->stats = (segy_stats*)calloc(1, sizeof(segy_stats));
+    if (!segyf->stats)
+      errorinfo("malloc failed for segy stats");
+  } else if (!on && segyf->stats) {
+    free(segyf->stats);
+    segyf->stats = NULL;
+  }
 }
 
-// Put a 4-byte integer/float into a big-endian buffer
-static inline void put32(char* buf, uint32_t val) {
-#ifdef HOST_LITTLE_ENDIAN
-  val = bswap32(val);
-#endif
-  memcpy(buf, &val, 4);
+/*< copy the counters, return 0 if they are disabled */
+int segyfile_get_stats(segyfile segyf, segy_stats* st) {
+  if (!segyf->stats) {
+    memset(st, 0, sizeof(*st));
+    return 0;
+  }
+  uint64_t* src = (uint64_t*)segyf->stats;
+  uint64_t* dst = (uint64_t*)st;
+  for (size_t i = 0; i < sizeof(segy_stats) / sizeof(uint64_t); i++)
+    dst[i] = __atomic_load_n(src + i, __ATOMIC_RELAXED);
+  return 1;
 }
 
-// put a 8-byte integerinto a big-endian buffer
-static inline void put64(char* buf, uint64_t val) {
-#ifdef HOST_LITTLE_ENDIAN
-  val = bswap64(val);
-#endif
-  memcpy(buf, &val, 8);
-}
-
-// Get a 8-byte integer from a big-endian buffer
-static inline void put32f(char* buf, float val) {
-  union {
-    uint32_t u;
-    float f;
-  } x;
-  x.f = val;
-#ifdef HOST_LITTLE_ENDIAN
-  x.u = bswap32(x.u);
-#endif
-  memcpy(buf, &x.u, 4);
+/*< zero the counters */
+void segyfile_stats_reset(segyfile segyf) {
+  if (segyf->stats)
+    memset(segyf->stats, 0, sizeof(segy_stats));
 }
 
-static inline void put64f(char* buf, double val) {
-  union {
-    uint64_t u;
-    double d;
-  } x;
-  x.d = val;
-#ifdef HOST_LITTLE_ENDIAN
-  x.u = bswap64(x.u);
-#endif
-  memcpy(buf, &x.u, 8);
+/*< print the counters */
+void segyfile_stats_print(segyfile segyf, FILE* out) {
+  segy_stats st;
+  if (!segyfile_get_stats(segyf, &st)) {
+    fprintf(out, "segy stats: disabled\n");
+    return;
+  }
+  double io = st.io_ns * 1e-9, smp = st.sample_ns * 1e-9, hdr = st.header_ns * 1e-9;
+  fprintf(out, "segy stats: read %llu bytes in %llu calls, %llu traces\n",
+          (unsigned long long)st.bytes_read, (unsigned long long)st.nread,
+          (unsigned long long)st.traces_read);
+  fprintf(out, "segy stats: wrote %llu bytes in %llu calls, %llu traces\n",
+          (unsigned long long)st.bytes_written, (unsigned long long)st.nwrite,
+          (unsigned long long)st.traces_written);
+  fprintf(out, "segy stats: io %.3f s (%.1f MB/s), samples %.3f s, headers %.3f s\n",
+          io, io > 0 ? (st.bytes_read + st.bytes_written) / 1e6 / io : 0.0, smp, hdr);
 }
 
 void ebc2asc(int narr, char* arr)
@@ -768,42 +813,67 @@ const char* segykeyword(int k) {
   return standard_segy_key[k].name;
 }
 
+/*< byte offset of trace header key k in the 240 bytes header */
+int segy_keyoffset(int k) {
+  int off = 0;
+  for (int i = 0; i < k && i < SEGY_THNKEYS; i++)
+    off += standard_segy_key[i].size;
+  return off;
+}
+
+/*< byte size (2 or 4) of trace header key k */
+int segy_keysize(int k) {
+  return (int)standard_segy_key[k].size;
+}
+
 /*< Extract a floating-point trace[nt] from traced raw.
--- format: 1: IBM, 2: int4, 3: int2, 5: IEEE
+-- format: 1: IBM, 2: int4, 3: int2, 5: IEEE, 8: int1
 >*/
 void segy2trace(const char* buf, float* trace, int ns, int format) {
-  int i, nb;
+  segy2trace_step(buf, trace, ns, 1, format);
+}
 
-  nb = (3 == format) ? 2 : 4;
+/*< Extract every step-th sample of raw samples into trace[n], the format is
+-- tested once per call instead of once per sample
+>*/
+void segy2trace_step(const char* buf, float* trace, int n, int step, int format) {
+  size_t inc = (size_t)segy_samplebytes(format) * (size_t)step;
+  int i;
 
-  for (i = 0; i < ns; i++, buf += nb) {
-    switch (format) {
-      case 1:
-        trace[i] = ibm2ieee(buf);
-        break; /* IBM float */
-      case 2:
-        trace[i] = (float)get32(buf);
-        break; /* int4 */
-      case 3:
-        trace[i] = (float)get16(buf);
-        break; /* int2 */
-      case 5:
-        trace[i] = get32f(buf);
-        break; /* IEEE float */
-      default:
-        errorinfo("not support format %d", format);
-        break;
-    }
+  switch (format) {
+    case 1:
+      for (i = 0; i < n; i++)
+        trace[i] = ibm2ieee(buf + i * inc);
+      break; /* IBM float */
+    case 2:
+      for (i = 0; i < n; i++)
+        trace[i] = (float)(int32_t)get32(buf + i * inc);
+      break; /* int4 */
+    case 3:
+      for (i = 0; i < n; i++)
+        trace[i] = (float)(int16_t)get16(buf + i * inc);
+      break; /* int2 */
+    case 5:
+      for (i = 0; i < n; i++)
+        trace[i] = get32f(buf + i * inc);
+      break; /* IEEE float */
+    case 8:
+      for (i = 0; i < n; i++)
+        trace[i] = (float)(int8_t)buf[i * inc];
+      break; /* int1 */
+    default:
+      errorinfo("not support format %d", format);
+      break;
   }
 }
 
 /*< Convert a floating-point trace[ns] to buffer buf.
--- format: 1: IBM, 2: int4, 3: int2, 5: IEEE
+-- format: 1: IBM, 2: int4, 3: int2, 5: IEEE, 8: int1
 */
 void trace2segy(char* tracebuf, const float* trace, int ns, int format) {
   int i, nb;
 
-  nb = (3 == format) ? 2 : 4;
+  nb = segy_samplebytes(format);
 
   for (i = 0; i < ns; i++, tracebuf += nb) {
     switch (format) {
@@ -819,6 +889,9 @@ void trace2segy(char* tracebuf, const float* trace, int ns, int format) {
       case 5:
         put32f(tracebuf, (float)trace[i]);
         break; /* IEEE float */
+      case 8:
+        *tracebuf = (char)(int8_t)(int)trace[i];
+        break; /* int1 */
       default:
         errorinfo("Unknown format %d", format);
         break;
@@ -826,6 +899,93 @@ void trace2segy(char* tracebuf, const float* trace, int ns, int format) {
   }
 }
 
+/*< Convert trace[ns] to integer format 2, 3 or 8 as round(trace * 2^N), N the largest
+-- exponent that keeps the peak in range, return N
+*/
+int trace2segy_quant(char* tracebuf, const float* trace, int ns, int format) {
+  int bits = (2 == format) ? 31 : (3 == format) ? 15 : (8 == format) ? 7 : 0;
+  if (0 == bits)
+    errorinfo("quantization needs an integer format, not %d", format);
+  float peak = 0;
+#pragma omp simd reduction(max : peak)
+  for (int i = 0; i < ns; i++) {
+    float a = fabsf(trace[i]);
+    peak = a > peak ? a : peak; /* NaN is skipped */
+  }
+  /* peak < 2^e, so peak * 2^(bits - e) < 2^bits */
+  int e = 0;
+  if (peak > 0 && isfinite(peak))
+    frexpf(peak, &e);
+  int expo = peak > 0 && isfinite(peak) ? bits - e : 0;
+  if (expo > SEGY_QUANT_MAXEXP)
+    expo = SEGY_QUANT_MAXEXP;
+  else if (expo < -SEGY_QUANT_MAXEXP)
+    expo = -SEGY_QUANT_MAXEXP;
+
+  double scale = ldexp(1.0, expo);
+  double hi = ldexp(1.0, bits) - 1, lo = -hi - 1;
+  int nb = segy_samplebytes(format);
+  for (int i = 0; i < ns; i++, tracebuf += nb) {
+    double v = nearbyint(trace[i] * scale);
+    v = v > hi ? hi : v >= lo ? v : v < lo ? lo : 0; /* rounding up to 2^bits, NaN */
+    if (2 == format)
+      put32(tracebuf, (uint32_t)(int32_t)v);
+    else if (3 == format)
+      put16(tracebuf, (uint16_t)(int16_t)v);
+    else
+      *tracebuf = (char)(int8_t)v;
+  }
+  return expo;
+}
+
+/*< multiply trace[n] by 2^-expo, undoing trace2segy_quant */
+void segyquant_rescale(float* trace, int n, int expo) {
+  if (0 == expo)
+    return;
+  float s = ldexpf(1.0f, -expo);
+#pragma omp simd
+  for (int i = 0; i < n; i++)
+    trace[i] *= s;
+}
+
+/*< quantize the samples segyf writes to an integer format, key -1 turns it off */
+void segyfile_set_quantize(segyfile segyf, int key) {
+  if (key >= SEGY_THNKEYS)
+    errorinfo("no trace header key %d", key);
+  if (key >= 0 && 2 != segyf->format && 3 != segyf->format && 8 != segyf->format)
+    warninginfo("format %d is not an integer format, samples are not quantized",
+                segyf->format);
+  segyf->qkey = key < 0 ? -1 : key;
+}
+
+/* 1 if the samples of segyf carry a per-trace exponent */
+static int segyquant_on(const SEGY_FILE* segyf) {
+  return segyf->qkey >= 0 && (2 == segyf->format || 3 == segyf->format || 8 == segyf->format);
+}
+
+/*< encode trace[ns] into the samples of record rec whose header is in place, the
+-- exponent goes to the header key when segyf quantizes >*/
+void segyquant_encode(segyfile segyf, char* rec, const float* trace) {
+  if (!segyquant_on(segyf)) {
+    trace2segy(rec + SEGY_THNBYTES, trace, segyf->ns, segyf->format);
+    return;
+  }
+  int expo = trace2segy_quant(rec + SEGY_THNBYTES, trace, segyf->ns, segyf->format);
+  char* p = rec + segy_keyoffset(segyf->qkey);
+  if (2 == segy_keysize(segyf->qkey))
+    put16(p, (uint16_t)(int16_t)expo);
+  else
+    put32(p, (uint32_t)(int32_t)expo);
+}
+
+/*< exponent of record rec, 0 unless segyf quantizes >*/
+int segyquant_exponent(segyfile segyf, const char* rec) {
+  if (!segyquant_on(segyf))
+    return 0;
+  const char* p = rec + segy_keyoffset(segyf->qkey);
+  return 2 == segy_keysize(segyf->qkey) ? (int16_t)get16(p) : (int32_t)get32(p);
+}
+
 /*< Convert an integer trace[nk] to buffer buf */
 void head2segy(char* tracebuf, const int* thead, int nk) {
   char* buf = tracebuf;
@@ -949,7 +1109,7 @@ wirte the segy text header to file , all 3200 bytes
 
 int segywrite_texthead(segyfile segyf, int isskip, int useebc) {
   if (isskip) {
-    fseek(segyf->fp, SEGY_EBCBYTES, SEEK_SET);
+    segy_seek(segyf, SEGY_EBCBYTES, SEEK_SET);
     return 3200;
   }
   char ahead[SEGY_EBCBYTES];
@@ -959,7 +1119,10 @@ int segywrite_texthead(segyfile segyf, int isskip, int useebc) {
     asc2ebc(SEGY_EBCBYTES, ahead);
   }
 
-  return fwrite(ahead, 1, SEGY_EBCBYTES, segyf->fp);
+  uint64_t t0 = SEGY_TIC(segyf);
+  size_t nw = segy_seq_write(segyf, ahead, SEGY_EBCBYTES);
+  segy_count_write(segyf, nw, t0);
+  return nw;
 }
 
 /*
@@ -971,11 +1134,14 @@ wirte the segy text header to file , all 3200 bytes
 */
 int segyread_texthead(segyfile segyf, int isskip, int useebc) {
   if (isskip) {
-    fseek(segyf->fp, SEGY_EBCBYTES, SEEK_SET);
+    segy_seek(segyf, SEGY_EBCBYTES, SEEK_SET);
     return 3200;
   }
 
-  if (SEGY_EBCBYTES != fread(segyf->textraw, 1, SEGY_EBCBYTES, segyf->fp))
+  uint64_t t0 = SEGY_TIC(segyf);
+  size_t nr = segy_seq_read(segyf, segyf->textraw, SEGY_EBCBYTES);
+  segy_count_read(segyf, nr, t0);
+  if (SEGY_EBCBYTES != nr)
     errorinfo("Error reading ebcdic header");
 
   if (useebc) {
@@ -997,11 +1163,17 @@ int segywrite_binaryhead(segyfile segyf) {
     warninginfo("binary header ns not set");
   if (segyformat(segyf->bhraw) == 0 || segyf->bhead[segybhkey("format")] == 0)
     warninginfo("binary header format not set");
-  return fwrite(segyf->bhraw, 1, SEGY_BHNBYTES, segyf->fp);
+  uint64_t t0 = SEGY_TIC(segyf);
+  size_t nw = segy_seq_write(segyf, segyf->bhraw, SEGY_BHNBYTES);
+  segy_count_write(segyf, nw, t0);
+  return nw;
 }
 
 int segyread_binaryhead(segyfile segyf) {
-  if (SEGY_BHNBYTES != fread(segyf->bhraw, 1, SEGY_BHNBYTES, segyf->fp))
+  uint64_t t0 = SEGY_TIC(segyf);
+  size_t nr = segy_seq_read(segyf, segyf->bhraw, SEGY_BHNBYTES);
+  segy_count_read(segyf, nr, t0);
+  if (SEGY_BHNBYTES != nr)
     errorinfo("Error reading binary header");
   segy2bhead(segyf->bhraw, segyf->bhead, SEGY_BHNKEYS);
   return SEGY_BHNBYTES;
@@ -1010,16 +1182,59 @@ int segyread_binaryhead(segyfile segyf) {
 /*< the bytes of one trace with header
 240 + ns * sizeof(databyte)*/
 size_t segycal_nsegy(segyfile segyf) {
-  return (size_t)(SEGY_THNBYTES + segyf->ns * ((segyf->format == 3) ? 2 : 4));
+  return (size_t)SEGY_THNBYTES + (size_t)segyf->ns * segy_samplebytes(segyf->format);
 }
 
 /*< calculate trace number */
 size_t segycal_ntrace(segyfile segyf) {
-  size_t original_pos = ftello(segyf->fp);
-  fseeko(segyf->fp, 0, SEEK_END);
-  size_t pos = ftello(segyf->fp); /* pos is the filesize in bytes */
-  fseeko(segyf->fp, original_pos, SEEK_SET);
-  return (pos - SEGY_EBCBYTES - SEGY_BHNBYTES) / segyf->nsegy;
+  int64_t size = segyio_size(segyf->io);
+  if (size < SEGY_EBCBYTES + SEGY_BHNBYTES)
+    return 0;
+  return (size_t)(size - SEGY_EBCBYTES - SEGY_BHNBYTES) / segyf->nsegy;
+}
+
+/** positional read through the backend, independent of the sequential position
+* safe to call from several threads on the same segyfile
+* @return 1 if all n bytes were read, 0 on end of file or error
+*/
+int segy_read_at(segyfile segyf, void* buf, size_t n, off_t off) {
+  segy_io* io = segyf->io;
+  char* p = (char*)buf;
+  uint64_t t0 = SEGY_TIC(segyf);
+  size_t ntotal = n;
+  SEGY_PROBE2(read, off, n);
+  while (n > 0) {
+    size_t nr = io->ops->read_at(io, p, n, off);
+    if (0 == nr)
+      break;
+    p += nr;
+    off += (off_t)nr;
+    n -= nr;
+  }
+  segy_count_read(segyf, ntotal - n, t0);
+  return 0 == n;
+}
+
+/** positional write through the backend, independent of the sequential position
+* a stdio stream must be flushed before if it still holds buffered data
+* @return 1 if all n bytes were written, 0 on error
+*/
+int segy_write_at(segyfile segyf, const void* buf, size_t n, off_t off) {
+  segy_io* io = segyf->io;
+  const char* p = (const char*)buf;
+  uint64_t t0 = SEGY_TIC(segyf);
+  size_t ntotal = n;
+  SEGY_PROBE2(write, off, n);
+  while (n > 0) {
+    size_t nw = io->ops->write_at(io, p, n, off);
+    if (0 == nw)
+      break;
+    p += nw;
+    off += (off_t)nw;
+    n -= nw;
+  }
+  segy_count_write(segyf, ntotal - n, t0);
+  return 0 == n;
 }
 
 /** read one trace from segy 
@@ -1028,26 +1243,245 @@ size_t segycal_ntrace(segyfile segyf) {
 * @param trace: float array to store trace data, must be at least ns elements
 */
 int segyread_onetrace(segyfile segyf, int* thead, float* trace) {
-  if (1 != fread(segyf->tracebuf, segyf->nsegy, 1, segyf->fp))
+  uint64_t t0 = SEGY_TIC(segyf);
+  SEGY_PROBE2(read, -1, segyf->nsegy);
+  size_t nr = segy_seq_read(segyf, segyf->tracebuf, segyf->nsegy) == segyf->nsegy;
+  segy_count_read(segyf, nr * segyf->nsegy, t0);
+  if (1 != nr)
     return 0; /* End of file or error */
+  t0 = SEGY_TIC(segyf);
   segy2head(segyf->tracebuf, thead, SEGY_THNKEYS);
+  segy_count_header(segyf, 1, t0);
+  t0 = SEGY_TIC(segyf);
   segy2trace(segyf->tracebuf + SEGY_THNBYTES, trace, segyf->ns, segyf->format);
+  segyquant_rescale(trace, segyf->ns, segyquant_exponent(segyf, segyf->tracebuf));
+  segy_count_sample(segyf, 1, t0);
+  segy_count_traces_read(segyf, 1);
   return 1;
 }
 
+#define SEGY_COALESCE_GAP (64 << 10) /* read through gaps up to this many bytes */
+#define SEGY_COALESCE_MAX (8 << 20)  /* largest single coalesced read */
+
+/*< samples of the window [it0, it1) taken every step-th sample */
+int segycal_windowns(int it0, int it1, int step) {
+  return it1 > it0 && step > 0 ? (it1 - it0 + step - 1) / step : 0;
+}
+
+/* byte range [w0, w1) of a window inside a trace record */
+static void segy_window_bytes(segyfile segyf, int it0, int it1, int step, size_t* w0,
+                              size_t* w1) {
+  if (it0 < 0 || it1 > segyf->ns || step < 1 || it0 >= it1)
+    errorinfo("bad sample window [%d, %d) step %d for ns %d", it0, it1, step, segyf->ns);
+  size_t nb = (size_t)segy_samplebytes(segyf->format);
+  int last = it0 + (segycal_windowns(it0, it1, step) - 1) * step;
+  *w0 = SEGY_THNBYTES + (size_t)it0 * nb;
+  *w1 = SEGY_THNBYTES + (size_t)(last + 1) * nb;
+}
+
+/** read the next trace, samples it0, it0 + step, ... below it1 only
+* the samples before and after the window are skipped, not read, when they are many
+* @param trace: float array of segycal_windowns(it0, it1, step) elements
+*/
+int segyread_onetrace_window(segyfile segyf, int* thead, float* trace, int it0, int it1,
+                             int step) {
+  size_t w0, w1;
+  segy_window_bytes(segyf, it0, it1, step, &w0, &w1);
+  int joined = w0 - SEGY_THNBYTES <= SEGY_COALESCE_GAP;
+  char* buf = segyf->tracebuf;
+
+  uint64_t t0 = SEGY_TIC(segyf);
+  size_t nbytes = joined ? w1 : SEGY_THNBYTES;
+  size_t nr = segy_seq_read(segyf, buf, nbytes) == nbytes;
+  if (1 == nr && !joined) {
+    nr = segy_seek(segyf, (int64_t)(w0 - SEGY_THNBYTES), SEEK_CUR) >= 0 &&
+         segy_seq_read(segyf, buf + w0, w1 - w0) == w1 - w0;
+    nbytes += w1 - w0;
+  }
+  segy_count_read(segyf, nr * nbytes, t0);
+  if (1 != nr)
+    return 0; /* End of file or error */
+  /* leave the file at the next trace, the last trace may be cut short */
+  if (w1 < segyf->nsegy)
+    segy_seek(segyf, (int64_t)(segyf->nsegy - w1), SEEK_CUR);
+
+  t0 = SEGY_TIC(segyf);
+  segy2head(buf, thead, SEGY_THNKEYS);
+  segy_count_header(segyf, 1, t0);
+  t0 = SEGY_TIC(segyf);
+  segy2trace_step(buf + w0, trace, segycal_windowns(it0, it1, step), step, segyf->format);
+  segyquant_rescale(trace, segycal_windowns(it0, it1, step), segyquant_exponent(segyf, buf));
+  segy_count_sample(segyf, 1, t0);
+  segy_count_traces_read(segyf, 1);
+  return 1;
+}
+
+/** read the traces idx[n] with coalesced reads
+* neighbouring traces are fetched with one read, ascending idx gives the best I/O
+* @param theads: n * SEGY_THNKEYS ints for the headers, may be NULL
+* @param traces: n * ns floats for the samples, may be NULL
+* @param nthreads: threads decoding in parallel, 0 means all available
+* @return number of traces read
+*/
+size_t segyread_tracelist(segyfile segyf, const size_t* idx, size_t n, int* theads,
+                          float* traces, int nthreads) {
+  return segyread_tracelist_window(segyf, idx, n, theads, traces, 0, segyf->ns, 1,
+                                   nthreads);
+}
+
+/** read the window [it0, it1) with stride step of the traces idx[n]
+* each trace needs its header and the window bytes; traces are joined into one
+* read when the unneeded bytes between them are few, otherwise the header and
+* the window of a trace are read on their own
+* @param traces: n * segycal_windowns(it0, it1, step) floats, may be NULL
+*/
+size_t segyread_tracelist_window(segyfile segyf, const size_t* idx, size_t n, int* theads,
+                                 float* traces, int it0, int it1, int step, int nthreads) {
+  size_t nsegy = segyf->nsegy;
+  size_t w0, w1;
+  segy_window_bytes(segyf, it0, it1, step, &w0, &w1);
+  size_t nout = (size_t)segycal_windowns(it0, it1, step);
+  int joined = w0 - SEGY_THNBYTES <= SEGY_COALESCE_GAP;
+  size_t need = joined ? w1 : SEGY_THNBYTES + (w1 - w0);
+  int coalesce = nsegy - need <= SEGY_COALESCE_GAP;
+  size_t maxrun = SEGY_COALESCE_MAX / nsegy > 0 ? SEGY_COALESCE_MAX / nsegy : 1;
+  size_t* runs = (size_t*)malloc(sizeof(size_t) * (n + 1));
+  if (!runs)
+    errorinfo("malloc failed for trace list runs");
+
+  size_t nrun = 0;
+  for (size_t k = 0; k < n; k++) {
+    if (0 == k || !coalesce || idx[k] <= idx[k - 1] || idx[k] >= segyf->ntrace ||
+        (idx[k] - idx[k - 1] - 1) * nsegy > SEGY_COALESCE_GAP ||
+        idx[k] - idx[runs[nrun - 1]] >= maxrun)
+      runs[nrun++] = k;
+  }
+  runs[nrun] = n;
+
+  size_t maxspan = 1;
+  for (size_t r = 0; r < nrun; r++) {
+    size_t first = idx[runs[r]], last = idx[runs[r + 1] - 1];
+    if (first < segyf->ntrace && last - first + 1 > maxspan)
+      maxspan = last - first + 1;
+  }
+
+  size_t nread = 0;
+#pragma omp parallel num_threads(segy_nthreads(nthreads)) reduction(+ : nread)
+  {
+    char* buf = (char*)malloc((maxspan - 1) * nsegy + w1);
+    if (!buf)
+      errorinfo("malloc failed for trace list buffer");
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t r = 0; r < nrun; r++) {
+      size_t k0 = runs[r], k1 = runs[r + 1];
+      size_t first = idx[k0];
+      if (first >= segyf->ntrace)
+        continue;
+      off_t off = segy_trace_offset(segyf, first);
+      if (k1 - k0 > 1 || joined) {
+        size_t span = (idx[k1 - 1] - first) * nsegy + w1;
+        if (!segy_read_at(segyf, buf, span, off))
+          continue;
+      } else if (!segy_read_at(segyf, buf, SEGY_THNBYTES, off) ||
+                 !segy_read_at(segyf, buf + w0, w1 - w0, off + (off_t)w0)) {
+        continue;
+      }
+      uint64_t t0 = SEGY_TIC(segyf);
+      if (theads)
+        for (size_t k = k0; k < k1; k++)
+          segy2head(buf + (idx[k] - first) * nsegy, theads + k * SEGY_THNKEYS,
+                    SEGY_THNKEYS);
+      segy_count_header(segyf, k1 - k0, t0);
+      t0 = SEGY_TIC(segyf);
+      if (traces)
+        for (size_t k = k0; k < k1; k++) {
+          const char* rec = buf + (idx[k] - first) * nsegy;
+          segy2trace_step(rec + w0, traces + k * nout, (int)nout, step, segyf->format);
+          segyquant_rescale(traces + k * nout, (int)nout, segyquant_exponent(segyf, rec));
+        }
+      segy_count_sample(segyf, k1 - k0, t0);
+      nread += k1 - k0;
+    }
+    free(buf);
+  }
+  segy_count_traces_read(segyf, nread);
+  free(runs);
+  return nread;
+}
+
 /** write one trace from segy 
 * @param SEGY_FILE: segyfile struct
 * @param thead: integer array to store trace header, must be at least SEGY_THNKEYS
 * @param trace: float array to store trace data, must be at least ns elements
 */
 int segywrite_onetrace(segyfile segyf, const int* thead, const float* trace) {
+  uint64_t t0 = SEGY_TIC(segyf);
   head2segy(segyf->tracebuf, thead, SEGY_THNKEYS);
-  trace2segy(segyf->tracebuf + SEGY_THNBYTES, trace, segyf->ns, segyf->format);
-  if (1 != fwrite(segyf->tracebuf, segyf->nsegy, 1, segyf->fp))
+  segy_count_header(segyf, 1, t0);
+  t0 = SEGY_TIC(segyf);
+  segyquant_encode(segyf, segyf->tracebuf, trace);
+  segy_count_sample(segyf, 1, t0);
+  t0 = SEGY_TIC(segyf);
+  SEGY_PROBE2(write, -1, segyf->nsegy);
+  size_t nw = segy_seq_write(segyf, segyf->tracebuf, segyf->nsegy) == segyf->nsegy;
+  segy_count_write(segyf, nw * segyf->nsegy, t0);
+  if (1 != nw)
+    errorinfo("Error writing trace");
+  segy_count_traces_written(segyf, 1);
+  return 1;
+}
+
+/** read the next record untouched, no header or sample conversion
+* @param rec: char array of at least nsegy bytes
+*/
+int segyread_onetrace_raw(segyfile segyf, char* rec) {
+  uint64_t t0 = SEGY_TIC(segyf);
+  SEGY_PROBE2(read, -1, segyf->nsegy);
+  size_t nr = segy_seq_read(segyf, rec, segyf->nsegy) == segyf->nsegy;
+  segy_count_read(segyf, nr * segyf->nsegy, t0);
+  if (1 != nr)
+    return 0; /* End of file or error */
+  segy_count_traces_read(segyf, 1);
+  return 1;
+}
+
+/** write one record untouched, e.g. read by segyread_onetrace_raw from a file of the
+* same ns and format
+*/
+int segywrite_onetrace_raw(segyfile segyf, const char* rec) {
+  uint64_t t0 = SEGY_TIC(segyf);
+  SEGY_PROBE2(write, -1, segyf->nsegy);
+  size_t nw = segy_seq_write(segyf, rec, segyf->nsegy) == segyf->nsegy;
+  segy_count_write(segyf, nw * segyf->nsegy, t0);
+  if (1 != nw)
     errorinfo("Error writing trace");
+  segy_count_traces_written(segyf, 1);
   return 1;
 }
 
+/** positional read of whole records, clipped to the traces of the file */
+size_t segyread_traces_raw(segyfile segyf, size_t itr0, size_t n, char* buf) {
+  if (itr0 >= segyf->ntrace)
+    return 0;
+  if (n > segyf->ntrace - itr0)
+    n = segyf->ntrace - itr0;
+  if (0 == n || !segy_read_at(segyf, buf, n * segyf->nsegy, segy_trace_offset(segyf, itr0)))
+    return 0;
+  segy_count_traces_read(segyf, n);
+  return n;
+}
+
+/** positional write of whole records, the stream of a stdio backend must not hold
+* buffered data for the same bytes
+*/
+size_t segywrite_traces_raw(segyfile segyf, size_t itr0, size_t n, const char* buf) {
+  if (0 == n || !segy_write_at(segyf, buf, n * segyf->nsegy, segy_trace_offset(segyf, itr0)))
+    return 0;
+  segy_count_traces_written(segyf, n);
+  return n;
+}
+
 /** convert char to value
 * @param chars: character array to convert from
 * @param value: pointer to store the converted value
@@ -1,8 +1,13 @@
 /* This file is automatically generated. DO NOT EDIT! */
+#include <stdint.h>
 #include <stdio.h>
 #ifndef _segy_h
 #define _segy_h
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define SEGY_BH_FORMAT 24
 #define SEGY_BH_NS 20
 #define SEGY_BH_DT 16
@@ -13,11 +18,27 @@ enum {
   SEGY_THNBYTES = 240,  /* Bytes in the tape trace header	*/
   SEGY_THNKEYS = 91,    /* Number of mandated header fields	*/
   SEGY_BHNKEYS = 27,    /* Number of mandated binary fields	*/
+  SEGY_QUANT_MAXEXP = 255, /* Largest |N| of a quantization exponent */
 };
 
-/** format,ns,dt,nsegy,ntrace,textraw,bhraw,bhead,tracebuf*/
+/** per handle I/O and conversion counters, times in nanoseconds */
 typedef struct {
-  FILE* fp;
+  uint64_t bytes_read;     // bytes read from the file
+  uint64_t bytes_written;  // bytes written to the file
+  uint64_t traces_read;    // traces read
+  uint64_t traces_written; // traces written
+  uint64_t nread;          // fread/pread calls
+  uint64_t nwrite;         // fwrite/pwrite calls
+  uint64_t io_ns;          // time spent in read and write calls
+  uint64_t sample_ns;      // time spent in sample conversion
+  uint64_t header_ns;      // time spent in trace header conversion
+} segy_stats;
+
+/** io,pos,fp,format,ns,dt,nsegy,ntrace,textraw,bhraw,bhead,tracebuf,stats,cache,qkey*/
+typedef struct {
+  struct segy_io* io; // I/O backend, see segy_io.h
+  int64_t pos;        // position of the sequential calls when the backend has no stream
+  FILE* fp;           // stream of the stdio backend, NULL for other backends
   int format;
   int ns;
   float dt;
@@ -27,6 +48,9 @@ typedef struct {
   char* bhraw;     // binray raw (same as segy) avoid to handle the bhraw
   int* bhead;      // binary header
   char* tracebuf;  // a buffer
+  segy_stats* stats; // counters, NULL when disabled
+  struct segy_cache* cache; // decoded trace block cache, NULL when disabled
+  int qkey;           // header key of the per-trace quantization exponent, -1 when off
 } SEGY_FILE;
 
 typedef SEGY_FILE* segyfile;
@@ -36,15 +60,41 @@ void errorinfo(const char* format, ...);
 /*< warning info */
 void warninginfo(const char* format, ...) ;
 
-/*< initialize segyfile in read mode  >*/
+/*< initialize segyfile in read mode, on the stdio backend of fp (segy_io.h has others) >*/
 segyfile segyfile_init_read(FILE* fp);
 
 /*< initialize segyfile in read mode  >*/
 segyfile segyfile_init_write(FILE* fp, int ns, float dt, int format,size_t ntrace);
 
+/*< initialize a segyfile to continue a file opened "r+b": the headers are checked
+-- against ns, dt and format (0 takes the file's value), a partial last trace is
+-- cut off and writing continues after the last complete trace (segyf->ntrace),
+-- return NULL on a mismatch >*/
+segyfile segyfile_init_append(FILE* fp, int ns, float dt, int format);
+
+/*< cut the file after trace ntrace and continue writing there >*/
+int segyfile_truncate(segyfile segyf, size_t ntrace);
+
+/*< flush and fdatasync what was written, the complete traces on disk go to *ntrace >*/
+int segyfile_checkpoint(segyfile segyf, size_t* ntrace);
+
 /*< free the segyfile */
 void segyfile_free(segyfile segyf);
 
+/*< enable (on=1) or disable (on=0) the counters of segyf
+-- the counters start enabled when the environment variable ESEGY_STATS is set,
+-- and are then printed to stderr by segyfile_free >*/
+void segyfile_stats_enable(segyfile segyf, int on);
+
+/*< copy the counters of segyf to st, return 0 if counters are disabled >*/
+int segyfile_get_stats(segyfile segyf, segy_stats* st);
+
+/*< zero the counters of segyf >*/
+void segyfile_stats_reset(segyfile segyf);
+
+/*< print the counters of segyf to out >*/
+void segyfile_stats_print(segyfile segyf, FILE* out);
+
 /*< Convert char array arrr[narr]: EBC to ASCII >*/
 void ebc2asc(int narr, char* arr);
 
@@ -82,15 +132,39 @@ const char* segybhkeyword(int k);
 const char* segykeyword(int k);
 
 /*< Extract a floating-point trace[nt] from buffer buf.
--- format: 1: IBM, 2: int4, 3: int2, 5: IEEE, 7: int1
+-- format: 1: IBM, 2: int4, 3: int2, 5: IEEE, 8: int1
 >*/
 void segy2trace(const char* buf, float* trace, int ns, int format);
 
+/*< Extract every step-th sample of raw samples into trace[n] >*/
+void segy2trace_step(const char* buf, float* trace, int n, int step, int format);
+
 /*< Convert a floating-point trace[ns] to buffer buf.
--- format: 1: IBM, 2: int4, 3: int2, 5: IEEE
+-- format: 1: IBM, 2: int4, 3: int2, 5: IEEE, 8: int1
 >*/
 void trace2segy(char* buf, const float* trace, int ns, int format);
 
+/*< Convert trace[ns] to integer format 2, 3 or 8 as round(trace * 2^N), N the largest
+-- exponent that keeps the peak in range, return N
+>*/
+int trace2segy_quant(char* buf, const float* trace, int ns, int format);
+
+/*< multiply trace[n] by 2^-expo, undoing trace2segy_quant >*/
+void segyquant_rescale(float* trace, int n, int expo);
+
+/*< quantize the samples segyf writes to an integer format (2, 3 or 8) with
+-- trace2segy_quant and keep each trace's N in header key (segykey("trwf") follows
+-- the SEG-Y meaning of 2^-N per unit), samples read through segyf are multiplied by
+-- 2^-N again; set it on the reading handle too, key -1 turns it off >*/
+void segyfile_set_quantize(segyfile segyf, int key);
+
+/*< encode trace[ns] into the samples of record rec whose header is in place, the
+-- exponent goes to the header key when segyf quantizes >*/
+void segyquant_encode(segyfile segyf, char* rec, const float* trace);
+
+/*< exponent of record rec, 0 unless segyf quantizes >*/
+int segyquant_exponent(segyfile segyf, const char* rec);
+
 /*< Convert an integer trace[nk] to buffer buf >*/
 void head2segy(char* theadchar, const int* thead, int nk);
 
@@ -121,16 +195,52 @@ size_t segycal_nsegy(segyfile segyf);
 /*< get trace number */
 size_t segycal_ntrace(segyfile segyf);
 
+/*< samples of the window [it0, it1) taken every step-th sample >*/
+int segycal_windowns(int it0, int it1, int step);
+
 /*< read one trace from segy */
 int segyread_onetrace(segyfile segyf, int* thead, float* trace);
 
+/*< read the traces idx[n] with coalesced reads into theads[n][SEGY_THNKEYS]
+-- and traces[n][ns] (either may be NULL), return the number of traces read >*/
+size_t segyread_tracelist(segyfile segyf, const size_t* idx, size_t n, int* theads,
+                          float* traces, int nthreads);
+
+/*< read the next trace, decoding samples it0, it0 + step, ... below it1 into
+-- trace[segycal_windowns(it0, it1, step)], far away samples are not read >*/
+int segyread_onetrace_window(segyfile segyf, int* thead, float* trace, int it0, int it1,
+                             int step);
+
+/*< read the window [it0, it1) with stride step of the traces idx[n], only the
+-- header and window bytes are read, coalesced when traces are close together >*/
+size_t segyread_tracelist_window(segyfile segyf, const size_t* idx, size_t n, int* theads,
+                                 float* traces, int it0, int it1, int step, int nthreads);
+
 /*< write one trace from segy */
 int segywrite_onetrace(segyfile segyf, const int* thead, const float* trace);
 
+/*< read the next trace record (header and samples, nsegy bytes) into rec untouched >*/
+int segyread_onetrace_raw(segyfile segyf, char* rec);
+
+/*< write the record rec[nsegy] as the next trace, untouched >*/
+int segywrite_onetrace_raw(segyfile segyf, const char* rec);
+
+/*< read the records of traces [itr0, itr0 + n) into buf[n * nsegy] with one positional
+-- read, safe from several threads; return the number of records read >*/
+size_t segyread_traces_raw(segyfile segyf, size_t itr0, size_t n, char* buf);
+
+/*< write buf[n * nsegy] as the records of traces [itr0, itr0 + n), positional like
+-- segyread_traces_raw; return the number of records written >*/
+size_t segywrite_traces_raw(segyfile segyf, size_t itr0, size_t n, const char* buf);
+
 /*< convert char to value */
 void char2value(const char* chars, void* value, size_t off, const char* type);
 
 /*< convert value to char */
 void value2char(char* chars, void* value, size_t off, const char* type);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
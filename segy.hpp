@@ -0,0 +1,582 @@
+/* C++17 header-only layer over the SEGY C API: RAII handles, trace and gather
+   ranges, span buffers and compile-time sample codecs */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+#ifndef _segy_hpp
+#define _segy_hpp
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "segy.h"
+#include "segy_io.h"
+
+namespace esegy {
+
+/** a view of n contiguous elements, the subset of std::span used here */
+template <class T>
+class span {
+ public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using iterator = T*;
+
+  constexpr span() noexcept = default;
+  constexpr span(T* p, size_t n) noexcept : p_(p), n_(n) {}
+  template <class C, class = decltype(std::declval<C&>().data())>
+  constexpr span(C& c) noexcept : p_(c.data()), n_(c.size()) {}
+  /* span<const T> from span<T> */
+  template <class U, class = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+  constexpr span(const span<U>& s) noexcept : p_(s.data()), n_(s.size()) {}
+
+  constexpr T* data() const noexcept { return p_; }
+  constexpr size_t size() const noexcept { return n_; }
+  constexpr bool empty() const noexcept { return 0 == n_; }
+  constexpr T& operator[](size_t i) const noexcept { return p_[i]; }
+  constexpr T* begin() const noexcept { return p_; }
+  constexpr T* end() const noexcept { return p_ + n_; }
+  constexpr span subspan(size_t off, size_t n) const noexcept { return span(p_ + off, n); }
+
+ private:
+  T* p_ = nullptr;
+  size_t n_ = 0;
+};
+
+namespace detail {
+
+constexpr bool host_little = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+inline uint16_t load16(const char* p) {
+  uint16_t v;
+  std::memcpy(&v, p, 2);
+  return host_little ? __builtin_bswap16(v) : v;
+}
+
+inline uint32_t load32(const char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, 4);
+  return host_little ? __builtin_bswap32(v) : v;
+}
+
+inline void store16(char* p, uint16_t v) {
+  v = host_little ? __builtin_bswap16(v) : v;
+  std::memcpy(p, &v, 2);
+}
+
+inline void store32(char* p, uint32_t v) {
+  v = host_little ? __builtin_bswap32(v) : v;
+  std::memcpy(p, &v, 4);
+}
+
+constexpr size_t ibm_chunk = 256; /* samples converted through float at a time */
+
+}  // namespace detail
+
+/** compile-time codec of one on-disk sample format, decode and encode n samples
+    to and from the output type T with static_cast */
+template <int Format>
+struct codec;
+
+/* IBM float goes through the C converter, an IBM value always fits a float */
+template <>
+struct codec<1> {
+  static constexpr int bytes = 4;
+  template <class T>
+  static void decode(const char* raw, T* out, size_t n) {
+    if constexpr (std::is_same_v<T, float>) {
+      segy2trace(raw, out, (int)n, 1);
+    } else {
+      float tmp[detail::ibm_chunk];
+      for (size_t i0 = 0; i0 < n; i0 += detail::ibm_chunk) {
+        size_t m = n - i0 < detail::ibm_chunk ? n - i0 : detail::ibm_chunk;
+        segy2trace(raw + i0 * bytes, tmp, (int)m, 1);
+        for (size_t i = 0; i < m; i++)
+          out[i0 + i] = static_cast<T>(tmp[i]);
+      }
+    }
+  }
+  template <class T>
+  static void encode(const T* in, char* raw, size_t n) {
+    if constexpr (std::is_same_v<T, float>) {
+      trace2segy(raw, in, (int)n, 1);
+    } else {
+      float tmp[detail::ibm_chunk];
+      for (size_t i0 = 0; i0 < n; i0 += detail::ibm_chunk) {
+        size_t m = n - i0 < detail::ibm_chunk ? n - i0 : detail::ibm_chunk;
+        for (size_t i = 0; i < m; i++)
+          tmp[i] = static_cast<float>(in[i0 + i]);
+        trace2segy(raw + i0 * bytes, tmp, (int)m, 1);
+      }
+    }
+  }
+};
+
+/* 4 byte two's complement integer */
+template <>
+struct codec<2> {
+  static constexpr int bytes = 4;
+  template <class T>
+  static void decode(const char* raw, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      out[i] = static_cast<T>(static_cast<int32_t>(detail::load32(raw + i * bytes)));
+  }
+  template <class T>
+  static void encode(const T* in, char* raw, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      detail::store32(raw + i * bytes, static_cast<uint32_t>(static_cast<int32_t>(in[i])));
+  }
+};
+
+/* 2 byte two's complement integer, a byte swap only for int16_t */
+template <>
+struct codec<3> {
+  static constexpr int bytes = 2;
+  template <class T>
+  static void decode(const char* raw, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      out[i] = static_cast<T>(static_cast<int16_t>(detail::load16(raw + i * bytes)));
+  }
+  template <class T>
+  static void encode(const T* in, char* raw, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      detail::store16(raw + i * bytes, static_cast<uint16_t>(static_cast<int16_t>(in[i])));
+  }
+};
+
+/* 4 byte IEEE float, a byte swap only for float */
+template <>
+struct codec<5> {
+  static constexpr int bytes = 4;
+  template <class T>
+  static void decode(const char* raw, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      uint32_t u = detail::load32(raw + i * bytes);
+      float v;
+      std::memcpy(&v, &u, 4);
+      out[i] = static_cast<T>(v);
+    }
+  }
+  template <class T>
+  static void encode(const T* in, char* raw, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      float v = static_cast<float>(in[i]);
+      uint32_t u;
+      std::memcpy(&u, &v, 4);
+      detail::store32(raw + i * bytes, u);
+    }
+  }
+};
+
+/* 1 byte two's complement integer */
+template <>
+struct codec<8> {
+  static constexpr int bytes = 1;
+  template <class T>
+  static void decode(const char* raw, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      out[i] = static_cast<T>(static_cast<int8_t>(raw[i]));
+  }
+  template <class T>
+  static void encode(const T* in, char* raw, size_t n) {
+    for (size_t i = 0; i < n; i++)
+      raw[i] = static_cast<char>(static_cast<int8_t>(in[i]));
+  }
+};
+
+/** decode n samples of a runtime format, the loop is the compile-time codec */
+template <class T>
+void decode(int format, const char* raw, T* out, size_t n) {
+  switch (format) {
+    case 1: codec<1>::decode(raw, out, n); break;
+    case 2: codec<2>::decode(raw, out, n); break;
+    case 3: codec<3>::decode(raw, out, n); break;
+    case 5: codec<5>::decode(raw, out, n); break;
+    case 8: codec<8>::decode(raw, out, n); break;
+    default: throw std::runtime_error("esegy: unsupported format " + std::to_string(format));
+  }
+}
+
+/** encode n samples to a runtime format */
+template <class T>
+void encode(int format, const T* in, char* raw, size_t n) {
+  switch (format) {
+    case 1: codec<1>::encode(in, raw, n); break;
+    case 2: codec<2>::encode(in, raw, n); break;
+    case 3: codec<3>::encode(in, raw, n); break;
+    case 5: codec<5>::encode(in, raw, n); break;
+    case 8: codec<8>::encode(in, raw, n); break;
+    default: throw std::runtime_error("esegy: unsupported format " + std::to_string(format));
+  }
+}
+
+/** decode the samples of record rec of h, multiplied by 2^-N when h quantizes
+    (segyfile_set_quantize) */
+template <class T>
+void decode_record(segyfile h, const char* rec, T* out) {
+  int expo = segyquant_exponent(h, rec);
+  if (0 == expo) {
+    decode(h->format, rec + SEGY_THNBYTES, out, (size_t)h->ns);
+  } else if constexpr (std::is_same_v<T, float>) {
+    decode(h->format, rec + SEGY_THNBYTES, out, (size_t)h->ns);
+    segyquant_rescale(out, h->ns, expo);
+  } else {
+    std::vector<float> tmp((size_t)h->ns);
+    decode(h->format, rec + SEGY_THNBYTES, tmp.data(), tmp.size());
+    segyquant_rescale(tmp.data(), h->ns, expo);
+    for (size_t i = 0; i < tmp.size(); i++)
+      out[i] = static_cast<T>(tmp[i]);
+  }
+}
+
+/** encode the samples of record rec of h, its header in place, quantized when h
+    quantizes */
+template <class T>
+void encode_record(segyfile h, const T* in, char* rec) {
+  if (h->qkey < 0) {
+    encode(h->format, in, rec + SEGY_THNBYTES, (size_t)h->ns);
+  } else if constexpr (std::is_same_v<T, float>) {
+    segyquant_encode(h, rec, in);
+  } else {
+    std::vector<float> tmp(in, in + h->ns);
+    segyquant_encode(h, rec, tmp.data());
+  }
+}
+
+/** decoded trace header, indexed by key number or name */
+class header {
+ public:
+  int& operator[](int k) { return v_[k]; }
+  int operator[](int k) const { return v_[k]; }
+  int& operator[](const char* key) { return v_[segykey(key)]; }
+  int operator[](const char* key) const { return v_[segykey(key)]; }
+  int* data() { return v_.data(); }
+  const int* data() const { return v_.data(); }
+
+ private:
+  std::array<int, SEGY_THNKEYS> v_{};
+};
+
+template <class T>
+class trace_range;
+template <class T>
+class gather_range;
+
+/** an open SEGY file, closed when it goes out of scope */
+class file {
+ public:
+  /* open path for reading */
+  static file open(const std::string& path) {
+    FILE* fp = std::fopen(path.c_str(), "rb");
+    if (!fp)
+      throw std::runtime_error("esegy: cannot open " + path);
+    return file(fp, segyfile_init_read(fp));
+  }
+
+  /* create path for writing, write_headers() then write() the traces */
+  static file create(const std::string& path, int ns, float dt, int format,
+                     size_t ntrace = 0) {
+    FILE* fp = std::fopen(path.c_str(), "wb");
+    if (!fp)
+      throw std::runtime_error("esegy: cannot create " + path);
+    return file(fp, segyfile_init_write(fp, ns, dt, format, ntrace));
+  }
+
+  /* read from or write to any backend of segy_io.h, the file takes io over */
+  static file open(segy_io* io) { return file(nullptr, segyfile_init_read_io(io)); }
+  static file create(segy_io* io, int ns, float dt, int format, size_t ntrace = 0) {
+    return file(nullptr, segyfile_init_write_io(io, ns, dt, format, ntrace));
+  }
+
+  file(file&& o) noexcept
+      : fp_(std::exchange(o.fp_, nullptr)),
+        h_(std::exchange(o.h_, nullptr)),
+        rec_(std::move(o.rec_)) {}
+  file& operator=(file&& o) noexcept {
+    if (this != &o) {
+      close();
+      fp_ = std::exchange(o.fp_, nullptr);
+      h_ = std::exchange(o.h_, nullptr);
+      rec_ = std::move(o.rec_);
+    }
+    return *this;
+  }
+  file(const file&) = delete;
+  file& operator=(const file&) = delete;
+  ~file() { close(); }
+
+  segyfile handle() const { return h_; }
+  int ns() const { return h_->ns; }
+  int format() const { return h_->format; }
+  /* quantize integer samples with the exponent in header key k, -1 turns it off */
+  void set_quantize(int k) { segyfile_set_quantize(h_, k); }
+  float dt() const { return h_->dt; }
+  size_t ntrace() const { return h_->ntrace; }
+  size_t nsegy() const { return h_->nsegy; }
+
+  /* read the raw records of traces [itr0, itr0 + n) into buf[n * nsegy()] */
+  bool read_raw(size_t itr0, size_t n, char* buf) const {
+    int64_t off = (int64_t)(SEGY_EBCBYTES + SEGY_BHNBYTES) + (int64_t)(itr0 * h_->nsegy);
+    return segyio_read_at(h_->io, buf, n * h_->nsegy, off);
+  }
+
+  /* read trace itr, decoding ns() samples straight to out[ns()], h may be null;
+     the record goes through a buffer of the file, one reader per file at a time */
+  template <class T>
+  bool read(size_t itr, header* h, T* out) const {
+    if (itr >= h_->ntrace)
+      return false;
+    rec_.resize(h_->nsegy);
+    if (!read_raw(itr, 1, rec_.data()))
+      return false;
+    if (h)
+      segy2head(rec_.data(), h->data(), SEGY_THNKEYS);
+    decode_record(h_, rec_.data(), out);
+    return true;
+  }
+  template <class T>
+  bool read(size_t itr, header* h, span<T> out) const {
+    return out.size() >= (size_t)h_->ns && read(itr, h, out.data());
+  }
+
+  /* write the text header (as stored in handle()->textraw) and the binary header */
+  void write_headers() {
+    segywrite_texthead(h_, 0, 0);
+    segywrite_binaryhead(h_);
+  }
+
+  /* append one trace, encoding ns() samples from samples[ns()] */
+  template <class T>
+  bool write(const header& h, const T* samples) {
+    char* rec = h_->tracebuf;
+    std::memset(rec, 0, SEGY_THNBYTES);
+    head2segy(rec, h.data(), SEGY_THNKEYS);
+    encode_record(h_, samples, rec);
+    /* after the headers, on the stream of the backend if it has one, else its cursor */
+    return 1 == segywrite_onetrace_raw(h_, rec);
+  }
+  template <class T>
+  bool write(const header& h, span<T> samples) {
+    return samples.size() >= (size_t)h_->ns && write(h, samples.data());
+  }
+
+  /* all traces in file order, decoded to T block by block */
+  template <class T>
+  trace_range<T> traces(size_t block = 256) const;
+
+  /* runs of consecutive traces with the same value of header key, decoded to T */
+  template <class T>
+  gather_range<T> gathers(const char* key, size_t block = 256) const;
+
+ private:
+  file(FILE* fp, segyfile h) : fp_(fp), h_(h) {}
+  void close() {
+    if (h_)
+      segyfile_free(h_);
+    if (fp_)
+      std::fclose(fp_);
+    h_ = nullptr;
+    fp_ = nullptr;
+  }
+
+  FILE* fp_ = nullptr;
+  segyfile h_ = nullptr;
+  mutable std::vector<char> rec_;  // record buffer of read()
+};
+
+/** one trace seen by a trace_range, valid until the iterator moves */
+template <class T>
+struct trace_ref {
+  size_t index;
+  const header& head;
+  span<const T> samples;
+};
+
+namespace detail {
+
+/* reads traces in order with one pread per block and decodes them one at a time */
+template <class T>
+class cursor {
+ public:
+  cursor(const file* f, size_t block) : f_(f), block_(block > 0 ? block : 1) {
+    if (f_->ntrace() > 0)
+      raw_.resize(block_ * f_->nsegy());
+  }
+
+  /* decode trace itr into h and out[ns], false past the end, throws on a read error */
+  bool get(size_t itr, header& h, T* out) {
+    if (itr >= f_->ntrace())
+      return false;
+    if (itr < raw0_ || itr >= raw0_ + rawn_) {
+      raw0_ = itr;
+      rawn_ = f_->ntrace() - itr < block_ ? f_->ntrace() - itr : block_;
+      if (!f_->read_raw(raw0_, rawn_, raw_.data())) {
+        rawn_ = 0;
+        throw std::runtime_error("esegy: cannot read trace " + std::to_string(itr));
+      }
+    }
+    const char* rec = raw_.data() + (itr - raw0_) * f_->nsegy();
+    segy2head(const_cast<char*>(rec), h.data(), SEGY_THNKEYS);
+    decode_record(f_->handle(), rec, out);
+    return true;
+  }
+
+  const file* owner() const { return f_; }
+
+ private:
+  const file* f_;
+  size_t block_;
+  std::vector<char> raw_;
+  size_t raw0_ = 0, rawn_ = 0;
+};
+
+}  // namespace detail
+
+/** input range over all traces, for (auto t : f.traces<int16_t>()) */
+template <class T>
+class trace_range {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = trace_ref<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = trace_ref<T>;
+
+    iterator(trace_range* r, size_t itr) : r_(r), itr_(itr) { load(); }
+    trace_ref<T> operator*() const {
+      return {itr_, r_->head_, span<const T>(r_->samples_.data(), r_->samples_.size())};
+    }
+    iterator& operator++() {
+      ++itr_;
+      load();
+      return *this;
+    }
+    bool operator==(const iterator& o) const { return itr_ == o.itr_; }
+    bool operator!=(const iterator& o) const { return itr_ != o.itr_; }
+
+   private:
+    void load() {
+      if (r_ && itr_ < r_->end_ && !r_->cur_.get(itr_, r_->head_, r_->samples_.data()))
+        itr_ = r_->end_;
+    }
+    trace_range* r_;
+    size_t itr_;
+  };
+
+  trace_range(const file* f, size_t block)
+      : cur_(f, block), end_(f->ntrace()), samples_((size_t)f->ns()) {}
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(nullptr, end_); }
+
+ private:
+  detail::cursor<T> cur_;
+  size_t end_;
+  header head_;
+  std::vector<T> samples_;
+};
+
+/** one gather seen by a gather_range, valid until the iterator moves */
+template <class T>
+struct gather_ref {
+  int key;                   // header value shared by the gather
+  size_t first;              // first trace of the gather
+  span<const header> heads;  // heads.size() traces
+  span<const T> samples;     // heads.size() * ns samples
+};
+
+/** input range over runs of traces with the same key value */
+template <class T>
+class gather_range {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = gather_ref<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = gather_ref<T>;
+
+    iterator(gather_range* r, size_t first) : r_(r), first_(first) { load(); }
+    gather_ref<T> operator*() const {
+      const std::vector<header>& h = r_->heads_;
+      size_t n = r_->n_;
+      return {n > 0 ? h[0][r_->key_] : 0, first_, span<const header>(h.data(), n),
+              span<const T>(r_->samples_.data(), n * (size_t)r_->ns_)};
+    }
+    iterator& operator++() {
+      first_ += r_->n_;
+      load();
+      return *this;
+    }
+    bool operator==(const iterator& o) const { return first_ == o.first_; }
+    bool operator!=(const iterator& o) const { return first_ != o.first_; }
+
+   private:
+    void load() {
+      if (r_ && first_ < r_->end_ && 0 == r_->fill(first_))
+        first_ = r_->end_;
+    }
+    gather_range* r_;
+    size_t first_;
+  };
+
+  gather_range(const file* f, const char* key, size_t block)
+      : cur_(f, block), key_(segykey(key)), ns_(f->ns()), end_(f->ntrace()) {}
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(nullptr, end_); }
+
+ private:
+  /* decode the gather starting at trace first, return its trace count */
+  size_t fill(size_t first) {
+    n_ = 0;
+    for (size_t itr = first; itr < end_; itr++) {
+      if (heads_.size() <= n_) {
+        heads_.resize(n_ + 1);
+        samples_.resize((n_ + 1) * (size_t)ns_);
+      }
+      if (!cur_.get(itr, heads_[n_], samples_.data() + n_ * (size_t)ns_))
+        break;
+      if (n_ > 0 && heads_[n_][key_] != heads_[0][key_])
+        break;
+      n_++;
+    }
+    return n_;
+  }
+
+  detail::cursor<T> cur_;
+  int key_;
+  int ns_;
+  size_t end_;
+  size_t n_ = 0;
+  std::vector<header> heads_;
+  std::vector<T> samples_;
+};
+
+template <class T>
+trace_range<T> file::traces(size_t block) const {
+  return trace_range<T>(this, block);
+}
+
+template <class T>
+gather_range<T> file::gathers(const char* key, size_t block) const {
+  return gather_range<T>(this, key, block);
+}
+
+}  // namespace esegy
+
+#endif
@@ -0,0 +1,359 @@
+/* Bounded-memory LRU cache of decoded trace blocks */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_cache.h"
+#include "segy_internal.h"
+
+#define CACHE_NSHARD 16                    /* independently locked parts of the cache */
+#define CACHE_BUDGET ((size_t)256 << 20)   /* default memory budget */
+#define CACHE_BLOCK 64                     /* default traces per block */
+#define CACHE_QUEUE 8                      /* pending prefetch requests */
+#define CACHE_AHEAD 2                      /* blocks read ahead along a stride */
+
+enum { BLOCK_LOADING, BLOCK_READY };
+
+typedef struct cache_block {
+  size_t iblock;
+  size_t ntr;                  /* traces in the block, the last block may be short */
+  int state;                   /* BLOCK_LOADING or BLOCK_READY */
+  int* heads;                  /* ntr * SEGY_THNKEYS */
+  float* data;                 /* ntr * ns */
+  struct cache_block* hnext;   /* hash chain */
+  struct cache_block* prev;    /* LRU list, most recent first */
+  struct cache_block* next;
+} cache_block;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t loaded;
+  cache_block** bucket;
+  size_t nbucket;  /* power of two */
+  cache_block lru; /* list sentinel */
+  size_t nblock;
+  size_t maxblock;
+} cache_shard;
+
+struct segy_cache {
+  segyfile segyf;
+  size_t blocktraces;
+  size_t nblocks;    /* blocks in the file */
+  size_t blockbytes; /* bytes of one block */
+  cache_shard shard[CACHE_NSHARD];
+  segy_cache_stats st;
+
+  /* stride detection */
+  pthread_mutex_t predlock;
+  size_t lastblock;
+  long stride;
+
+  /* background prefetch */
+  int prefetch;
+  int stop;
+  pthread_t thread;
+  pthread_mutex_t qlock;
+  pthread_cond_t qcond;
+  size_t queue[CACHE_QUEUE];
+  int qhead, qn;
+};
+
+static inline cache_shard* cache_shardof(struct segy_cache* c, size_t b) {
+  return c->shard + b % CACHE_NSHARD;
+}
+
+static inline cache_block** cache_slot(cache_shard* sh, size_t b) {
+  return sh->bucket + ((b / CACHE_NSHARD) & (sh->nbucket - 1));
+}
+
+static cache_block* cache_find(cache_shard* sh, size_t b) {
+  cache_block* blk = *cache_slot(sh, b);
+  while (blk && blk->iblock != b)
+    blk = blk->hnext;
+  return blk;
+}
+
+static void cache_unhash(cache_shard* sh, cache_block* blk) {
+  cache_block** p = cache_slot(sh, blk->iblock);
+  while (*p != blk)
+    p = &(*p)->hnext;
+  *p = blk->hnext;
+}
+
+static void lru_unlink(cache_block* blk) {
+  blk->prev->next = blk->next;
+  blk->next->prev = blk->prev;
+}
+
+static void lru_front(cache_shard* sh, cache_block* blk) {
+  blk->prev = &sh->lru;
+  blk->next = sh->lru.next;
+  sh->lru.next->prev = blk;
+  sh->lru.next = blk;
+}
+
+/* a free block for b, reusing the least recently used ready block when the shard
+ is full; the new block is hashed, loading and most recent; the shard lock is held */
+static cache_block* cache_insert(struct segy_cache* c, cache_shard* sh, size_t b) {
+  cache_block* blk = NULL;
+  cache_block* v = sh->lru.prev;
+  while (sh->nblock >= sh->maxblock && v != &sh->lru) {
+    cache_block* prev = v->prev;
+    if (BLOCK_READY == v->state) {
+      cache_unhash(sh, v);
+      lru_unlink(v);
+      segy_stats_add(&c->st.evictions, 1);
+      /* keep one for reuse, free the others left over from a shard overflow */
+      if (blk) {
+        free(blk);
+        sh->nblock--;
+      }
+      blk = v;
+      if (sh->nblock <= sh->maxblock)
+        break;
+    }
+    v = prev;
+  }
+  if (!blk) {
+    /* over the budget only while every block of the shard is loading */
+    blk = (cache_block*)malloc(c->blockbytes);
+    if (!blk)
+      errorinfo("malloc failed for cache block");
+    blk->heads = (int*)(blk + 1);
+    blk->data = (float*)(blk->heads + c->blocktraces * SEGY_THNKEYS);
+    sh->nblock++;
+  }
+  blk->iblock = b;
+  blk->ntr = b + 1 < c->nblocks ? c->blocktraces
+                                : c->segyf->ntrace - b * c->blocktraces;
+  blk->state = BLOCK_LOADING;
+  cache_block** slot = cache_slot(sh, b);
+  blk->hnext = *slot;
+  *slot = blk;
+  lru_front(sh, blk);
+  return blk;
+}
+
+/* read and decode a loading block without holding the shard lock */
+static int cache_load(struct segy_cache* c, cache_block* blk) {
+  size_t* idx = (size_t*)malloc(sizeof(size_t) * blk->ntr);
+  if (!idx)
+    errorinfo("malloc failed for cache block index");
+  for (size_t j = 0; j < blk->ntr; j++)
+    idx[j] = blk->iblock * c->blocktraces + j;
+  size_t n = segyread_tracelist(c->segyf, idx, blk->ntr, blk->heads, blk->data, 1);
+  free(idx);
+  return n == blk->ntr;
+}
+
+/* publish a loaded block, or drop it on a read error; the shard lock is held */
+static void cache_loaded(cache_shard* sh, cache_block* blk, int ok) {
+  if (ok) {
+    blk->state = BLOCK_READY;
+  } else {
+    cache_unhash(sh, blk);
+    lru_unlink(blk);
+    sh->nblock--;
+    free(blk);
+  }
+  pthread_cond_broadcast(&sh->loaded);
+}
+
+/* queue the blocks ahead of b when the last two accesses had the same stride */
+static void cache_predict(struct segy_cache* c, size_t b) {
+  long ahead[CACHE_AHEAD];
+  int nahead = 0;
+  pthread_mutex_lock(&c->predlock);
+  long d = (long)b - (long)c->lastblock;
+  if (d != 0) {
+    if (d == c->stride)
+      for (int i = 1; i <= CACHE_AHEAD; i++)
+        ahead[nahead++] = (long)b + i * d;
+    c->stride = d;
+    c->lastblock = b;
+  }
+  pthread_mutex_unlock(&c->predlock);
+  if (0 == nahead)
+    return;
+
+  pthread_mutex_lock(&c->qlock);
+  for (int i = 0; i < nahead; i++)
+    if (ahead[i] >= 0 && (size_t)ahead[i] < c->nblocks && c->qn < CACHE_QUEUE)
+      c->queue[(c->qhead + c->qn++) % CACHE_QUEUE] = (size_t)ahead[i];
+  pthread_cond_signal(&c->qcond);
+  pthread_mutex_unlock(&c->qlock);
+}
+
+static void* cache_prefetcher(void* arg) {
+  struct segy_cache* c = (struct segy_cache*)arg;
+  for (;;) {
+    pthread_mutex_lock(&c->qlock);
+    while (!c->stop && 0 == c->qn)
+      pthread_cond_wait(&c->qcond, &c->qlock);
+    if (c->stop) {
+      pthread_mutex_unlock(&c->qlock);
+      return NULL;
+    }
+    size_t b = c->queue[c->qhead];
+    c->qhead = (c->qhead + 1) % CACHE_QUEUE;
+    c->qn--;
+    pthread_mutex_unlock(&c->qlock);
+
+    cache_shard* sh = cache_shardof(c, b);
+    pthread_mutex_lock(&sh->lock);
+    if (cache_find(sh, b)) {
+      pthread_mutex_unlock(&sh->lock);
+      continue;
+    }
+    cache_block* blk = cache_insert(c, sh, b);
+    pthread_mutex_unlock(&sh->lock);
+    int ok = cache_load(c, blk);
+    pthread_mutex_lock(&sh->lock);
+    cache_loaded(sh, blk, ok);
+    pthread_mutex_unlock(&sh->lock);
+    segy_stats_add(&c->st.prefetches, 1);
+  }
+}
+
+int segyfile_cache_enable(segyfile segyf, size_t membudget, int blocktraces, int prefetch) {
+  if (segyf->cache)
+    segyfile_cache_disable(segyf);
+  struct segy_cache* c = (struct segy_cache*)calloc(1, sizeof(struct segy_cache));
+  if (!c)
+    errorinfo("malloc failed for trace cache");
+  c->segyf = segyf;
+  c->blocktraces = blocktraces > 0 ? (size_t)blocktraces : CACHE_BLOCK;
+  c->nblocks = (segyf->ntrace + c->blocktraces - 1) / c->blocktraces;
+  c->blockbytes = sizeof(cache_block) +
+                  c->blocktraces * (sizeof(int) * SEGY_THNKEYS + sizeof(float) * segyf->ns);
+  if (0 == membudget)
+    membudget = CACHE_BUDGET;
+  size_t maxblock = membudget / c->blockbytes;
+  if (maxblock < CACHE_NSHARD)
+    maxblock = CACHE_NSHARD;
+
+  for (int i = 0; i < CACHE_NSHARD; i++) {
+    cache_shard* sh = c->shard + i;
+    pthread_mutex_init(&sh->lock, NULL);
+    pthread_cond_init(&sh->loaded, NULL);
+    sh->maxblock = maxblock / CACHE_NSHARD;
+    sh->nbucket = 1;
+    while (sh->nbucket < 2 * sh->maxblock)
+      sh->nbucket <<= 1;
+    sh->bucket = (cache_block**)calloc(sh->nbucket, sizeof(cache_block*));
+    if (!sh->bucket)
+      errorinfo("malloc failed for cache buckets");
+    sh->lru.prev = sh->lru.next = &sh->lru;
+  }
+  pthread_mutex_init(&c->predlock, NULL);
+  pthread_mutex_init(&c->qlock, NULL);
+  pthread_cond_init(&c->qcond, NULL);
+  c->lastblock = (size_t)-1;
+  if (prefetch && 0 == pthread_create(&c->thread, NULL, cache_prefetcher, c))
+    c->prefetch = 1;
+  segyf->cache = c;
+  return 1;
+}
+
+void segy_cache_free(struct segy_cache* c) {
+  if (!c)
+    return;
+  if (c->prefetch) {
+    pthread_mutex_lock(&c->qlock);
+    c->stop = 1;
+    pthread_cond_signal(&c->qcond);
+    pthread_mutex_unlock(&c->qlock);
+    pthread_join(c->thread, NULL);
+  }
+  for (int i = 0; i < CACHE_NSHARD; i++) {
+    cache_shard* sh = c->shard + i;
+    cache_block* blk = sh->lru.next;
+    while (blk != &sh->lru) {
+      cache_block* next = blk->next;
+      free(blk);
+      blk = next;
+    }
+    free(sh->bucket);
+    pthread_cond_destroy(&sh->loaded);
+    pthread_mutex_destroy(&sh->lock);
+  }
+  pthread_cond_destroy(&c->qcond);
+  pthread_mutex_destroy(&c->qlock);
+  pthread_mutex_destroy(&c->predlock);
+  free(c);
+}
+
+void segyfile_cache_disable(segyfile segyf) {
+  segy_cache_free(segyf->cache);
+  segyf->cache = NULL;
+}
+
+int segyread_trace_cached(segyfile segyf, size_t itr, int* thead, float* trace) {
+  struct segy_cache* c = segyf->cache;
+  if (itr >= segyf->ntrace)
+    return 0;
+  if (!c)
+    return 1 == segyread_tracelist(segyf, &itr, 1, thead, trace, 1);
+
+  size_t b = itr / c->blocktraces, j = itr % c->blocktraces;
+  cache_shard* sh = cache_shardof(c, b);
+  pthread_mutex_lock(&sh->lock);
+  cache_block* blk;
+  while ((blk = cache_find(sh, b)) && BLOCK_LOADING == blk->state)
+    pthread_cond_wait(&sh->loaded, &sh->lock);
+
+  int ok = 1;
+  if (blk) {
+    segy_stats_add(&c->st.hits, 1);
+    lru_unlink(blk);
+    lru_front(sh, blk);
+  } else {
+    segy_stats_add(&c->st.misses, 1);
+    blk = cache_insert(c, sh, b);
+    pthread_mutex_unlock(&sh->lock);
+    ok = cache_load(c, blk);
+    pthread_mutex_lock(&sh->lock);
+    cache_loaded(sh, blk, ok);
+  }
+  if (ok) {
+    if (thead)
+      memcpy(thead, blk->heads + j * SEGY_THNKEYS, sizeof(int) * SEGY_THNKEYS);
+    if (trace)
+      memcpy(trace, blk->data + j * segyf->ns, sizeof(float) * segyf->ns);
+  }
+  pthread_mutex_unlock(&sh->lock);
+
+  if (c->prefetch)
+    cache_predict(c, b);
+  return ok;
+}
+
+int segyfile_cache_stats(segyfile segyf, segy_cache_stats* st) {
+  struct segy_cache* c = segyf->cache;
+  memset(st, 0, sizeof(*st));
+  if (!c)
+    return 0;
+  st->hits = __atomic_load_n(&c->st.hits, __ATOMIC_RELAXED);
+  st->misses = __atomic_load_n(&c->st.misses, __ATOMIC_RELAXED);
+  st->prefetches = __atomic_load_n(&c->st.prefetches, __ATOMIC_RELAXED);
+  st->evictions = __atomic_load_n(&c->st.evictions, __ATOMIC_RELAXED);
+  for (int i = 0; i < CACHE_NSHARD; i++) {
+    pthread_mutex_lock(&c->shard[i].lock);
+    st->nblock += c->shard[i].nblock;
+    pthread_mutex_unlock(&c->shard[i].lock);
+  }
+  st->bytes = st->nblock * c->blockbytes;
+  return 1;
+}
@@ -0,0 +1,33 @@
+/* Bounded-memory LRU cache of decoded trace blocks */
+#ifndef _segy_cache_h
+#define _segy_cache_h
+
+#include <stdint.h>
+#include "segy.h"
+
+/** cache counters */
+typedef struct {
+  uint64_t hits;        // traces served from a cached block
+  uint64_t misses;      // traces whose block had to be read
+  uint64_t prefetches;  // blocks read ahead by the prefetcher
+  uint64_t evictions;   // blocks dropped to stay in the budget
+  size_t nblock;        // blocks cached now
+  size_t bytes;         // bytes of the cached blocks
+} segy_cache_stats;
+
+/*< attach a cache of decoded blocks of blocktraces traces (0 means 64) to segyf,
+-- holding at most membudget bytes (0 means 256MB), a detected access stride
+-- is read ahead in the background when prefetch is set, return 1 on success >*/
+int segyfile_cache_enable(segyfile segyf, size_t membudget, int blocktraces, int prefetch);
+
+/*< drop the cache of segyf >*/
+void segyfile_cache_disable(segyfile segyf);
+
+/*< read trace itr through the cache, thead or trace may be NULL, safe to call from
+-- many threads, without a cache the trace is read directly; return 1 on success >*/
+int segyread_trace_cached(segyfile segyf, size_t itr, int* thead, float* trace);
+
+/*< copy the cache counters, return 0 if no cache is attached >*/
+int segyfile_cache_stats(segyfile segyf, segy_cache_stats* st);
+
+#endif
@@ -0,0 +1,693 @@
+/* Conversion between SEGY and headerless float32 or Seismic Unix files */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "segy.h"
+#include "segy_conv.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+
+#define CONV_BATCHBYTES (8 << 20) /* bytes of the larger side of one batch */
+
+/* little-endian int32 and float32 of the raw and header table files */
+static inline void put_le32(char* p, uint32_t v) {
+#if !HOST_LITTLE_ENDIAN
+  v = bswap32(v);
+#endif
+  memcpy(p, &v, 4);
+}
+
+static inline uint32_t get_le32(const char* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+#if !HOST_LITTLE_ENDIAN
+  v = bswap32(v);
+#endif
+  return v;
+}
+
+typedef struct conv_job conv_job;
+
+/* convert n records of traces [itr0, itr0 + n), the header table rows are read from
+   or written to hbuf */
+typedef void (*conv_fn)(const conv_job* job, const char* src, char* dst, char* hbuf,
+                        size_t itr0, size_t n);
+
+struct conv_job {
+  segy_io* in;
+  int64_t in0;   /* bytes before the first record */
+  size_t inrec;  /* bytes of one record */
+  segy_io* out;
+  int64_t out0;
+  size_t outrec;
+  segy_io* heads;  /* header table, NULL if none */
+  int headsin;     /* 1 if the table is read, 0 if written */
+  int ns;
+  int format;      /* of the SEGY side */
+  int dtus;        /* sample interval in microseconds */
+  int to;          /* SEGY_CONV_* of the other side */
+  segyfile segyf;  /* the SEGY side, for its sample quantization */
+  int nkey;
+  const int* keys;
+  int koff[SEGY_THNKEYS];  /* byte offset and size of every trace header key */
+  int ksize[SEGY_THNKEYS];
+  int kns, kdt;
+  conv_fn fn;
+};
+
+static void conv_keys(conv_job* job, const int* keys, int nkey) {
+  for (int k = 0; k < SEGY_THNKEYS; k++) {
+    job->koff[k] = segy_keyoffset(k);
+    job->ksize[k] = segy_keysize(k);
+  }
+  job->kns = segykey("ns");
+  job->kdt = segykey("dt");
+  job->keys = keys;
+  job->nkey = keys ? nkey : SEGY_THNKEYS;
+}
+
+/* value of key k of a big-endian or native header */
+static inline int32_t conv_get(const conv_job* job, const char* h, int k, int native) {
+  const char* p = h + job->koff[k];
+  if (2 == job->ksize[k]) {
+    int16_t v;
+    if (native)
+      memcpy(&v, p, 2);
+    else
+      v = (int16_t)get16(p);
+    return v;
+  }
+  int32_t v;
+  if (native)
+    memcpy(&v, p, 4);
+  else
+    v = (int32_t)get32(p);
+  return v;
+}
+
+static inline void conv_put(const conv_job* job, char* h, int k, int32_t v, int native) {
+  char* p = h + job->koff[k];
+  if (2 == job->ksize[k]) {
+    int16_t s = (int16_t)v;
+    if (native)
+      memcpy(p, &s, 2);
+    else
+      put16(p, (uint16_t)s);
+  } else if (native) {
+    memcpy(p, &v, 4);
+  } else {
+    put32(p, (uint32_t)v);
+  }
+}
+
+/* the SEGY header h as SU header su, or back; only the byte order of every field
+   changes, an unset ns or dt is filled in */
+static void conv_head(const conv_job* job, const char* h, char* su, int tosu) {
+  for (int k = 0; k < SEGY_THNKEYS; k++)
+    conv_put(job, su, k, conv_get(job, h, k, !tosu), tosu);
+  if (0 == conv_get(job, su, job->kns, tosu))
+    conv_put(job, su, job->kns, job->ns, tosu);
+  if (0 == conv_get(job, su, job->kdt, tosu))
+    conv_put(job, su, job->kdt, job->dtus, tosu);
+}
+
+/* samples of SEGY record rec to native float32 */
+static void conv_samples_in(const conv_job* job, const char* rec, float* d) {
+  const char* s = rec + SEGY_THNBYTES;
+  if (5 == job->format) {
+    for (int i = 0; i < job->ns; i++) {
+      uint32_t w = get32(s + 4 * i); /* only a byte swap */
+      memcpy(d + i, &w, 4);
+    }
+  } else {
+    segy2trace(s, d, job->ns, job->format);
+    segyquant_rescale(d, job->ns, segyquant_exponent(job->segyf, rec));
+  }
+}
+
+/* native float32 to the samples of SEGY record rec, its header is in place */
+static void conv_samples_out(const conv_job* job, const float* s, char* rec) {
+  char* d = rec + SEGY_THNBYTES;
+  if (5 == job->format) {
+    for (int i = 0; i < job->ns; i++) {
+      uint32_t w;
+      memcpy(&w, s + i, 4);
+      put32(d + 4 * i, w);
+    }
+  } else {
+    segyquant_encode(job->segyf, rec, s);
+  }
+}
+
+static void conv_export(const conv_job* job, const char* src, char* dst, char* hbuf,
+                        size_t itr0, size_t n) {
+  (void)itr0;
+  for (size_t j = 0; j < n; j++) {
+    const char* rec = src + j * job->inrec;
+    char* out = dst + j * job->outrec;
+    if (SEGY_CONV_SU == job->to) {
+      conv_head(job, rec, out, 1);
+      conv_samples_in(job, rec, (float*)(out + SEGY_THNBYTES));
+    } else {
+      float* d = (float*)out;
+      conv_samples_in(job, rec, d);
+#if !HOST_LITTLE_ENDIAN
+      for (int i = 0; i < job->ns; i++) {
+        uint32_t w;
+        memcpy(&w, d + i, 4);
+        put_le32(out + 4 * i, w);
+      }
+#endif
+    }
+    if (hbuf) {
+      char* row = hbuf + j * 4 * (size_t)job->nkey;
+      for (int i = 0; i < job->nkey; i++)
+        put_le32(row + 4 * i, (uint32_t)conv_get(job, rec, job->keys ? job->keys[i] : i, 0));
+    }
+  }
+}
+
+static void conv_import(const conv_job* job, const char* src, char* dst, char* hbuf,
+                        size_t itr0, size_t n) {
+  float* tmp = NULL;
+#if !HOST_LITTLE_ENDIAN
+  tmp = (float*)malloc(sizeof(float) * job->ns);
+  if (!tmp)
+    errorinfo("malloc failed for conversion buffers");
+#endif
+  for (size_t j = 0; j < n; j++) {
+    const char* rec = src + j * job->inrec;
+    char* out = dst + j * job->outrec;
+    if (SEGY_CONV_SU == job->to) {
+      conv_head(job, rec, out, 0);
+      conv_samples_out(job, (const float*)(rec + SEGY_THNBYTES), out);
+      continue;
+    }
+    memset(out, 0, SEGY_THNBYTES);
+    int tracl = 0;
+    if (hbuf) {
+      const char* row = hbuf + j * 4 * (size_t)job->nkey;
+      for (int i = 0; i < job->nkey; i++) {
+        int k = job->keys ? job->keys[i] : i;
+        conv_put(job, out, k, (int32_t)get_le32(row + 4 * i), 0);
+        tracl |= 0 == k;
+      }
+    }
+    if (!tracl)
+      conv_put(job, out, 0, (int32_t)(itr0 + j + 1), 0);
+    if (0 == conv_get(job, out, job->kns, 0))
+      conv_put(job, out, job->kns, job->ns, 0);
+    if (0 == conv_get(job, out, job->kdt, 0))
+      conv_put(job, out, job->kdt, job->dtus, 0);
+    const float* s = (const float*)rec;
+#if !HOST_LITTLE_ENDIAN
+    for (int i = 0; i < job->ns; i++) {
+      uint32_t w = get_le32(rec + 4 * i);
+      memcpy(tmp + i, &w, 4);
+    }
+    s = tmp;
+#endif
+    conv_samples_out(job, s, out);
+  }
+  free(tmp);
+}
+
+/* convert ntrace records in parallel batches, every batch is read and written at its
+   own offsets so the threads never wait for each other; return the traces done before
+   the first batch that failed */
+static size_t conv_run(const conv_job* job, size_t ntrace, int nthreads) {
+  size_t big = job->inrec > job->outrec ? job->inrec : job->outrec;
+  size_t batch = CONV_BATCHBYTES / big > 0 ? CONV_BATCHBYTES / big : 1;
+  nthreads = segy_nthreads(nthreads);
+  if (batch * nthreads > ntrace)
+    batch = (ntrace + nthreads - 1) / nthreads;
+  if (0 == batch)
+    return 0;
+  size_t nbatch = (ntrace + batch - 1) / batch;
+  size_t hrec = 4 * (size_t)job->nkey;
+  size_t firstbad = nbatch;
+  segyio_hint(job->in, job->in0, (int64_t)(ntrace * job->inrec), SEGY_IO_SEQUENTIAL);
+
+#pragma omp parallel num_threads(nthreads)
+  {
+    char* src = (char*)malloc(batch * job->inrec);
+    char* dst = (char*)malloc(batch * job->outrec);
+    char* hbuf = job->heads ? (char*)malloc(batch * hrec) : NULL;
+    if (!src || !dst || (job->heads && !hbuf))
+      errorinfo("malloc failed for conversion buffers");
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t ib = 0; ib < nbatch; ib++) {
+      /* batches before a failed one still run, they are part of the result */
+      int skip;
+#pragma omp critical(conv_fail)
+      skip = ib > firstbad;
+      if (skip)
+        continue;
+      size_t i0 = ib * batch;
+      size_t nb = i0 + batch > ntrace ? ntrace - i0 : batch;
+      int ok = segyio_read_at(job->in, src, nb * job->inrec, job->in0 + (int64_t)(i0 * job->inrec));
+      if (ok && hbuf && job->headsin)
+        ok = segyio_read_at(job->heads, hbuf, nb * hrec, (int64_t)(i0 * hrec));
+      if (ok) {
+        job->fn(job, src, dst, hbuf, i0, nb);
+        ok = segyio_write_at(job->out, dst, nb * job->outrec,
+                             job->out0 + (int64_t)(i0 * job->outrec));
+      }
+      if (ok && hbuf && !job->headsin)
+        ok = segyio_write_at(job->heads, hbuf, nb * hrec, (int64_t)(i0 * hrec));
+      if (!ok) {
+#pragma omp critical(conv_fail)
+        firstbad = ib < firstbad ? ib : firstbad;
+      }
+    }
+    free(src);
+    free(dst);
+    free(hbuf);
+  }
+  size_t ndone = firstbad < nbatch ? firstbad * batch : ntrace;
+  if (firstbad < nbatch)
+    warninginfo("conversion: I/O error, %zu of %zu traces converted", ndone, ntrace);
+  return ndone;
+}
+
+static int conv_format_ok(int format) {
+  if (1 == format || 2 == format || 3 == format || 5 == format || 8 == format)
+    return 1;
+  warninginfo("conversion: unsupported SEGY format %d", format);
+  return 0;
+}
+
+size_t segyconv_export(segyfile in, segy_io* out, int to, segy_io* heads, const int* keys,
+                       int nkey, int nthreads) {
+  if (!conv_format_ok(in->format))
+    return 0;
+  conv_job job;
+  memset(&job, 0, sizeof(job));
+  conv_keys(&job, keys, nkey);
+  job.in = in->io;
+  job.in0 = SEGY_EBCBYTES + SEGY_BHNBYTES;
+  job.inrec = in->nsegy;
+  job.out = out;
+  job.out0 = 0;
+  job.outrec = (SEGY_CONV_SU == to ? SEGY_THNBYTES : 0) + 4 * (size_t)in->ns;
+  job.heads = heads;
+  job.headsin = 0;
+  job.ns = in->ns;
+  job.format = in->format;
+  job.segyf = in;
+  job.dtus = (int)get16(in->bhraw + SEGY_BH_DT);
+  job.to = to;
+  job.fn = conv_export;
+  size_t n = conv_run(&job, in->ntrace, nthreads);
+  segy_count_traces_read(in, n);
+  return n;
+}
+
+size_t segyconv_import(segy_io* in, int from, segy_io* heads, const int* keys, int nkey,
+                       segyfile out, int nthreads) {
+  if (!conv_format_ok(out->format))
+    return 0;
+  conv_job job;
+  memset(&job, 0, sizeof(job));
+  conv_keys(&job, keys, nkey);
+  job.in = in;
+  job.in0 = 0;
+  job.inrec = (SEGY_CONV_SU == from ? SEGY_THNBYTES : 0) + 4 * (size_t)out->ns;
+  job.out = out->io;
+  job.out0 = SEGY_EBCBYTES + SEGY_BHNBYTES;
+  job.outrec = out->nsegy;
+  job.heads = SEGY_CONV_SU == from ? NULL : heads;
+  job.headsin = 1;
+  job.ns = out->ns;
+  job.format = out->format;
+  job.segyf = out;
+  job.dtus = out->bhead[segybhkey("hdt")];
+  job.to = from;
+  job.fn = conv_import;
+
+  int64_t size = segyio_size(in);
+  size_t ntrace = size > 0 ? (size_t)size / job.inrec : 0;
+  if (size > 0 && (size_t)size % job.inrec)
+    warninginfo("conversion: %zu bytes after the last complete trace are ignored",
+                (size_t)size % job.inrec);
+
+  segy_seek(out, 0, SEEK_SET);
+  segywrite_texthead(out, 0, 0);
+  segywrite_binaryhead(out);
+  segyio_flush(out->io, 0);
+  size_t n = conv_run(&job, ntrace, nthreads);
+  out->ntrace = n;
+  segy_count_traces_written(out, n);
+  segy_seek(out, segy_trace_offset(out, n), SEEK_SET);
+  return n;
+}
+
+int segyconv_su_info(segy_io* in, int* ns, float* dt) {
+  char h[SEGY_THNBYTES];
+  if (!segyio_read_at(in, h, SEGY_THNBYTES, 0))
+    return 0;
+  uint16_t n, d;
+  memcpy(&n, h + 114, 2);
+  memcpy(&d, h + 116, 2);
+  if (0 == n)
+    return 0;
+  *ns = n;
+  *dt = d / 1000000.0f;
+  return 1;
+}
+
+/* In-place conversion between IBM and IEEE samples, both 4 bytes wide. The file is
+   converted in rounds of CONV_ROUNDBYTES held in memory. Before a round is written
+   back, the marker records it with two hashes, before and after the conversion, of
+   every unit: the part of a batch inside one 4 KiB page of the file, the piece a crash
+   leaves either old or new. A restart checks the units of the round in flight and
+   converts those still old; the binary header format is written after the last round,
+   then the marker is removed. */
+
+#define CONV_ROUNDBYTES (256 << 20) /* bytes converted between two markers */
+#define CONV_UNITBYTES 4096
+#define CONV_MAGIC "ESEGYCV1"
+#define CONV_HEADBYTES 64
+
+typedef struct {
+  segyfile segyf;
+  int from, to;
+  size_t batch;     /* traces per batch */
+  size_t t0, t1;    /* traces of the round */
+  char* buf;        /* the records of the round */
+  size_t nbatch;
+  size_t* ustart;   /* first unit of each batch, nbatch + 1 */
+  uint64_t* hash;   /* old and new hash of each unit */
+} conv_round;
+
+static uint64_t conv_hash(const char* p, size_t n) {
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t w;
+    memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0x100000001b3ULL;
+    h ^= h >> 29;
+  }
+  for (; i < n; i++)
+    h = (h ^ (unsigned char)p[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+/* convert the samples in the file bytes [a, b) held by buf from file offset base */
+static void conv_range(const conv_round* r, char* buf, int64_t base, int64_t a, int64_t b,
+                       float* f) {
+  segyfile segyf = r->segyf;
+  int64_t d0 = segy_trace_offset(segyf, 0);
+  int64_t nsegy = (int64_t)segyf->nsegy;
+  for (int64_t o = a; o < b;) {
+    int64_t rec = d0 + (o - d0) / nsegy * nsegy;
+    int64_t lo = rec + SEGY_THNBYTES > o ? rec + SEGY_THNBYTES : o;
+    int64_t hi = rec + nsegy < b ? rec + nsegy : b;
+    if (lo < hi) {
+      char* p = buf + (lo - base);
+      int n = (int)((hi - lo) / 4);
+      segy2trace(p, f, n, r->from);
+      trace2segy(p, f, n, r->to);
+    }
+    o = rec + nsegy;
+  }
+}
+
+/* byte range of batch ib and its units */
+static void conv_batch_range(const conv_round* r, size_t ib, int64_t* a, int64_t* b) {
+  size_t i0 = r->t0 + ib * r->batch;
+  size_t i1 = i0 + r->batch < r->t1 ? i0 + r->batch : r->t1;
+  *a = segy_trace_offset(r->segyf, i0);
+  *b = segy_trace_offset(r->segyf, i1);
+}
+
+static size_t conv_nunit(int64_t a, int64_t b) {
+  return (size_t)((b - 1) / CONV_UNITBYTES - a / CONV_UNITBYTES + 1);
+}
+
+static void conv_round_setup(conv_round* r, size_t t0, size_t t1) {
+  r->t0 = t0;
+  r->t1 = t1;
+  r->nbatch = (t1 - t0 + r->batch - 1) / r->batch;
+  size_t nu = 0;
+  for (size_t ib = 0; ib < r->nbatch; ib++) {
+    int64_t a, b;
+    conv_batch_range(r, ib, &a, &b);
+    r->ustart[ib] = nu;
+    nu += conv_nunit(a, b);
+  }
+  r->ustart[r->nbatch] = nu;
+}
+
+/* make a rename in the directory of path durable, return 1 on success */
+static int conv_sync_dir(const char* path) {
+  char dir[4096];
+  const char* slash = strrchr(path, '/');
+  if (!slash)
+    snprintf(dir, sizeof(dir), ".");
+  else if (slash == path)
+    snprintf(dir, sizeof(dir), "/");
+  else
+    snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+  int fd = open(dir, O_RDONLY | O_DIRECTORY);
+  if (fd < 0)
+    return 0;
+  int ok = 0 == fsync(fd);
+  close(fd);
+  return ok;
+}
+
+/* write the marker of the round to a temporary file and rename it over the old one */
+static int conv_marker_save(const conv_round* r, const char* marker) {
+  char tmp[4096];
+  FILE* fp = snprintf(tmp, sizeof(tmp), "%s.tmp", marker) < (int)sizeof(tmp) ? fopen(tmp, "wb")
+                                                                            : NULL;
+  if (!fp) {
+    warninginfo("conversion: cannot create %s", tmp);
+    return 0;
+  }
+  segyfile segyf = r->segyf;
+  size_t nu = r->ustart[r->nbatch];
+  char head[CONV_HEADBYTES];
+  memset(head, 0, sizeof(head));
+  memcpy(head, CONV_MAGIC, 8);
+  put32(head + 8, (uint32_t)r->from);
+  put32(head + 12, (uint32_t)r->to);
+  put32(head + 16, (uint32_t)segyf->ns);
+  put64(head + 24, (uint64_t)segyf->ntrace);
+  put64(head + 32, (uint64_t)segyio_size(segyf->io));
+  put64(head + 40, (uint64_t)r->t0);
+  put64(head + 48, (uint64_t)r->t1);
+  put64(head + 56, (uint64_t)nu);
+  int ok = 1 == fwrite(head, CONV_HEADBYTES, 1, fp);
+  char rec[16 * 256];
+  for (size_t i0 = 0; ok && i0 < nu; i0 += 256) {
+    size_t m = nu - i0 < 256 ? nu - i0 : 256;
+    for (size_t j = 0; j < m; j++) {
+      put64(rec + 16 * j, r->hash[2 * (i0 + j)]);
+      put64(rec + 16 * j + 8, r->hash[2 * (i0 + j) + 1]);
+    }
+    ok = m == fwrite(rec, 16, m, fp);
+  }
+  ok = ok && 0 == fflush(fp) && 0 == fsync(fileno(fp));
+  if (fclose(fp))
+    ok = 0;
+  /* the marker must be in place before the round is written over the samples */
+  ok = ok && 0 == rename(tmp, marker) && conv_sync_dir(marker);
+  if (!ok)
+    warninginfo("conversion: error writing %s", marker);
+  return ok;
+}
+
+/* read the marker of the round in flight into r, return 0 if there is none, -1 if it
+   belongs to another file or conversion */
+static int conv_marker_load(conv_round* r, const char* marker, size_t maxunit) {
+  FILE* fp = fopen(marker, "rb");
+  if (!fp)
+    return 0;
+  segyfile segyf = r->segyf;
+  char head[CONV_HEADBYTES];
+  int ok = 1 == fread(head, CONV_HEADBYTES, 1, fp) && !memcmp(head, CONV_MAGIC, 8) &&
+           (int)get32(head + 8) == r->from && (int)get32(head + 12) == r->to &&
+           (int)get32(head + 16) == segyf->ns && get64(head + 24) == segyf->ntrace &&
+           get64(head + 32) == (uint64_t)segyio_size(segyf->io) &&
+           get64(head + 40) < get64(head + 48) && get64(head + 48) <= segyf->ntrace;
+  if (ok) {
+    conv_round_setup(r, get64(head + 40), get64(head + 48));
+    ok = get64(head + 56) == r->ustart[r->nbatch] && r->ustart[r->nbatch] <= maxunit;
+  }
+  char rec[16];
+  for (size_t u = 0; ok && u < r->ustart[r->nbatch]; u++) {
+    ok = 1 == fread(rec, 16, 1, fp);
+    r->hash[2 * u] = get64(rec);
+    r->hash[2 * u + 1] = get64(rec + 8);
+  }
+  fclose(fp);
+  if (!ok)
+    warninginfo("conversion: %s is not a marker of this file and conversion", marker);
+  return ok ? 1 : -1;
+}
+
+/* read the round, then convert it (fresh, the hashes are computed) or finish what a
+   stopped run left (resume, units still old are converted); return 0 on errors */
+static int conv_round_convert(conv_round* r, int resume, int nthreads) {
+  segyfile segyf = r->segyf;
+  int64_t base = segy_trace_offset(segyf, r->t0);
+  int failed = 0;
+
+#pragma omp parallel num_threads(nthreads)
+  {
+    float* f = (float*)malloc(sizeof(float) * segyf->ns);
+    if (!f)
+      errorinfo("malloc failed for conversion buffers");
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t ib = 0; ib < r->nbatch; ib++) {
+      int64_t a, b;
+      conv_batch_range(r, ib, &a, &b);
+      char* p = r->buf + (a - base);
+      if (failed || !segy_read_at(segyf, p, (size_t)(b - a), a)) {
+        failed = 1;
+        continue;
+      }
+      uint64_t t0 = SEGY_TIC(segyf);
+      uint64_t* h = r->hash + 2 * r->ustart[ib];
+      for (int64_t u0 = a; u0 < b; h += 2) {
+        int64_t u1 = (u0 / CONV_UNITBYTES + 1) * CONV_UNITBYTES;
+        u1 = u1 < b ? u1 : b;
+        uint64_t now = conv_hash(r->buf + (u0 - base), (size_t)(u1 - u0));
+        if (!resume) {
+          h[0] = now;
+          conv_range(r, r->buf, base, u0, u1, f);
+          h[1] = conv_hash(r->buf + (u0 - base), (size_t)(u1 - u0));
+        } else if (now == h[0] && now != h[1]) {
+          conv_range(r, r->buf, base, u0, u1, f);
+        } else if (now != h[1]) {
+          warninginfo("conversion: bytes %lld to %lld are neither old nor new", (long long)u0,
+                      (long long)u1);
+          failed = 1;
+        }
+        u0 = u1;
+      }
+      segy_count_sample(segyf, (size_t)((b - a) / segyf->nsegy), t0);
+    }
+    free(f);
+  }
+  return !failed;
+}
+
+static int conv_round_write(conv_round* r, int nthreads) {
+  segyfile segyf = r->segyf;
+  int64_t base = segy_trace_offset(segyf, r->t0);
+  int failed = 0;
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+  for (size_t ib = 0; ib < r->nbatch; ib++) {
+    int64_t a, b;
+    conv_batch_range(r, ib, &a, &b);
+    if (!failed && !segy_write_at(segyf, r->buf + (a - base), (size_t)(b - a), a))
+      failed = 1;
+  }
+  if (failed || !segyio_flush(segyf->io, 1)) {
+    warninginfo("conversion: error writing traces %zu to %zu", r->t0, r->t1);
+    return 0;
+  }
+  return 1;
+}
+
+int segyconv_inplace(const char* path, int format, const char* marker, int nthreads) {
+  char defmarker[4096];
+  if (!marker) {
+    snprintf(defmarker, sizeof(defmarker), "%s.conv", path);
+    marker = defmarker;
+  }
+  if (1 != format && 5 != format) {
+    warninginfo("conversion: in place only between format 1 and 5, not to %d", format);
+    return 0;
+  }
+  segy_io* io = segyio_open(path, "r+");
+  if (!io)
+    return 0;
+  segyfile segyf = segyfile_init_read_io(io);
+  if (segyf->format == format) {
+    /* done, or stopped after the binary header was written */
+    remove(marker);
+    segyfile_free(segyf);
+    return 1;
+  }
+  if (1 != segyf->format && 5 != segyf->format) {
+    warninginfo("conversion: in place only between format 1 and 5, not from %d", segyf->format);
+    segyfile_free(segyf);
+    return 0;
+  }
+
+  conv_round r;
+  memset(&r, 0, sizeof(r));
+  r.segyf = segyf;
+  r.from = segyf->format;
+  r.to = format;
+  r.batch = CONV_BATCHBYTES / segyf->nsegy > 0 ? CONV_BATCHBYTES / segyf->nsegy : 1;
+  size_t round = CONV_ROUNDBYTES / segyf->nsegy > 0 ? CONV_ROUNDBYTES / segyf->nsegy : 1;
+  round = (round + r.batch - 1) / r.batch * r.batch;
+  if (round > segyf->ntrace)
+    round = segyf->ntrace;
+  size_t maxbatch = round > 0 ? (round + r.batch - 1) / r.batch : 0;
+  size_t maxunit = round * segyf->nsegy / CONV_UNITBYTES + 2 * maxbatch;
+  r.buf = (char*)malloc(round * segyf->nsegy + 1);
+  r.ustart = (size_t*)malloc(sizeof(size_t) * (maxbatch + 1));
+  r.hash = (uint64_t*)malloc(sizeof(uint64_t) * 2 * (maxunit + 1));
+  if (!r.buf || !r.ustart || !r.hash)
+    errorinfo("malloc failed for conversion buffers");
+  nthreads = segy_nthreads(nthreads);
+  segyio_hint(segyf->io, segy_trace_offset(segyf, 0),
+              (int64_t)(segyf->ntrace * segyf->nsegy), SEGY_IO_SEQUENTIAL);
+
+  size_t next = 0;
+  int ok = 1;
+  int found = conv_marker_load(&r, marker, maxunit);
+  if (found < 0) {
+    ok = 0;
+  } else if (found > 0) {
+    ok = conv_round_convert(&r, 1, nthreads) && conv_round_write(&r, nthreads);
+    next = r.t1;
+    if (ok)
+      warninginfo("conversion: resumed %s after trace %zu", path, r.t0);
+  }
+  for (; ok && next < segyf->ntrace; next = r.t1) {
+    conv_round_setup(&r, next, next + round < segyf->ntrace ? next + round : segyf->ntrace);
+    ok = conv_round_convert(&r, 0, nthreads) && conv_marker_save(&r, marker) &&
+         conv_round_write(&r, nthreads);
+  }
+
+  if (ok) {
+    /* the format is the last byte to change, then the marker goes */
+    char bh[SEGY_BHNBYTES];
+    ok = segy_read_at(segyf, bh, SEGY_BHNBYTES, SEGY_EBCBYTES);
+    put16(bh + 24, (uint16_t)format); /* bytes 3225-3226 */
+    ok = ok && segy_write_at(segyf, bh, SEGY_BHNBYTES, SEGY_EBCBYTES) &&
+         segyio_flush(segyf->io, 1);
+    if (ok)
+      remove(marker);
+    else
+      warninginfo("conversion: cannot write the binary header of %s", path);
+  }
+  free(r.buf);
+  free(r.ustart);
+  free(r.hash);
+  segyfile_free(segyf);
+  return ok;
+}
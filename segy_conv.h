@@ -0,0 +1,39 @@
+/* Conversion between SEGY and headerless float32 or Seismic Unix files */
+#ifndef _segy_conv_h
+#define _segy_conv_h
+
+#include "segy.h"
+#include "segy_io.h"
+
+enum {
+  SEGY_CONV_RAW = 0, /* headerless little-endian float32 samples, ns per trace */
+  SEGY_CONV_SU = 1,  /* Seismic Unix: native-endian 240 bytes header and float32 samples */
+};
+
+/*< convert all traces of in to out as SEGY_CONV_RAW or SEGY_CONV_SU in parallel
+-- batches; heads may be NULL, else it gets a little-endian int32 row of keys[nkey]
+-- per trace (all SEGY_THNKEYS keys in order if keys is NULL); IEEE samples are only
+-- byte swapped; return the traces converted before the first I/O error >*/
+size_t segyconv_export(segyfile in, segy_io* out, int to, segy_io* heads, const int* keys,
+                       int nkey, int nthreads);
+
+/*< convert the SEGY_CONV_RAW or SEGY_CONV_SU file in to out, a segyfile made by
+-- segyfile_init_write_io whose text and binary headers are written here; raw files
+-- take their trace headers from heads (rows of keys[nkey] as written by
+-- segyconv_export) when it is not NULL; return the traces converted before the first
+-- I/O error, the trace count of out >*/
+size_t segyconv_import(segy_io* in, int from, segy_io* heads, const int* keys, int nkey,
+                       segyfile out, int nthreads);
+
+/*< samples per trace and sample interval (seconds) in the first header of a SU file,
+-- return 0 if it has none >*/
+int segyconv_su_info(segy_io* in, int* ns, float* dt);
+
+/*< convert the samples of the SEGY file at path in place between IBM (format 1) and
+-- IEEE (format 5), in large blocks over nthreads threads with positional reads and
+-- writes; the binary header format is written last; the resume marker (path.conv when
+-- NULL) holds the round in flight, the same call restarts a run that stopped; return
+-- 1 when the file is in format >*/
+int segyconv_inplace(const char* path, int format, const char* marker, int nthreads);
+
+#endif
@@ -0,0 +1,195 @@
+/* Raw trace copies between SEGY files */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#define _GNU_SOURCE /* copy_file_range */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include "segy.h"
+#include "segy_copy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_patch.h"
+
+#define COPY_BUFBYTES (8 << 20) /* buffered copies move this much per write */
+
+enum { COPY_RANGE, COPY_SENDFILE, COPY_BUFFER };
+
+int segycopy_headers(segyfile in, segyfile out) {
+  memcpy(out->textraw, in->textraw, SEGY_EBCBYTES);
+  memcpy(out->bhraw, in->bhraw, SEGY_BHNBYTES);
+  segy2bhead(out->bhraw, out->bhead, SEGY_BHNKEYS);
+  char head[SEGY_EBCBYTES + SEGY_BHNBYTES];
+  /* the bytes of the file, the caller may have converted textraw from EBCDIC */
+  if (!segy_read_at(in, head, sizeof(head), 0))
+    return 0;
+  segyio_flush(out->io, 0);
+  return segy_write_at(out, head, sizeof(head), 0);
+}
+
+/* move len bytes from infd at soff to outfd at doff in the kernel, the method may
+   step down to the next one when the kernel or the file systems refuse it; return the
+   bytes moved */
+static size_t copy_kernel(int infd, int64_t soff, int outfd, int64_t doff, size_t len,
+                          int* method) {
+  size_t done = 0;
+#ifdef __linux__
+  while (done < len && COPY_RANGE == *method) {
+    loff_t s = (loff_t)(soff + done), d = (loff_t)(doff + done);
+    ssize_t m = copy_file_range(infd, &s, outfd, &d, len - done, 0);
+    if (m > 0)
+      done += (size_t)m;
+    else if (m < 0 && EINTR == errno)
+      continue;
+    else if (m < 0 && (ENOSYS == errno || EXDEV == errno || EINVAL == errno ||
+                       EOPNOTSUPP == errno || EBADF == errno))
+      *method = COPY_SENDFILE;
+    else
+      return done;
+  }
+  if (done < len && COPY_SENDFILE == *method) {
+    if (lseek(outfd, (off_t)(doff + done), SEEK_SET) < 0) {
+      *method = COPY_BUFFER;
+      return done;
+    }
+    while (done < len) {
+      off_t s = (off_t)(soff + done);
+      ssize_t m = sendfile(outfd, infd, &s, len - done);
+      if (m > 0)
+        done += (size_t)m;
+      else if (m < 0 && EINTR == errno)
+        continue;
+      else {
+        if (m < 0 && (ENOSYS == errno || EINVAL == errno))
+          *method = COPY_BUFFER;
+        break;
+      }
+    }
+  }
+#else
+  (void)infd;
+  (void)soff;
+  (void)outfd;
+  (void)doff;
+  (void)len;
+  *method = COPY_BUFFER;
+#endif
+  return done;
+}
+
+size_t segycopy_traces(segyfile in, const size_t* idx, size_t n, segyfile out, size_t oitr0,
+                       const segy_patch* patch, segy_copy_result* res) {
+  segy_copy_result r;
+  memset(&r, 0, sizeof(r));
+  if (in->ns != out->ns || in->format != out->format) {
+    warninginfo("copy: ns %d format %d can not be copied raw to ns %d format %d", in->ns,
+                in->format, out->ns, out->format);
+    if (res)
+      *res = r;
+    return 0;
+  }
+  size_t nsegy = in->nsegy;
+  segyio_flush(out->io, 0); /* the stream may still hold the headers */
+  int method = !patch && in->io->fd >= 0 && out->io->fd >= 0 ? COPY_RANGE : COPY_BUFFER;
+
+  size_t bufn = COPY_BUFBYTES / nsegy > 0 ? COPY_BUFBYTES / nsegy : 1;
+  char* buf = NULL;
+  size_t nbuf = 0;   /* records in buf, they go to out from trace oitr0 + ncopied */
+  size_t ncopied = 0;
+  int failed = 0;
+
+  for (size_t j = 0; j < n && !failed;) {
+    if (idx[j] >= in->ntrace) {
+      warninginfo("copy: trace %zu is past the %zu traces of the input", idx[j], in->ntrace);
+      break;
+    }
+    /* a run of consecutive input traces */
+    size_t m = 1;
+    while (j + m < n && idx[j + m] == idx[j] + m && idx[j + m] < in->ntrace)
+      m++;
+
+    if (COPY_BUFFER != method) {
+      uint64_t t0 = SEGY_TIC(in);
+      size_t len = m * nsegy;
+      size_t done = copy_kernel(in->io->fd, segy_trace_offset(in, idx[j]), out->io->fd,
+                                segy_trace_offset(out, oitr0 + ncopied), len, &method);
+      segy_count_read(in, done, t0);
+      segy_count_write(out, done, t0);
+      r.zerocopy += done;
+      size_t full = done / nsegy;
+      segy_count_traces_read(in, full);
+      segy_count_traces_written(out, full);
+      ncopied += full;
+      j += full;
+      if (done == len)
+        continue;
+      if (COPY_BUFFER != method) {
+        failed = 1;
+        break;
+      }
+      /* the rest of the run goes through the buffer */
+      m -= full;
+      r.zerocopy -= done - full * nsegy;
+    }
+
+    if (!buf) {
+      buf = (char*)malloc(bufn * nsegy);
+      if (!buf)
+        errorinfo("malloc failed for copy buffer");
+    }
+    while (m > 0 && !failed) {
+      size_t k = bufn - nbuf < m ? bufn - nbuf : m;
+      if (k != segyread_traces_raw(in, idx[j], k, buf + nbuf * nsegy)) {
+        failed = 1;
+        break;
+      }
+      nbuf += k;
+      j += k;
+      m -= k;
+      if (nbuf == bufn) {
+        if (patch)
+          r.nclamped += segypatch_headers(patch, buf, nsegy, nbuf);
+        if (nbuf != segywrite_traces_raw(out, oitr0 + ncopied, nbuf, buf))
+          failed = 1;
+        else
+          ncopied += nbuf;
+        r.buffered += nbuf * nsegy;
+        nbuf = 0;
+      }
+    }
+  }
+  if (nbuf > 0 && !failed) {
+    if (patch)
+      r.nclamped += segypatch_headers(patch, buf, nsegy, nbuf);
+    if (nbuf != segywrite_traces_raw(out, oitr0 + ncopied, nbuf, buf))
+      failed = 1;
+    else
+      ncopied += nbuf;
+    r.buffered += nbuf * nsegy;
+  }
+  free(buf);
+  if (failed)
+    warninginfo("copy: error after %zu of %zu traces", ncopied, n);
+
+  if (oitr0 + ncopied > out->ntrace)
+    out->ntrace = oitr0 + ncopied;
+  segy_seek(out, segy_trace_offset(out, oitr0 + ncopied), SEEK_SET);
+  r.ntrace = ncopied;
+  if (res)
+    *res = r;
+  return ncopied;
+}
@@ -0,0 +1,28 @@
+/* Raw trace copies between SEGY files */
+#ifndef _segy_copy_h
+#define _segy_copy_h
+
+#include <stdint.h>
+#include "segy.h"
+#include "segy_patch.h"
+
+/** how a copy moved its bytes */
+typedef struct {
+  uint64_t ntrace;     // traces copied
+  uint64_t zerocopy;   // bytes moved in the kernel by copy_file_range or sendfile
+  uint64_t buffered;   // bytes moved through user space buffers
+  uint64_t nclamped;   // patched header values clamped to their key range
+} segy_copy_result;
+
+/*< write the text and binary headers of in to out byte for byte, return 1 on success >*/
+int segycopy_headers(segyfile in, segyfile out);
+
+/*< copy the records of traces idx[n] of in, undecoded, to the traces [oitr0, oitr0 + n)
+-- of out; in and out must have the same ns and format; runs of consecutive traces go
+-- file to file with copy_file_range (sendfile, then large buffered copies as fallbacks);
+-- patch may be NULL, else it is applied to the headers on the way, which needs the
+-- buffered copy; out is left after the last trace copied; return the traces copied >*/
+size_t segycopy_traces(segyfile in, const size_t* idx, size_t n, segyfile out, size_t oitr0,
+                       const segy_patch* patch, segy_copy_result* res);
+
+#endif
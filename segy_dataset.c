@@ -0,0 +1,280 @@
+/* Multi-file SEGY datasets with a global trace index */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <glob.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_dataset.h"
+#include "segy_expr.h"
+#include "segy_htab.h"
+#include "segy_internal.h"
+#include "segy_select.h"
+
+#define DS_MAXOPEN 64 /* default bound of open files */
+
+/* open file i, the dataset lock is held */
+static void ds_openfile(segy_dataset* ds, int i) {
+  segyds_file* f = ds->files + i;
+  f->fp = fopen(f->path, "rb");
+  if (!f->fp)
+    errorinfo("dataset: cannot open %s", f->path);
+  f->segyf = segyfile_init_read(f->fp);
+  ds->nopen++;
+}
+
+/* close file i, the dataset lock is held */
+static void ds_closefile(segy_dataset* ds, int i) {
+  segyds_file* f = ds->files + i;
+  segyfile_free(f->segyf);
+  fclose(f->fp);
+  f->segyf = NULL;
+  f->fp = NULL;
+  ds->nopen--;
+}
+
+/* open file i if needed and mark it used, closing the least recently used
+ idle file when maxopen files are already open */
+static segyfile ds_acquire(segy_dataset* ds, int i) {
+  pthread_mutex_lock(&ds->lock);
+  while (!ds->files[i].segyf && ds->nopen >= ds->maxopen) {
+    int lru = -1;
+    for (int j = 0; j < ds->nfile; j++) {
+      segyds_file* f = ds->files + j;
+      if (f->segyf && 0 == f->nuse && (lru < 0 || f->lastuse < ds->files[lru].lastuse))
+        lru = j;
+    }
+    if (lru >= 0)
+      ds_closefile(ds, lru);
+    else
+      pthread_cond_wait(&ds->freed, &ds->lock);
+  }
+  if (!ds->files[i].segyf)
+    ds_openfile(ds, i);
+  ds->files[i].nuse++;
+  ds->files[i].lastuse = ++ds->clock;
+  segyfile segyf = ds->files[i].segyf;
+  pthread_mutex_unlock(&ds->lock);
+  return segyf;
+}
+
+static void ds_release(segy_dataset* ds, int i) {
+  pthread_mutex_lock(&ds->lock);
+  ds->files[i].nuse--;
+  pthread_cond_broadcast(&ds->freed);
+  pthread_mutex_unlock(&ds->lock);
+}
+
+segy_dataset* segyds_open(const char* const* paths, int npath, int maxopen) {
+  if (npath < 1)
+    errorinfo("dataset: no file");
+  segy_dataset* ds = (segy_dataset*)calloc(1, sizeof(segy_dataset));
+  if (!ds)
+    errorinfo("malloc failed for dataset");
+  ds->files = (segyds_file*)calloc(npath, sizeof(segyds_file));
+  if (!ds->files)
+    errorinfo("malloc failed for dataset files");
+  ds->nfile = npath;
+  ds->maxopen = maxopen > 0 ? maxopen : DS_MAXOPEN;
+  pthread_mutex_init(&ds->lock, NULL);
+  pthread_cond_init(&ds->freed, NULL);
+
+  for (int i = 0; i < npath; i++) {
+    segyds_file* f = ds->files + i;
+    f->path = strdup(paths[i]);
+    if (!f->path)
+      errorinfo("malloc failed for dataset path");
+    if (ds->nopen >= ds->maxopen)
+      ds_closefile(ds, i - 1);
+    ds_openfile(ds, i);
+    f->lastuse = ++ds->clock;
+
+    if (0 == i) {
+      ds->ns = f->segyf->ns;
+      ds->format = f->segyf->format;
+      ds->dt = f->segyf->dt;
+      ds->nsegy = f->segyf->nsegy;
+    } else if (f->segyf->ns != ds->ns || f->segyf->format != ds->format) {
+      errorinfo("dataset: %s has ns %d format %d, %s has ns %d format %d", f->path,
+                f->segyf->ns, f->segyf->format, ds->files[0].path, ds->ns, ds->format);
+    }
+    f->ntrace = f->segyf->ntrace;
+    f->first = ds->ntrace;
+    ds->ntrace += f->ntrace;
+  }
+  return ds;
+}
+
+segy_dataset* segyds_open_glob(const char* pattern, int maxopen) {
+  glob_t g;
+  if (0 != glob(pattern, 0, NULL, &g) || 0 == g.gl_pathc)
+    errorinfo("dataset: no file matches %s", pattern);
+  segy_dataset* ds = segyds_open((const char* const*)g.gl_pathv, (int)g.gl_pathc, maxopen);
+  globfree(&g);
+  return ds;
+}
+
+void segyds_close(segy_dataset* ds) {
+  if (ds) {
+    for (int i = 0; i < ds->nfile; i++) {
+      if (ds->files[i].segyf)
+        ds_closefile(ds, i);
+      free(ds->files[i].path);
+    }
+    pthread_cond_destroy(&ds->freed);
+    pthread_mutex_destroy(&ds->lock);
+    free(ds->files);
+    free(ds);
+  }
+}
+
+int segyds_locate(const segy_dataset* ds, size_t gidx, int* ifile, size_t* itrace) {
+  if (gidx >= ds->ntrace)
+    return 0;
+  /* last file whose first trace is <= gidx, skipping empty files */
+  int lo = 0, hi = ds->nfile - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (ds->files[mid].first <= gidx)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  while (gidx - ds->files[lo].first >= ds->files[lo].ntrace)
+    lo++;
+  *ifile = lo;
+  *itrace = gidx - ds->files[lo].first;
+  return 1;
+}
+
+size_t segyds_read_tracelist(segy_dataset* ds, const size_t* gidx, size_t n, int* theads,
+                             float* traces, int nthreads) {
+  size_t* local = (size_t*)malloc(sizeof(size_t) * (n > 0 ? n : 1));
+  if (!local)
+    errorinfo("malloc failed for dataset trace list");
+  size_t nread = 0;
+  size_t k = 0;
+  while (k < n) {
+    int ifile;
+    size_t itr;
+    if (!segyds_locate(ds, gidx[k], &ifile, &itr)) {
+      k++;
+      continue;
+    }
+    /* consecutive entries in the same file form one group */
+    size_t m = 0;
+    const segyds_file* f = ds->files + ifile;
+    while (k + m < n && gidx[k + m] >= f->first && gidx[k + m] - f->first < f->ntrace) {
+      local[m] = gidx[k + m] - f->first;
+      m++;
+    }
+    segyfile segyf = ds_acquire(ds, ifile);
+    nread += segyread_tracelist(segyf, local, m,
+                                theads ? theads + k * SEGY_THNKEYS : NULL,
+                                traces ? traces + k * (size_t)ds->ns : NULL, nthreads);
+    ds_release(ds, ifile);
+    k += m;
+  }
+  free(local);
+  return nread;
+}
+
+int segyds_read_trace(segy_dataset* ds, size_t gidx, int* thead, float* trace) {
+  return 1 == segyds_read_tracelist(ds, &gidx, 1, thead, trace, 1);
+}
+
+/* files run in parallel when there are at least as many files as threads,
+ otherwise one file at a time with all threads */
+static void ds_split_threads(const segy_dataset* ds, int nthreads, int* outer, int* inner) {
+  nthreads = segy_nthreads(nthreads);
+  *outer = ds->nfile >= nthreads ? nthreads : 1;
+  *inner = *outer > 1 ? 1 : nthreads;
+}
+
+segy_htable* segyds_htab_read(segy_dataset* ds, const int* keys, int nkey, int flags,
+                              int nthreads) {
+  segy_htable* tab = segyhtab_alloc(ds->ntrace, keys, nkey, flags);
+  int outer, inner;
+  ds_split_threads(ds, nthreads, &outer, &inner);
+  size_t nscan = 0;
+
+#pragma omp parallel for num_threads(outer) schedule(dynamic, 1) reduction(+ : nscan)
+  for (int i = 0; i < ds->nfile; i++) {
+    segyds_file* f = ds->files + i;
+    void** cols = (void**)malloc(sizeof(void*) * (nkey > 0 ? nkey : 1));
+    if (!cols)
+      errorinfo("malloc failed for dataset header table");
+    segy_htable view = *tab;
+    view.itr0 = 0;
+    view.ntrace = f->ntrace;
+    view.cols = cols;
+    for (int ic = 0; ic < nkey; ic++) {
+      size_t esize = tab->isdouble[ic] ? sizeof(double) : sizeof(int32_t);
+      cols[ic] = (char*)tab->cols[ic] + f->first * esize;
+    }
+    segyfile segyf = ds_acquire(ds, i);
+    nscan += segyhtab_fill(segyf, &view, inner);
+    ds_release(ds, i);
+    free(cols);
+  }
+  if (nscan != ds->ntrace) {
+    warninginfo("dataset header table: read %zu of %zu headers, the table is empty", nscan,
+                ds->ntrace);
+    tab->ntrace = 0;
+  }
+  return tab;
+}
+
+segy_selection* segyds_select(segy_dataset* ds, const char* expr, int nthreads) {
+  segy_expr* e = segyexpr_parse(expr);
+  if (!e)
+    return NULL;
+  segy_selection** part =
+      (segy_selection**)calloc(ds->nfile, sizeof(segy_selection*));
+  if (!part)
+    errorinfo("malloc failed for dataset selection");
+  int outer, inner;
+  ds_split_threads(ds, nthreads, &outer, &inner);
+
+#pragma omp parallel for num_threads(outer) schedule(dynamic, 1)
+  for (int i = 0; i < ds->nfile; i++) {
+    segyfile segyf = ds_acquire(ds, i);
+    part[i] = segyselect_expr(segyf, e, inner);
+    ds_release(ds, i);
+  }
+  segyexpr_free(e);
+
+  segy_selection* sel = (segy_selection*)calloc(1, sizeof(segy_selection));
+  size_t nword = (ds->ntrace + 63) / 64;
+  if (!sel)
+    errorinfo("malloc failed for dataset selection");
+  sel->ntrace = ds->ntrace;
+  for (int i = 0; i < ds->nfile; i++)
+    sel->n += part[i]->n;
+  sel->idx = (size_t*)malloc(sizeof(size_t) * (sel->n > 0 ? sel->n : 1));
+  sel->bitmap = (uint64_t*)calloc(nword > 0 ? nword : 1, sizeof(uint64_t));
+  if (!sel->idx || !sel->bitmap)
+    errorinfo("malloc failed for dataset selection");
+  size_t k = 0;
+  for (int i = 0; i < ds->nfile; i++) {
+    for (size_t j = 0; j < part[i]->n; j++) {
+      size_t g = ds->files[i].first + part[i]->idx[j];
+      sel->idx[k++] = g;
+      sel->bitmap[g / 64] |= (uint64_t)1 << (g % 64);
+    }
+    segyselect_free(part[i]);
+  }
+  free(part);
+  return sel;
+}
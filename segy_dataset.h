@@ -0,0 +1,68 @@
+/* Multi-file SEGY datasets with a global trace index */
+#ifndef _segy_dataset_h
+#define _segy_dataset_h
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "segy.h"
+#include "segy_htab.h"
+#include "segy_select.h"
+
+/** one file of a dataset */
+typedef struct {
+  char* path;
+  size_t ntrace;     // traces in this file
+  size_t first;      // global index of its first trace
+  FILE* fp;          // NULL while the file is closed
+  segyfile segyf;    // NULL while the file is closed
+  int nuse;          // readers currently using the file
+  uint64_t lastuse;  // clock of the last use, for the LRU
+} segyds_file;
+
+/** files with the same ns and format seen as one trace sequence */
+typedef struct {
+  int nfile;
+  segyds_file* files;
+  int ns;              // samples per trace, common to all files
+  int format;          // sample format, common to all files
+  float dt;            // sample interval of the first file
+  size_t nsegy;        // bytes per trace
+  size_t ntrace;       // traces of all files
+  int maxopen;         // most files open at once
+  int nopen;           // files open now
+  uint64_t clock;      // LRU clock
+  pthread_mutex_t lock;
+  pthread_cond_t freed;
+} segy_dataset;
+
+/*< open the files paths[npath] as one dataset, keeping at most maxopen files
+-- open at once (0 means 64), exit if ns or format differ between files >*/
+segy_dataset* segyds_open(const char* const* paths, int npath, int maxopen);
+
+/*< open the files matching a glob pattern, in sorted name order >*/
+segy_dataset* segyds_open_glob(const char* pattern, int maxopen);
+
+/*< close all files and free the dataset >*/
+void segyds_close(segy_dataset* ds);
+
+/*< file and local trace of global trace gidx, return 0 if out of range >*/
+int segyds_locate(const segy_dataset* ds, size_t gidx, int* ifile, size_t* itrace);
+
+/*< read global trace gidx, return 1 on success >*/
+int segyds_read_trace(segy_dataset* ds, size_t gidx, int* thead, float* trace);
+
+/*< read the global traces gidx[n] with coalesced reads into theads[n][SEGY_THNKEYS]
+-- and traces[n][ns] (either may be NULL), return the number of traces read >*/
+size_t segyds_read_tracelist(segy_dataset* ds, const size_t* gidx, size_t n, int* theads,
+                             float* traces, int nthreads);
+
+/*< columnar header table of all traces, rows are global indexes,
+-- files are scanned in parallel when there are enough of them, no rows if a read fails >*/
+segy_htable* segyds_htab_read(segy_dataset* ds, const int* keys, int nkey, int flags,
+                              int nthreads);
+
+/*< select global traces with a header predicate, see segyselect >*/
+segy_selection* segyds_select(segy_dataset* ds, const char* expr, int nthreads);
+
+#endif
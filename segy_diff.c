@@ -0,0 +1,302 @@
+/* Comparison of two SEGY files with sample tolerances and a header key mask */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "segy.h"
+#include "segy_diff.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+
+#define DIFF_BATCHBYTES (8 << 20) /* bytes of the larger side of one batch */
+#define DIFF_BHFORMAT 24           /* byte of the sample format in the binary header */
+
+void segydiff_opts_init(segy_diff_opts* o) {
+  memset(o, 0, sizeof(*o));
+  memset(o->keymask, 1, sizeof(o->keymask));
+  o->maxreport = 20;
+}
+
+/* what one thread found, the items are in trace order because every thread takes
+   its batches in increasing order */
+typedef struct {
+  size_t nidentical, nwithin, nheader, nsample;
+  uint64_t nsample_bad;
+  double maxabs, maxrel;
+  size_t itr_maxabs;
+  size_t nitem;
+  segy_diff_item* item;  /* maxreport entries */
+} diff_part;
+
+static void diff_add(diff_part* t, size_t cap, size_t itr, int kind, int index, double a,
+                     double b, size_t count) {
+  if (t->nitem >= cap)
+    return;
+  segy_diff_item* it = &t->item[t->nitem++];
+  it->itr = itr;
+  it->kind = kind;
+  it->index = index;
+  it->a = a;
+  it->b = b;
+  it->count = count;
+}
+
+/* compare the decoded samples of one trace, return the samples beyond the tolerance */
+static size_t diff_samples(diff_part* t, const segy_diff_opts* o, const float* fa,
+                           const float* fb, int ns, size_t itr, size_t cap) {
+  size_t nbad = 0;
+  int first = -1;
+  for (int j = 0; j < ns; j++) {
+    double a = fa[j], b = fb[j];
+    if (a == b || (isnan(a) && isnan(b)))
+      continue;
+    double d = fabs(a - b);
+    double m = fmax(fabs(a), fabs(b));
+    if (isnan(d) || isinf(d)) {
+      d = INFINITY; /* a NaN or infinity against a number is always beyond */
+    } else {
+      if (d > t->maxabs) {
+        t->maxabs = d;
+        t->itr_maxabs = itr;
+      }
+      if (m > 0 && d / m > t->maxrel)
+        t->maxrel = d / m;
+    }
+    if (isinf(d) || d > o->atol + o->rtol * m) {
+      if (first < 0)
+        first = j;
+      nbad++;
+    }
+  }
+  if (nbad)
+    diff_add(t, cap, itr, SEGY_DIFF_SAMPLE, first, fa[first], fb[first], nbad);
+  return nbad;
+}
+
+/* compare the masked keys of one trace header, return 1 if any differs */
+static int diff_header(diff_part* t, const segy_diff_opts* o, const char* ra,
+                       const char* rb, size_t itr, size_t cap) {
+  int ha[SEGY_THNKEYS], hb[SEGY_THNKEYS];
+  segy2head((char*)ra, ha, SEGY_THNKEYS);
+  segy2head((char*)rb, hb, SEGY_THNKEYS);
+  int differ = 0;
+  for (int k = 0; k < SEGY_THNKEYS; k++)
+    if (o->keymask[k] && ha[k] != hb[k]) {
+      differ = 1;
+      diff_add(t, cap, itr, SEGY_DIFF_HEADER, k, ha[k], hb[k], 1);
+    }
+  return differ;
+}
+
+static int diff_item_cmp(const void* x, const void* y) {
+  const segy_diff_item* a = (const segy_diff_item*)x;
+  const segy_diff_item* b = (const segy_diff_item*)y;
+  if (a->itr != b->itr)
+    return a->itr < b->itr ? -1 : 1;
+  if (a->kind != b->kind)
+    return a->kind - b->kind;
+  return a->index - b->index;
+}
+
+segy_diff* segydiff_run(segyfile a, segyfile b, const segy_diff_opts* o) {
+  segy_diff* d = (segy_diff*)calloc(1, sizeof(segy_diff));
+  if (!d)
+    errorinfo("malloc failed for the comparison");
+  d->ntrace_a = a->ntrace;
+  d->ntrace_b = b->ntrace;
+  d->textdiff = 0 != memcmp(a->textraw, b->textraw, SEGY_EBCBYTES);
+  /* the sample format is compared through the decoded samples */
+  char bha[SEGY_BHNBYTES], bhb[SEGY_BHNBYTES];
+  memcpy(bha, a->bhraw, SEGY_BHNBYTES);
+  memcpy(bhb, b->bhraw, SEGY_BHNBYTES);
+  memset(bha + DIFF_BHFORMAT, 0, 2);
+  memset(bhb + DIFF_BHFORMAT, 0, 2);
+  d->binarydiff = 0 != memcmp(bha, bhb, SEGY_BHNBYTES);
+  d->formatdiff = a->format != b->format;
+  if (a->ns != b->ns) {
+    warninginfo("comparison: ns differs, %d and %d", a->ns, b->ns);
+    d->shapediff = 1;
+    return d;
+  }
+  size_t ntrace = a->ntrace < b->ntrace ? a->ntrace : b->ntrace;
+  d->ntrace = ntrace;
+  if (0 == ntrace)
+    return d;
+
+  int ns = a->ns;
+  int raw = a->format == b->format; /* records are comparable byte for byte */
+  size_t cap = o->maxreport;
+  size_t big = a->nsegy > b->nsegy ? a->nsegy : b->nsegy;
+  size_t batch = DIFF_BATCHBYTES / big > 0 ? DIFF_BATCHBYTES / big : 1;
+  int nthreads = segy_nthreads(o->nthreads);
+  if (batch * nthreads > ntrace)
+    batch = (ntrace + nthreads - 1) / nthreads;
+  size_t nbatch = (ntrace + batch - 1) / batch;
+
+  diff_part* part = (diff_part*)calloc(nthreads, sizeof(diff_part));
+  if (!part)
+    errorinfo("malloc failed for the comparison");
+  int failed = 0;
+  segyio_hint(a->io, segy_trace_offset(a, 0), (int64_t)(ntrace * a->nsegy), SEGY_IO_SEQUENTIAL);
+  segyio_hint(b->io, segy_trace_offset(b, 0), (int64_t)(ntrace * b->nsegy), SEGY_IO_SEQUENTIAL);
+
+#pragma omp parallel num_threads(nthreads)
+  {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    diff_part* t = &part[tid];
+    char* ba = (char*)malloc(batch * a->nsegy);
+    char* bb = (char*)malloc(batch * b->nsegy);
+    float* fa = (float*)malloc(sizeof(float) * (ns > 0 ? ns : 1));
+    float* fb = (float*)malloc(sizeof(float) * (ns > 0 ? ns : 1));
+    t->item = (segy_diff_item*)malloc(sizeof(segy_diff_item) * (cap > 0 ? cap : 1));
+    if (!ba || !bb || !fa || !fb || !t->item)
+      errorinfo("malloc failed for comparison buffers");
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t ib = 0; ib < nbatch; ib++) {
+      if (failed)
+        continue;
+      size_t i0 = ib * batch;
+      size_t nb = i0 + batch > ntrace ? ntrace - i0 : batch;
+      if (!segy_read_at(a, ba, nb * a->nsegy, segy_trace_offset(a, i0)) ||
+          !segy_read_at(b, bb, nb * b->nsegy, segy_trace_offset(b, i0))) {
+        failed = 1;
+        continue;
+      }
+      /* the common case of equal files is one memcmp per batch */
+      if (raw && 0 == memcmp(ba, bb, nb * a->nsegy)) {
+        t->nidentical += nb;
+        continue;
+      }
+      for (size_t i = 0; i < nb; i++) {
+        const char* ra = ba + i * a->nsegy;
+        const char* rb = bb + i * b->nsegy;
+        if (raw && 0 == memcmp(ra, rb, a->nsegy)) {
+          t->nidentical++;
+          continue;
+        }
+        int hdiff = 0 != memcmp(ra, rb, SEGY_THNBYTES) && diff_header(t, o, ra, rb, i0 + i, cap);
+        size_t nbad = 0;
+        if (!raw || segyquant_exponent(a, ra) != segyquant_exponent(b, rb) ||
+            0 != memcmp(ra + SEGY_THNBYTES, rb + SEGY_THNBYTES, a->nsegy - SEGY_THNBYTES)) {
+          uint64_t t0 = SEGY_TIC(a);
+          segy2trace(ra + SEGY_THNBYTES, fa, ns, a->format);
+          segy2trace(rb + SEGY_THNBYTES, fb, ns, b->format);
+          segyquant_rescale(fa, ns, segyquant_exponent(a, ra));
+          segyquant_rescale(fb, ns, segyquant_exponent(b, rb));
+          segy_count_sample(a, 1, t0);
+          nbad = diff_samples(t, o, fa, fb, ns, i0 + i, cap);
+        }
+        t->nheader += hdiff;
+        t->nsample += nbad > 0;
+        t->nsample_bad += nbad;
+        t->nwithin += !hdiff && !nbad;
+      }
+    }
+    free(ba);
+    free(bb);
+    free(fa);
+    free(fb);
+  }
+  segy_count_traces_read(a, ntrace);
+  segy_count_traces_read(b, ntrace);
+
+  /* every thread kept its first maxreport items, so the first maxreport of all of
+     them are among these */
+  size_t nall = 0;
+  for (int i = 0; i < nthreads; i++)
+    nall += part[i].nitem;
+  d->item = (segy_diff_item*)malloc(sizeof(segy_diff_item) * (nall > 0 ? nall : 1));
+  if (!d->item)
+    errorinfo("malloc failed for the comparison");
+  for (int i = 0; i < nthreads; i++) {
+    diff_part* t = &part[i];
+    memcpy(d->item + d->nitem, t->item, sizeof(segy_diff_item) * t->nitem);
+    d->nitem += t->nitem;
+    d->nidentical += t->nidentical;
+    d->nwithin += t->nwithin;
+    d->nheader += t->nheader;
+    d->nsample += t->nsample;
+    d->nsample_bad += t->nsample_bad;
+    if (t->maxabs > d->maxabs || (t->maxabs == d->maxabs && t->maxabs > 0 &&
+                                  t->itr_maxabs < d->itr_maxabs)) {
+      d->maxabs = t->maxabs;
+      d->itr_maxabs = t->itr_maxabs;
+    }
+    if (t->maxrel > d->maxrel)
+      d->maxrel = t->maxrel;
+    free(t->item);
+  }
+  free(part);
+  qsort(d->item, d->nitem, sizeof(segy_diff_item), diff_item_cmp);
+  if (d->nitem > cap)
+    d->nitem = cap;
+  if (failed)
+    warninginfo("comparison: I/O error, the counts cover part of the traces");
+  d->failed = failed;
+  return d;
+}
+
+int segydiff_same(const segy_diff* d) {
+  return !d->failed && !d->shapediff && !d->binarydiff && d->ntrace_a == d->ntrace_b &&
+         0 == d->nheader && 0 == d->nsample;
+}
+
+void segydiff_print(const segy_diff* d, FILE* out) {
+  for (size_t i = 0; i < d->nitem; i++) {
+    const segy_diff_item* it = &d->item[i];
+    if (SEGY_DIFF_HEADER == it->kind)
+      fprintf(out, "trace %zu: %s %.0f != %.0f\n", it->itr, segykeyword(it->index), it->a, it->b);
+    else
+      fprintf(out, "trace %zu: sample %d %.9g != %.9g, %zu samples beyond the tolerance\n", it->itr,
+              it->index, it->a, it->b, it->count);
+  }
+  if (d->textdiff)
+    fprintf(out, "text headers differ\n");
+  if (d->binarydiff)
+    fprintf(out, "binary headers differ\n");
+  if (d->formatdiff)
+    fprintf(out, "sample formats differ, samples compared decoded\n");
+  if (d->failed)
+    fprintf(out, "I/O error, the comparison is incomplete\n");
+  if (d->shapediff) {
+    fprintf(out, "ns differs, traces not compared\n");
+    return;
+  }
+  if (d->ntrace_a != d->ntrace_b)
+    fprintf(out, "trace counts differ: %zu and %zu\n", d->ntrace_a, d->ntrace_b);
+  fprintf(out, "traces compared   %zu\n", d->ntrace);
+  fprintf(out, "identical         %zu\n", d->nidentical);
+  fprintf(out, "within tolerance  %zu\n", d->nwithin);
+  fprintf(out, "header differs    %zu\n", d->nheader);
+  fprintf(out, "samples differ    %zu (%llu samples)\n", d->nsample,
+          (unsigned long long)d->nsample_bad);
+  if (d->maxabs > 0)
+    fprintf(out, "max abs diff      %g at trace %zu\nmax rel diff      %g\n", d->maxabs,
+            d->itr_maxabs, d->maxrel);
+}
+
+void segydiff_free(segy_diff* d) {
+  if (!d)
+    return;
+  free(d->item);
+  free(d);
+}
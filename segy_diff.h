@@ -0,0 +1,71 @@
+/* Comparison of two SEGY files with sample tolerances and a header key mask */
+#ifndef _segy_diff_h
+#define _segy_diff_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "segy.h"
+
+enum {
+  SEGY_DIFF_HEADER = 0, /* a trace header key differs */
+  SEGY_DIFF_SAMPLE = 1, /* samples of a trace are beyond the tolerance */
+};
+
+/** what counts as a difference */
+typedef struct {
+  double atol, rtol;           // samples differ when |a - b| > atol + rtol * max(|a|, |b|)
+  char keymask[SEGY_THNKEYS];  // trace header keys compared (1) or ignored (0)
+  size_t maxreport;            // differences kept, the first in trace order
+  int nthreads;                // 0 for all cores
+} segy_diff_opts;
+
+/** one difference */
+typedef struct {
+  size_t itr;       // trace
+  int kind;         // SEGY_DIFF_*
+  int index;        // key, or first sample beyond the tolerance
+  double a, b;      // the values in the two files
+  size_t count;     // samples beyond the tolerance in the trace, 1 for keys
+} segy_diff_item;
+
+/** summary of a comparison */
+typedef struct {
+  size_t ntrace_a, ntrace_b;
+  size_t ntrace;         // traces compared, the smaller count
+  size_t nidentical;     // traces with identical records
+  size_t nwithin;        // traces that differ only within the tolerance or in ignored keys
+  size_t nheader;        // traces with a compared header key that differs
+  size_t nsample;        // traces with samples beyond the tolerance
+  uint64_t nsample_bad;  // samples beyond the tolerance
+  double maxabs;         // largest |a - b| of the decoded traces
+  size_t itr_maxabs;
+  double maxrel;         // largest |a - b| / max(|a|, |b|) of the decoded traces
+  int textdiff;          // the text headers differ
+  int binarydiff;        // the binary headers differ in more than the sample format
+  int formatdiff;        // the sample formats differ, samples are compared decoded
+  int shapediff;         // ns differs, no trace was compared
+  int failed;            // an I/O error stopped the comparison, the counts are partial
+  size_t nitem;
+  segy_diff_item* item;  // the first maxreport differences
+} segy_diff;
+
+/*< exact comparison of every header key, report the first 20 differences >*/
+void segydiff_opts_init(segy_diff_opts* o);
+
+/*< compare a and b in parallel batches, records are compared raw first and only the
+-- traces that differ are decoded (and rescaled when a handle quantizes, see
+-- segyfile_set_quantize); files of different formats are decoded throughout >*/
+segy_diff* segydiff_run(segyfile a, segyfile b, const segy_diff_opts* o);
+
+/*< 1 if the files are the same within the tolerances: same trace count and binary
+-- header (but for the sample format), no compared key or sample differs and no read
+-- failed >*/
+int segydiff_same(const segy_diff* d);
+
+/*< print the differences kept and the summary >*/
+void segydiff_print(const segy_diff* d, FILE* out);
+
+/*< free the result of segydiff_run >*/
+void segydiff_free(segy_diff* d);
+
+#endif
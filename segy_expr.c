@@ -0,0 +1,678 @@
+/* Vectorized integer expressions over trace header keys */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_expr.h"
+#include "segy_internal.h"
+
+#define EXPR_BLOCK 512   /* traces evaluated per block, keeps the stack in cache */
+#define EXPR_MAXDEPTH 64 /* deepest operand stack of an expression */
+
+enum {
+  OP_KEY,   /* push column v */
+  OP_CONST, /* push constant v */
+  OP_NEG,
+  OP_NOT,
+  OP_ABS,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_MOD,
+  OP_EQ,
+  OP_NE,
+  OP_LT,
+  OP_LE,
+  OP_GT,
+  OP_GE,
+  OP_AND,
+  OP_OR,
+  OP_LUT, /* replace the top by its value in table v */
+  OP_SEL, /* c ? a : b */
+};
+
+typedef struct {
+  int op;
+  int64_t v;
+} expr_op;
+
+struct segy_expr {
+  int nop;
+  expr_op* ops;
+  int nkey;              /* distinct keys read */
+  int keys[SEGY_THNKEYS];/* key index of each column */
+  int depth;             /* operand stack depth */
+  int nlut;
+  const segy_lut** luts; /* tables used by OP_LUT, not owned */
+};
+
+struct segy_lut {
+  char name[32];
+  size_t n;
+  int64_t* keys;     /* sorted */
+  int64_t* vals;
+  int64_t missing;   /* value of keys not in the table */
+  int64_t kmin;      /* direct table of keys kmin .. kmin + ndense - 1 */
+  size_t ndense;     /* 0 when the keys are too sparse for it */
+  int64_t* dense;
+  uint8_t* has;
+};
+
+#define LUT_DENSE_RATIO 4 /* direct table when the key range is at most this times n */
+
+/* recursive descent parser, emits postfix operations */
+typedef struct {
+  const char* text;
+  const char* p;
+  segy_expr* e;
+  int cap;
+  int error;
+  segy_lut* const* luts; /* tables that lut(name, x) may name */
+  int nlut;
+} expr_parser;
+
+static void parse_error(expr_parser* ps, const char* what) {
+  if (!ps->error)
+    warninginfo("expression error at column %d: %s in \"%s\"",
+                (int)(ps->p - ps->text) + 1, what, ps->text);
+  ps->error = 1;
+}
+
+static void emit(expr_parser* ps, int op, int64_t v) {
+  segy_expr* e = ps->e;
+  if (e->nop == ps->cap) {
+    ps->cap = ps->cap ? 2 * ps->cap : 32;
+    e->ops = (expr_op*)realloc(e->ops, sizeof(expr_op) * ps->cap);
+    if (!e->ops)
+      errorinfo("malloc failed for expression");
+  }
+  e->ops[e->nop].op = op;
+  e->ops[e->nop].v = v;
+  e->nop++;
+}
+
+static void skipspace(expr_parser* ps) {
+  while (isspace((unsigned char)*ps->p))
+    ps->p++;
+}
+
+/* consume the operator tok if it comes next */
+static int accept(expr_parser* ps, const char* tok) {
+  skipspace(ps);
+  size_t n = strlen(tok);
+  if (strncmp(ps->p, tok, n))
+    return 0;
+  /* do not take '<' out of '<=', '!' out of '!=' ... */
+  if (1 == n && ('<' == tok[0] || '>' == tok[0] || '!' == tok[0] || '=' == tok[0]) &&
+      '=' == ps->p[1])
+    return 0;
+  ps->p += n;
+  return 1;
+}
+
+static int key_slot(segy_expr* e, int k) {
+  for (int i = 0; i < e->nkey; i++)
+    if (e->keys[i] == k)
+      return i;
+  e->keys[e->nkey] = k;
+  return e->nkey++;
+}
+
+static void parse_cond(expr_parser* ps);
+
+/* read a name into name[32], return 0 if there is none */
+static int parse_name(expr_parser* ps, char* name) {
+  skipspace(ps);
+  const char* p = ps->p;
+  const char* q = p;
+  if (!isalpha((unsigned char)*p) && '_' != *p)
+    return 0;
+  while (isalnum((unsigned char)*q) || '_' == *q)
+    q++;
+  size_t len = (size_t)(q - p);
+  if (len >= 32) {
+    parse_error(ps, "name too long");
+    return 0;
+  }
+  memcpy(name, p, len);
+  name[len] = '\0';
+  ps->p = q;
+  return 1;
+}
+
+/* lut(name, x) */
+static void parse_lut(expr_parser* ps) {
+  char name[32];
+  if (!accept(ps, "(") || !parse_name(ps, name)) {
+    parse_error(ps, "expected lut(table, expression)");
+    return;
+  }
+  int il = -1;
+  for (int i = 0; i < ps->nlut; i++)
+    if (!strcmp(ps->luts[i]->name, name))
+      il = i;
+  if (il < 0) {
+    parse_error(ps, "unknown lookup table");
+    return;
+  }
+  if (!accept(ps, ",")) {
+    parse_error(ps, "expected , after the table name");
+    return;
+  }
+  parse_cond(ps);
+  if (!accept(ps, ")"))
+    parse_error(ps, "expected )");
+
+  segy_expr* e = ps->e;
+  int slot = -1;
+  for (int i = 0; i < e->nlut; i++)
+    if (e->luts[i] == ps->luts[il])
+      slot = i;
+  if (slot < 0) {
+    e->luts = (const segy_lut**)realloc(e->luts, sizeof(segy_lut*) * (e->nlut + 1));
+    if (!e->luts)
+      errorinfo("malloc failed for expression tables");
+    e->luts[e->nlut] = ps->luts[il];
+    slot = e->nlut++;
+  }
+  emit(ps, OP_LUT, slot);
+}
+
+static void parse_primary(expr_parser* ps) {
+  skipspace(ps);
+  const char* p = ps->p;
+  if (isdigit((unsigned char)*p)) {
+    /* decimal, hexadecimal only with 0x: a leading zero is not octal */
+    char* end;
+    int hex = '0' == p[0] && ('x' == p[1] || 'X' == p[1]);
+    long long v = strtoll(p, &end, hex ? 16 : 10);
+    ps->p = end;
+    emit(ps, OP_CONST, v);
+  } else if (isalpha((unsigned char)*p) || '_' == *p) {
+    char name[32];
+    if (!parse_name(ps, name))
+      return;
+
+    if (!strcmp(name, "abs")) {
+      if (!accept(ps, "(")) {
+        parse_error(ps, "expected ( after abs");
+        return;
+      }
+      parse_cond(ps);
+      if (!accept(ps, ")"))
+        parse_error(ps, "expected )");
+      emit(ps, OP_ABS, 0);
+      return;
+    }
+    if (!strcmp(name, "lut")) {
+      parse_lut(ps);
+      return;
+    }
+    for (int k = 0; k < SEGY_THNKEYS; k++) {
+      if (!strcmp(name, segykeyword(k))) {
+        emit(ps, OP_KEY, key_slot(ps->e, k));
+        return;
+      }
+    }
+    ps->p = p;
+    parse_error(ps, "unknown header key");
+  } else if (accept(ps, "(")) {
+    parse_cond(ps);
+    if (!accept(ps, ")"))
+      parse_error(ps, "expected )");
+  } else {
+    parse_error(ps, "expected a key, a number or (");
+  }
+}
+
+static void parse_unary(expr_parser* ps) {
+  if (accept(ps, "-")) {
+    parse_unary(ps);
+    emit(ps, OP_NEG, 0);
+  } else if (accept(ps, "!")) {
+    parse_unary(ps);
+    emit(ps, OP_NOT, 0);
+  } else if (accept(ps, "+")) {
+    parse_unary(ps);
+  } else {
+    parse_primary(ps);
+  }
+}
+
+static void parse_product(expr_parser* ps) {
+  parse_unary(ps);
+  while (!ps->error) {
+    int op;
+    if (accept(ps, "*"))
+      op = OP_MUL;
+    else if (accept(ps, "/"))
+      op = OP_DIV;
+    else if (accept(ps, "%"))
+      op = OP_MOD;
+    else
+      break;
+    parse_unary(ps);
+    emit(ps, op, 0);
+  }
+}
+
+static void parse_sum(expr_parser* ps) {
+  parse_product(ps);
+  while (!ps->error) {
+    int op;
+    if (accept(ps, "+"))
+      op = OP_ADD;
+    else if (accept(ps, "-"))
+      op = OP_SUB;
+    else
+      break;
+    parse_product(ps);
+    emit(ps, op, 0);
+  }
+}
+
+static void parse_compare(expr_parser* ps) {
+  parse_sum(ps);
+  int op;
+  if (accept(ps, "=="))
+    op = OP_EQ;
+  else if (accept(ps, "!="))
+    op = OP_NE;
+  else if (accept(ps, "<="))
+    op = OP_LE;
+  else if (accept(ps, ">="))
+    op = OP_GE;
+  else if (accept(ps, "<"))
+    op = OP_LT;
+  else if (accept(ps, ">"))
+    op = OP_GT;
+  else
+    return;
+  parse_sum(ps);
+  emit(ps, op, 0);
+}
+
+static void parse_and(expr_parser* ps) {
+  parse_compare(ps);
+  while (!ps->error && accept(ps, "&&")) {
+    parse_compare(ps);
+    emit(ps, OP_AND, 0);
+  }
+}
+
+static void parse_or(expr_parser* ps) {
+  parse_and(ps);
+  while (!ps->error && accept(ps, "||")) {
+    parse_and(ps);
+    emit(ps, OP_OR, 0);
+  }
+}
+
+/* c ? a : b, right associative */
+static void parse_cond(expr_parser* ps) {
+  parse_or(ps);
+  if (ps->error || !accept(ps, "?"))
+    return;
+  parse_cond(ps);
+  if (!accept(ps, ":")) {
+    parse_error(ps, "expected : after ?");
+    return;
+  }
+  parse_cond(ps);
+  emit(ps, OP_SEL, 0);
+}
+
+segy_expr* segyexpr_parse(const char* text) {
+  return segyexpr_parse_lut(text, NULL, 0);
+}
+
+segy_expr* segyexpr_parse_lut(const char* text, segy_lut* const* luts, int nlut) {
+  segy_expr* e = (segy_expr*)calloc(1, sizeof(segy_expr));
+  if (!e)
+    errorinfo("malloc failed for expression");
+  expr_parser ps = {text, text, e, 0, 0, luts, nlut};
+  parse_cond(&ps);
+  skipspace(&ps);
+  if (!ps.error && *ps.p)
+    parse_error(&ps, "unexpected text");
+
+  /* stack depth */
+  int sp = 0;
+  for (int i = 0; i < e->nop && !ps.error; i++) {
+    int op = e->ops[i].op;
+    if (OP_KEY == op || OP_CONST == op)
+      sp++;
+    else if (OP_SEL == op)
+      sp -= 2;
+    else if (op >= OP_ADD && op != OP_LUT)
+      sp--;
+    if (sp > e->depth)
+      e->depth = sp;
+  }
+  if (!ps.error && e->depth > EXPR_MAXDEPTH) {
+    warninginfo("expression too deep: \"%s\"", text);
+    ps.error = 1;
+  }
+  if (ps.error) {
+    segyexpr_free(e);
+    return NULL;
+  }
+  return e;
+}
+
+int segyexpr_nkeys(const segy_expr* e) {
+  return e->nkey;
+}
+
+int segyexpr_key(const segy_expr* e, int i) {
+  return e->keys[i];
+}
+
+/* replace x[m] by their table values */
+static void lut_lookup(const segy_lut* t, int64_t* x, size_t m) {
+  for (size_t j = 0; j < m; j++) {
+    int64_t k = x[j];
+    if (t->ndense) {
+      uint64_t i = (uint64_t)k - (uint64_t)t->kmin;
+      x[j] = i < t->ndense && t->has[i] ? t->dense[i] : t->missing;
+      continue;
+    }
+    size_t lo = 0, hi = t->n;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (t->keys[mid] < k)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    x[j] = lo < t->n && t->keys[lo] == k ? t->vals[lo] : t->missing;
+  }
+}
+
+/* one block of m <= EXPR_BLOCK traces, stk holds depth * EXPR_BLOCK values;
+ arithmetic that can overflow wraps around in uint64_t */
+static void expr_block(const segy_expr* e, const int32_t* const* cols, size_t j0,
+                       size_t m, int64_t* stk, int64_t* out) {
+  int sp = 0;
+  for (int i = 0; i < e->nop; i++) {
+    const expr_op* o = e->ops + i;
+    int64_t* a = stk + (size_t)(sp - 2) * EXPR_BLOCK;
+    int64_t* b = stk + (size_t)(sp - 1) * EXPR_BLOCK;
+    size_t j;
+    switch (o->op) {
+      case OP_KEY: {
+        const int32_t* c = cols[o->v] + j0;
+        int64_t* d = stk + (size_t)sp++ * EXPR_BLOCK;
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          d[j] = c[j];
+        break;
+      }
+      case OP_CONST: {
+        int64_t* d = stk + (size_t)sp++ * EXPR_BLOCK;
+        int64_t v = o->v;
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          d[j] = v;
+        break;
+      }
+      case OP_NEG:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          b[j] = (int64_t)(0 - (uint64_t)b[j]);
+        break;
+      case OP_NOT:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          b[j] = !b[j];
+        break;
+      case OP_ABS:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          b[j] = b[j] < 0 ? (int64_t)(0 - (uint64_t)b[j]) : b[j];
+        break;
+      case OP_ADD:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = (int64_t)((uint64_t)a[j] + (uint64_t)b[j]);
+        sp--;
+        break;
+      case OP_SUB:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = (int64_t)((uint64_t)a[j] - (uint64_t)b[j]);
+        sp--;
+        break;
+      case OP_MUL:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = (int64_t)((uint64_t)a[j] * (uint64_t)b[j]);
+        sp--;
+        break;
+      case OP_DIV:
+        for (j = 0; j < m; j++)
+          a[j] = b[j] ? (-1 == b[j] ? (int64_t)(0 - (uint64_t)a[j]) : a[j] / b[j]) : 0;
+        sp--;
+        break;
+      case OP_MOD:
+        for (j = 0; j < m; j++)
+          a[j] = (b[j] && -1 != b[j]) ? a[j] % b[j] : 0;
+        sp--;
+        break;
+      case OP_EQ:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = a[j] == b[j];
+        sp--;
+        break;
+      case OP_NE:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = a[j] != b[j];
+        sp--;
+        break;
+      case OP_LT:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = a[j] < b[j];
+        sp--;
+        break;
+      case OP_LE:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = a[j] <= b[j];
+        sp--;
+        break;
+      case OP_GT:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = a[j] > b[j];
+        sp--;
+        break;
+      case OP_GE:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = a[j] >= b[j];
+        sp--;
+        break;
+      case OP_AND:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = (a[j] != 0) & (b[j] != 0);
+        sp--;
+        break;
+      case OP_OR:
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          a[j] = (a[j] != 0) | (b[j] != 0);
+        sp--;
+        break;
+      case OP_LUT:
+        lut_lookup(e->luts[o->v], b, m);
+        break;
+      case OP_SEL: {
+        int64_t* c = stk + (size_t)(sp - 3) * EXPR_BLOCK;
+#pragma omp simd
+        for (j = 0; j < m; j++)
+          c[j] = c[j] ? a[j] : b[j];
+        sp -= 2;
+        break;
+      }
+    }
+  }
+  memcpy(out, stk, sizeof(int64_t) * m);
+}
+
+void segyexpr_eval(const segy_expr* e, const int32_t* const* cols, size_t n, int64_t* out) {
+  int64_t* stk = (int64_t*)malloc(sizeof(int64_t) * EXPR_BLOCK * (e->depth > 0 ? e->depth : 1));
+  if (!stk)
+    errorinfo("malloc failed for expression stack");
+  for (size_t j0 = 0; j0 < n; j0 += EXPR_BLOCK) {
+    size_t m = n - j0 < EXPR_BLOCK ? n - j0 : EXPR_BLOCK;
+    expr_block(e, cols, j0, m, stk, out + j0);
+  }
+  free(stk);
+}
+
+void segyexpr_eval_headers(const segy_expr* e, const char* buf, size_t stride, size_t n,
+                           int64_t* out) {
+  int32_t* data = (int32_t*)malloc(sizeof(int32_t) * n * (e->nkey > 0 ? e->nkey : 1));
+  const int32_t* cols[SEGY_THNKEYS];
+  if (!data)
+    errorinfo("malloc failed for expression columns");
+  for (int i = 0; i < e->nkey; i++) {
+    segy_decode_column(buf, stride, n, e->keys[i], data + (size_t)i * n);
+    cols[i] = data + (size_t)i * n;
+  }
+  segyexpr_eval(e, cols, n, out);
+  free(data);
+}
+
+void segyexpr_free(segy_expr* e) {
+  if (e) {
+    free(e->ops);
+    free(e->luts);
+    free(e);
+  }
+}
+
+/* (key, value, input index) triples by key, then by input index */
+static int lut_cmp(const void* a, const void* b) {
+  const int64_t* x = (const int64_t*)a;
+  const int64_t* y = (const int64_t*)b;
+  if (x[0] != y[0])
+    return (x[0] > y[0]) - (x[0] < y[0]);
+  return (x[2] > y[2]) - (x[2] < y[2]);
+}
+
+segy_lut* segylut_create(const char* name, const int64_t* keys, const int64_t* vals,
+                         size_t n, int64_t missing) {
+  segy_lut* t = (segy_lut*)calloc(1, sizeof(segy_lut));
+  int64_t* pairs = (int64_t*)malloc(sizeof(int64_t) * 3 * (n > 0 ? n : 1));
+  if (!t || !pairs)
+    errorinfo("malloc failed for lookup table");
+  snprintf(t->name, sizeof(t->name), "%s", name);
+  t->missing = missing;
+  for (size_t i = 0; i < n; i++) {
+    pairs[3 * i] = keys[i];
+    pairs[3 * i + 1] = vals[i];
+    pairs[3 * i + 2] = (int64_t)i;
+  }
+  qsort(pairs, n, sizeof(int64_t) * 3, lut_cmp);
+
+  /* keep the last value of a repeated key, the input index orders them */
+  t->keys = (int64_t*)malloc(sizeof(int64_t) * (n > 0 ? n : 1));
+  t->vals = (int64_t*)malloc(sizeof(int64_t) * (n > 0 ? n : 1));
+  if (!t->keys || !t->vals)
+    errorinfo("malloc failed for lookup table");
+  for (size_t i = 0; i < n; i++) {
+    if (t->n > 0 && t->keys[t->n - 1] == pairs[3 * i])
+      t->n--;
+    t->keys[t->n] = pairs[3 * i];
+    t->vals[t->n++] = pairs[3 * i + 1];
+  }
+  free(pairs);
+
+  if (t->n > 0) {
+    uint64_t range = (uint64_t)t->keys[t->n - 1] - (uint64_t)t->keys[0] + 1;
+    if (range > 0 && range <= LUT_DENSE_RATIO * (uint64_t)t->n + 1024) {
+      t->kmin = t->keys[0];
+      t->ndense = (size_t)range;
+      t->dense = (int64_t*)malloc(sizeof(int64_t) * t->ndense);
+      t->has = (uint8_t*)calloc(t->ndense, 1);
+      if (!t->dense || !t->has)
+        errorinfo("malloc failed for lookup table");
+      for (size_t i = 0; i < t->n; i++) {
+        size_t d = (size_t)((uint64_t)t->keys[i] - (uint64_t)t->kmin);
+        t->dense[d] = t->vals[i];
+        t->has[d] = 1;
+      }
+    }
+  }
+  return t;
+}
+
+segy_lut* segylut_load(const char* name, const char* path, int64_t missing) {
+  FILE* fp = fopen(path, "r");
+  if (!fp) {
+    warninginfo("lookup table: cannot open %s", path);
+    return NULL;
+  }
+  size_t n = 0, cap = 1024;
+  int64_t* keys = (int64_t*)malloc(sizeof(int64_t) * cap);
+  int64_t* vals = (int64_t*)malloc(sizeof(int64_t) * cap);
+  char line[256];
+  int lineno = 0;
+  while (keys && vals && fgets(line, sizeof(line), fp)) {
+    lineno++;
+    char* p = line;
+    while (isspace((unsigned char)*p))
+      p++;
+    if ('\0' == *p || '#' == *p)
+      continue;
+    long long k, v;
+    if (2 != sscanf(p, "%lld %lld", &k, &v)) {
+      warninginfo("lookup table %s line %d: expected two integers", path, lineno);
+      continue;
+    }
+    if (n == cap) {
+      cap *= 2;
+      keys = (int64_t*)realloc(keys, sizeof(int64_t) * cap);
+      vals = (int64_t*)realloc(vals, sizeof(int64_t) * cap);
+      if (!keys || !vals)
+        break;
+    }
+    keys[n] = k;
+    vals[n++] = v;
+  }
+  fclose(fp);
+  if (!keys || !vals)
+    errorinfo("malloc failed for lookup table");
+  segy_lut* t = segylut_create(name, keys, vals, n, missing);
+  free(keys);
+  free(vals);
+  return t;
+}
+
+void segylut_free(segy_lut* t) {
+  if (t) {
+    free(t->keys);
+    free(t->vals);
+    free(t->dense);
+    free(t->has);
+    free(t);
+  }
+}
@@ -0,0 +1,59 @@
+/* Vectorized integer expressions over trace header keys */
+#ifndef _segy_expr_h
+#define _segy_expr_h
+
+#include <stdint.h>
+#include "segy.h"
+
+/*
+ expressions use the trace header key names of segykey() and integer constants, decimal
+ or hexadecimal with 0x (a leading 0 is not octal)
+   arithmetic   + - * / %  unary -  abs(x)
+   comparison   == != < <= > >=     (1 if true, 0 if false)
+   logical      && || !
+   conditional  c ? a : b
+   lookup       lut(table, x)       (value of key x in a table given to segyexpr_parse_lut)
+ e.g. "offset >= 100 && offset <= 2000 && trid != 2" or "abs(gx - sx)"
+ they are evaluated in int64 a whole batch of traces at a time, x / 0 and x % 0 give 0
+*/
+typedef struct segy_expr segy_expr;
+
+/** integer lookup table keyed by an integer, e.g. shot x by fldr */
+typedef struct segy_lut segy_lut;
+
+/*< compile an expression, return NULL and print a warning on syntax errors >*/
+segy_expr* segyexpr_parse(const char* text);
+
+/*< compile an expression that may use the tables luts[nlut] by name, the tables
+-- must outlive the expression >*/
+segy_expr* segyexpr_parse_lut(const char* text, segy_lut* const* luts, int nlut);
+
+/*< number of distinct header keys the expression reads >*/
+int segyexpr_nkeys(const segy_expr* e);
+
+/*< header key index of the i-th key the expression reads >*/
+int segyexpr_key(const segy_expr* e, int i);
+
+/*< evaluate for n traces, cols[i][j] is key segyexpr_key(e, i) of trace j,
+-- the result goes to out[n] >*/
+void segyexpr_eval(const segy_expr* e, const int32_t* const* cols, size_t n, int64_t* out);
+
+/*< evaluate for n raw trace headers, header j at buf + j * stride >*/
+void segyexpr_eval_headers(const segy_expr* e, const char* buf, size_t stride, size_t n,
+                           int64_t* out);
+
+/*< free the expression >*/
+void segyexpr_free(segy_expr* e);
+
+/*< table of n (keys[i], vals[i]) pairs named name, keys not in the table give
+-- missing, the last pair of a repeated key wins >*/
+segy_lut* segylut_create(const char* name, const int64_t* keys, const int64_t* vals,
+                         size_t n, int64_t missing);
+
+/*< read a table from a text file of "key value" lines, # starts a comment >*/
+segy_lut* segylut_load(const char* name, const char* path, int64_t missing);
+
+/*< free a table >*/
+void segylut_free(segy_lut* t);
+
+#endif
@@ -0,0 +1,369 @@
+/* Fold maps: traces per bin, split by offset class and azimuth sector */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_fold.h"
+#include "segy_htab.h"
+#include "segy_internal.h"
+
+#define FOLD_MAXBINS ((int64_t)1 << 30) /* cells of a growing map, more are outside */
+
+enum { COL_I, COL_X, COL_S, COL_OFF, COL_SX, COL_SY, COL_GX, COL_GY, NCOL };
+
+/* the map of one thread over bins [ix0, ix0 + nx) x [iy0, iy0 + ny) */
+typedef struct {
+  int64_t ix0, iy0, nx, ny;
+  uint32_t* count;  /* [nlayer][ny][nx] */
+  uint64_t nbinned, noutside;
+  int32_t* col;     /* NCOL columns of the largest batch */
+  size_t colcap;
+} fold_part;
+
+typedef struct {
+  segy_fold_grid g;
+  int nlayer;
+  int grow;          /* the grid grows to cover the traces */
+  int key[NCOL];     /* -1 for columns not needed */
+  double cosa, sina;
+  fold_part* part;   /* per thread */
+} fold_scan;
+
+void segyfold_grid_init(segy_fold_grid* g, int mode) {
+  memset(g, 0, sizeof(*g));
+  g->mode = mode;
+  g->ikey = segykey("iline");
+  g->xkey = segykey("xline");
+  g->dx = g->dy = SEGY_FOLD_LINES == mode ? 1 : 25;
+}
+
+/* make part cover bin (ix, iy), at least doubling a side that grows, return 0 if the
+   map would pass FOLD_MAXBINS */
+static int fold_cover(fold_part* pt, int nlayer, int64_t ix, int64_t iy) {
+  int64_t x0 = pt->ix0, x1 = pt->ix0 + pt->nx, y0 = pt->iy0, y1 = pt->iy0 + pt->ny;
+  if (0 == pt->nx) {
+    x0 = ix, x1 = ix + 1, y0 = iy, y1 = iy + 1;
+  } else {
+    if (ix < x0)
+      x0 = ix < x1 - 2 * pt->nx ? ix : x1 - 2 * pt->nx;
+    else if (ix >= x1)
+      x1 = ix >= x0 + 2 * pt->nx ? ix + 1 : x0 + 2 * pt->nx;
+    if (iy < y0)
+      y0 = iy < y1 - 2 * pt->ny ? iy : y1 - 2 * pt->ny;
+    else if (iy >= y1)
+      y1 = iy >= y0 + 2 * pt->ny ? iy + 1 : y0 + 2 * pt->ny;
+  }
+  int64_t nx = x1 - x0, ny = y1 - y0;
+  if (nx > FOLD_MAXBINS || ny > FOLD_MAXBINS || nx * ny > FOLD_MAXBINS / nlayer)
+    return 0;
+  uint32_t* c = (uint32_t*)calloc((size_t)(nx * ny * nlayer), sizeof(uint32_t));
+  if (!c)
+    errorinfo("malloc failed for fold map");
+  for (int l = 0; l < nlayer; l++)
+    for (int64_t j = 0; j < pt->ny; j++)
+      memcpy(c + ((l * ny + j + pt->iy0 - y0) * nx + pt->ix0 - x0),
+             pt->count + (l * pt->ny + j) * pt->nx, sizeof(uint32_t) * pt->nx);
+  free(pt->count);
+  pt->count = c;
+  pt->ix0 = x0;
+  pt->iy0 = y0;
+  pt->nx = nx;
+  pt->ny = ny;
+  return 1;
+}
+
+static void fold_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg,
+                       int tid) {
+  (void)itr0;
+  fold_scan* sc = (fold_scan*)arg;
+  const segy_fold_grid* g = &sc->g;
+  fold_part* pt = sc->part + tid;
+  if (pt->colcap < n) {
+    free(pt->col);
+    pt->col = (int32_t*)malloc(sizeof(int32_t) * NCOL * n);
+    if (!pt->col)
+      errorinfo("malloc failed for fold map buffers");
+    pt->colcap = n;
+  }
+  int32_t* col[NCOL];
+  for (int c = 0; c < NCOL; c++) {
+    col[c] = pt->col + c * n;
+    if (sc->key[c] >= 0)
+      segy_decode_column(buf, stride, n, sc->key[c], col[c]);
+  }
+
+  for (size_t j = 0; j < n; j++) {
+    double u, v, f = sc->key[COL_S] >= 0 ? segyscalar(col[COL_S][j]) : 1;
+    int64_t ix, iy;
+    if (SEGY_FOLD_LINES == g->mode) {
+      u = (col[COL_I][j] - g->x0) / g->dx;
+      v = g->xkey >= 0 ? (col[COL_X][j] - g->y0) / g->dy : 0;
+      ix = (int64_t)floor(u + 0.5);
+      iy = (int64_t)floor(v + 0.5);
+    } else {
+      double x = col[COL_I][j] * f - g->x0, y = col[COL_X][j] * f - g->y0;
+      u = (x * sc->cosa + y * sc->sina) / g->dx;
+      v = (y * sc->cosa - x * sc->sina) / g->dy;
+      if (!(fabs(u) < 1e15 && fabs(v) < 1e15)) {
+        pt->noutside++;
+        continue;
+      }
+      ix = (int64_t)floor(u);
+      iy = (int64_t)floor(v);
+    }
+
+    int ioff = 0, iaz = 0;
+    if (g->doff > 0) {
+      double c = floor((fabs((double)col[COL_OFF][j]) - g->off0) / g->doff);
+      if (c < 0 || c >= g->noff) {
+        pt->noutside++;
+        continue;
+      }
+      ioff = (int)c;
+    }
+    if (g->naz > 1) {
+      double ax = (col[COL_GX][j] - col[COL_SX][j]) * f;
+      double ay = (col[COL_GY][j] - col[COL_SY][j]) * f;
+      double az = atan2(ax, ay) * (180. / M_PI);
+      if (az < 0)
+        az += 360;
+      iaz = (int)(az * g->naz / 360.);
+      iaz = iaz < g->naz ? iaz : g->naz - 1;
+    }
+
+    if (ix < pt->ix0 || ix >= pt->ix0 + pt->nx || iy < pt->iy0 || iy >= pt->iy0 + pt->ny) {
+      if (!sc->grow || !fold_cover(pt, sc->nlayer, ix, iy)) {
+        pt->noutside++;
+        continue;
+      }
+    }
+    int l = iaz * g->noff + ioff;
+    pt->count[(l * pt->ny + iy - pt->iy0) * pt->nx + ix - pt->ix0]++;
+    pt->nbinned++;
+  }
+}
+
+segy_fold* segyfold_run(segyfile segyf, const segy_fold_grid* grid, int nthreads) {
+  fold_scan sc;
+  memset(&sc, 0, sizeof(sc));
+  sc.g = *grid;
+  segy_fold_grid* g = &sc.g;
+  if (!(g->dx > 0) || !(g->dy > 0))
+    errorinfo("fold map: bin sizes must be positive, not %g and %g", g->dx, g->dy);
+  if (g->noff > 0 && !(g->doff > 0))
+    errorinfo("fold map: %d offset classes need doff > 0", g->noff);
+  if (g->noff < 1)
+    g->noff = 1, g->doff = 0;
+  if (g->naz < 1)
+    g->naz = 1;
+  if (SEGY_FOLD_LINES == g->mode && g->xkey < 0)
+    g->ny = 1;
+  sc.nlayer = g->noff * g->naz;
+  sc.grow = g->nx <= 0 || g->ny <= 0;
+  sc.cosa = cos(g->angle * M_PI / 180.);
+  sc.sina = sin(g->angle * M_PI / 180.);
+
+  for (int c = 0; c < NCOL; c++)
+    sc.key[c] = -1;
+  if (SEGY_FOLD_LINES == g->mode) {
+    sc.key[COL_I] = g->ikey;
+    sc.key[COL_X] = g->xkey;
+  } else if (SEGY_FOLD_CDPXY == g->mode) {
+    sc.key[COL_I] = segykey("cdpx");
+    sc.key[COL_X] = segykey("cdpy");
+  } else {
+    errorinfo("fold map: unknown mode %d", g->mode);
+  }
+  if (g->doff > 0)
+    sc.key[COL_OFF] = segykey("offset");
+  if (g->naz > 1) {
+    sc.key[COL_SX] = segykey("sx");
+    sc.key[COL_SY] = segykey("sy");
+    sc.key[COL_GX] = segykey("gx");
+    sc.key[COL_GY] = segykey("gy");
+  }
+  if (SEGY_FOLD_CDPXY == g->mode || g->naz > 1)
+    sc.key[COL_S] = segykey("scalco");
+
+  nthreads = segy_nthreads(nthreads);
+  sc.part = (fold_part*)calloc(nthreads, sizeof(fold_part));
+  if (!sc.part)
+    errorinfo("malloc failed for fold map");
+  if (!sc.grow) {
+    for (int t = 0; t < nthreads; t++) {
+      fold_part* pt = sc.part + t;
+      pt->nx = g->nx;
+      pt->ny = g->ny;
+      pt->count = (uint32_t*)calloc((size_t)g->nx * g->ny * sc.nlayer, sizeof(uint32_t));
+      if (!pt->count)
+        errorinfo("malloc failed for fold map");
+    }
+  }
+
+  segy_fold* f = (segy_fold*)calloc(1, sizeof(segy_fold));
+  if (!f)
+    errorinfo("malloc failed for fold map");
+  f->ntrace = segy_scan_headers(segyf, 0, segyf->ntrace, nthreads, fold_batch, &sc);
+  if (f->ntrace != segyf->ntrace)
+    warninginfo("fold map: read %zu of %zu trace headers", (size_t)f->ntrace,
+                segyf->ntrace);
+
+  /* the union of the thread maps */
+  int64_t x0 = INT64_MAX, x1 = INT64_MIN, y0 = INT64_MAX, y1 = INT64_MIN;
+  for (int t = 0; t < nthreads; t++) {
+    fold_part* pt = sc.part + t;
+    f->nbinned += pt->nbinned;
+    f->noutside += pt->noutside;
+    if (0 == pt->nx)
+      continue;
+    x0 = pt->ix0 < x0 ? pt->ix0 : x0;
+    y0 = pt->iy0 < y0 ? pt->iy0 : y0;
+    x1 = pt->ix0 + pt->nx > x1 ? pt->ix0 + pt->nx : x1;
+    y1 = pt->iy0 + pt->ny > y1 ? pt->iy0 + pt->ny : y1;
+  }
+  if (x0 > x1)
+    x0 = x1 = y0 = y1 = 0;
+  if (sc.grow) {
+    /* trim the room left by the doubling to the bins that were hit */
+    int64_t tx0 = x1, tx1 = x0, ty0 = y1, ty1 = y0;
+    for (int t = 0; t < nthreads; t++) {
+      fold_part* pt = sc.part + t;
+      for (int64_t l = 0; l < sc.nlayer; l++)
+        for (int64_t j = 0; j < pt->ny; j++)
+          for (int64_t i = 0; i < pt->nx; i++)
+            if (pt->count[(l * pt->ny + j) * pt->nx + i]) {
+              tx0 = pt->ix0 + i < tx0 ? pt->ix0 + i : tx0;
+              tx1 = pt->ix0 + i + 1 > tx1 ? pt->ix0 + i + 1 : tx1;
+              ty0 = pt->iy0 + j < ty0 ? pt->iy0 + j : ty0;
+              ty1 = pt->iy0 + j + 1 > ty1 ? pt->iy0 + j + 1 : ty1;
+            }
+    }
+    if (tx0 < tx1)
+      x0 = tx0, x1 = tx1, y0 = ty0, y1 = ty1;
+    else
+      x0 = x1 = y0 = y1 = 0;
+  }
+  int64_t nx = x1 - x0, ny = y1 - y0;
+  f->fold = (uint32_t*)calloc((size_t)(nx * ny * sc.nlayer) + 1, sizeof(uint32_t));
+  if (!f->fold)
+    errorinfo("malloc failed for fold map");
+  for (int t = 0; t < nthreads; t++) {
+    fold_part* pt = sc.part + t;
+    for (int64_t l = 0; l < sc.nlayer; l++)
+      for (int64_t j = 0; j < pt->ny; j++) {
+        int64_t y = pt->iy0 + j;
+        if (y < y0 || y >= y1)
+          continue;
+        const uint32_t* src = pt->count + (l * pt->ny + j) * pt->nx;
+        uint32_t* dst = f->fold + (l * ny + y - y0) * nx;
+        for (int64_t i = 0; i < pt->nx; i++) {
+          int64_t x = pt->ix0 + i;
+          if (x >= x0 && x < x1)
+            dst[x - x0] += src[i];
+        }
+      }
+    free(pt->count);
+    free(pt->col);
+  }
+  free(sc.part);
+
+  /* bin (0, 0) of the map */
+  if (SEGY_FOLD_LINES == g->mode) {
+    g->x0 += x0 * g->dx;
+    g->y0 += y0 * g->dy;
+  } else {
+    g->x0 += (x0 * g->dx) * sc.cosa - (y0 * g->dy) * sc.sina;
+    g->y0 += (x0 * g->dx) * sc.sina + (y0 * g->dy) * sc.cosa;
+  }
+  g->nx = (int)nx;
+  g->ny = (int)ny;
+  f->g = *g;
+  f->noff = g->noff;
+  f->naz = g->naz;
+  return f;
+}
+
+uint32_t segyfold_at(const segy_fold* f, int ix, int iy, int ioff, int iaz) {
+  if (ix < 0 || ix >= f->g.nx || iy < 0 || iy >= f->g.ny || ioff < 0 || ioff >= f->noff ||
+      iaz < 0 || iaz >= f->naz)
+    return 0;
+  return f->fold[(((size_t)iaz * f->noff + ioff) * f->g.ny + iy) * f->g.nx + ix];
+}
+
+void segyfold_print(const segy_fold* f, FILE* out) {
+  const segy_fold_grid* g = &f->g;
+  size_t nbin = (size_t)g->nx * g->ny;
+  if (SEGY_FOLD_LINES == g->mode)
+    fprintf(out, "bins of %s %g + %g * ix, %s %g + %g * iy: %d x %d\n", segykeyword(g->ikey),
+            g->x0, g->dx, g->xkey >= 0 ? segykeyword(g->xkey) : "-", g->y0, g->dy, g->nx, g->ny);
+  else
+    fprintf(out, "cdp grid at (%g, %g), %g x %g bins, %g degrees: %d x %d\n", g->x0, g->y0,
+            g->dx, g->dy, g->angle, g->nx, g->ny);
+  fprintf(out, "traces %llu, binned %llu, outside %llu\n", (unsigned long long)f->ntrace,
+          (unsigned long long)f->nbinned, (unsigned long long)f->noutside);
+  for (int a = 0; a < f->naz; a++)
+    for (int o = 0; o < f->noff; o++) {
+      const uint32_t* c = f->fold + ((size_t)a * f->noff + o) * nbin;
+      uint64_t sum = 0, live = 0;
+      uint32_t lo = UINT32_MAX, hi = 0;
+      for (size_t b = 0; b < nbin; b++) {
+        if (!c[b])
+          continue;
+        live++;
+        sum += c[b];
+        lo = c[b] < lo ? c[b] : lo;
+        hi = c[b] > hi ? c[b] : hi;
+      }
+      if (f->naz > 1 || f->noff > 1)
+        fprintf(out, "azimuth %g-%g offset %g-%g: ", a * 360. / f->naz, (a + 1) * 360. / f->naz,
+                g->off0 + o * g->doff, g->off0 + (o + 1) * g->doff);
+      fprintf(out, "live bins %llu of %zu, fold min %u mean %.2f max %u\n",
+              (unsigned long long)live, nbin, live ? lo : 0, live ? (double)sum / live : 0., hi);
+    }
+}
+
+int segyfold_save_raw(const segy_fold* f, const char* path) {
+  FILE* fp = fopen(path, "wb");
+  if (!fp) {
+    warninginfo("fold map: cannot create %s", path);
+    return 0;
+  }
+  size_t n = (size_t)f->g.nx * f->g.ny * f->noff * f->naz;
+  char buf[4 * 1024];
+  int ok = 1;
+  for (size_t i0 = 0; ok && i0 < n; i0 += 1024) {
+    size_t m = n - i0 < 1024 ? n - i0 : 1024;
+    for (size_t j = 0; j < m; j++) {
+      uint32_t v = f->fold[i0 + j];
+#if !HOST_LITTLE_ENDIAN
+      v = bswap32(v);
+#endif
+      memcpy(buf + 4 * j, &v, 4);
+    }
+    ok = m == fwrite(buf, 4, m, fp);
+  }
+  if (fclose(fp))
+    ok = 0;
+  if (!ok)
+    warninginfo("fold map: error writing %s", path);
+  return ok;
+}
+
+void segyfold_free(segy_fold* f) {
+  if (f) {
+    free(f->fold);
+    free(f);
+  }
+}
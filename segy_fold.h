@@ -0,0 +1,57 @@
+/* Fold maps: traces per bin, split by offset class and azimuth sector */
+#ifndef _segy_fold_h
+#define _segy_fold_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "segy.h"
+
+enum {
+  SEGY_FOLD_LINES = 0, /* bins are the values of two header keys, iline and xline */
+  SEGY_FOLD_CDPXY = 1, /* bins of a grid over cdpx, cdpy with scalco applied */
+};
+
+/** how traces are binned */
+typedef struct {
+  int mode;          // SEGY_FOLD_*
+  int ikey, xkey;    // LINES: keys of the bin numbers, xkey -1 for a 2D line
+  double x0, y0;     // LINES: key values of bin 0; CDPXY: lower left corner of bin (0, 0)
+  double dx, dy;     // bin size: key step or coordinate units
+  double angle;      // CDPXY: grid x axis, degrees counterclockwise from the x coordinate
+  int nx, ny;        // bins along x and y, 0 grows the grid to cover every trace
+  int noff;          // offset classes of |offset|, 0 for no split
+  double off0, doff; // first class starts at off0, classes are doff wide
+  int naz;           // azimuth sectors of source to receiver, clockwise from y, 0 for no split
+} segy_fold_grid;
+
+/** a dense fold map */
+typedef struct {
+  segy_fold_grid g;    // the grid, x0, y0, nx and ny cover the map
+  int noff, naz;       // layers, at least 1
+  uint32_t* fold;      // fold[((iaz * noff + ioff) * ny + iy) * nx + ix]
+  uint64_t ntrace;     // traces scanned
+  uint64_t nbinned;    // traces counted in the map
+  uint64_t noutside;   // traces outside the grid, the offset classes or the size limit
+} segy_fold;
+
+/*< a grid of mode with bins of 1 (LINES: iline and xline) or 25 (CDPXY) and no split >*/
+void segyfold_grid_init(segy_fold_grid* g, int mode);
+
+/*< count the traces of every bin in one parallel header pass, the threads fill their
+-- own maps which are added up at the end; ntrace of the map is below that of segyf
+-- when headers could not be read >*/
+segy_fold* segyfold_run(segyfile segyf, const segy_fold_grid* g, int nthreads);
+
+/*< fold of bin (ix, iy) of offset class ioff and azimuth sector iaz, 0 outside >*/
+uint32_t segyfold_at(const segy_fold* f, int ix, int iy, int ioff, int iaz);
+
+/*< print the grid and the fold statistics of every layer >*/
+void segyfold_print(const segy_fold* f, FILE* out);
+
+/*< write the fold array as little-endian uint32, x fastest, return 1 on success >*/
+int segyfold_save_raw(const segy_fold* f, const char* path);
+
+/*< free the fold map >*/
+void segyfold_free(segy_fold* f);
+
+#endif
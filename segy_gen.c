@@ -0,0 +1,374 @@
+/* Synthetic SEGY generator for load and scale testing */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "segy.h"
+#include "segy_gen.h"
+#include "segy_internal.h"
+
+#define GEN_COSCALE 10  /* coordinates are written in decimeters, scalco = -10 */
+#define GEN_FPEAK 25.0f /* peak frequency of the ricker wavelet (Hz) */
+
+/* splitmix64, a counter based generator: the random stream of a trace
+ depends only on (seed, itrace), so the file does not depend on threads */
+static inline uint64_t gen_mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+/* uniform in [0,1) from the upper 24 bits */
+static inline float gen_unit(uint64_t x) {
+  return (float)(x >> 40) * (1.0f / 16777216.0f);
+}
+
+static inline uint64_t gen_tracekey(const segygen_opt* opt, size_t itrace) {
+  return gen_mix(opt->seed ^ gen_mix((uint64_t)itrace));
+}
+
+static int gen_isdead(const segygen_opt* opt, size_t itrace) {
+  return gen_unit(gen_mix(gen_tracekey(opt, itrace) + 1)) < opt->dead_ratio;
+}
+
+/* live samples of a trace, shorter than ns for a short_ratio fraction */
+static int gen_livens(const segygen_opt* opt, size_t itrace) {
+  uint64_t key = gen_tracekey(opt, itrace);
+  if (gen_unit(gen_mix(key + 2)) >= opt->short_ratio)
+    return opt->ns;
+  int nlive = (int)(opt->ns * (0.5f + 0.5f * gen_unit(gen_mix(key + 3))));
+  return nlive < 1 ? 1 : nlive;
+}
+
+void segygen_default(segygen_opt* opt) {
+  memset(opt, 0, sizeof(*opt));
+  opt->ns = 1000;
+  opt->dt = 0.002f;
+  opt->format = 5;
+  opt->qkey = -1;
+  opt->geometry = SEGYGEN_2D;
+  opt->ncdp = 1000;
+  opt->nil = 100;
+  opt->nxl = 100;
+  opt->il0 = 1;
+  opt->xl0 = 1;
+  opt->nshot = 100;
+  opt->nchan = 96;
+  opt->dx = 12.5f;
+  opt->dy = 12.5f;
+  opt->dshot = 50.0f;
+  opt->offset0 = 100.0f;
+  opt->doffset = 25.0f;
+  opt->vel = 2500.0f;
+  opt->nevent = 12;
+  opt->noise = 0.05f;
+  opt->dead_ratio = 0.0f;
+  opt->short_ratio = 0.0f;
+  opt->seed = 20250101ULL;
+  opt->nthreads = 0;
+  opt->chunk = 1024;
+}
+
+size_t segygen_ntrace(const segygen_opt* opt) {
+  switch (opt->geometry) {
+    case SEGYGEN_2D:
+      return (size_t)opt->ncdp;
+    case SEGYGEN_3D:
+      return (size_t)opt->nil * (size_t)opt->nxl;
+    case SEGYGEN_SHOT2D:
+      return (size_t)opt->nshot * (size_t)opt->nchan;
+    case SEGYGEN_CDP3D:
+      return (size_t)opt->nil * (size_t)opt->nxl * (size_t)opt->nchan;
+    default:
+      errorinfo("segygen: unknown geometry %d", opt->geometry);
+  }
+  return 0;
+}
+
+/* position of a trace: cdp coordinates, offset and the gather it belongs to */
+typedef struct {
+  size_t icdp;   /* cdp (2D/3D/CDP3D) or shot (SHOT2D) index */
+  int ich;       /* channel/offset index inside the gather */
+  int il, xl;    /* inline/crossline number */
+  float cdpx, cdpy, sx, sy, gx, gy, offset;
+} gen_pos;
+
+static void gen_position(const segygen_opt* opt, size_t itrace, gen_pos* p) {
+  memset(p, 0, sizeof(*p));
+  switch (opt->geometry) {
+    case SEGYGEN_2D:
+      p->icdp = itrace;
+      p->cdpx = p->sx = p->gx = (float)itrace * opt->dx;
+      break;
+    case SEGYGEN_3D:
+    case SEGYGEN_CDP3D: {
+      size_t icdp = (SEGYGEN_3D == opt->geometry) ? itrace : itrace / opt->nchan;
+      p->icdp = icdp;
+      p->ich = (SEGYGEN_3D == opt->geometry) ? 0 : (int)(itrace % opt->nchan);
+      p->il = opt->il0 + (int)(icdp / opt->nxl);
+      p->xl = opt->xl0 + (int)(icdp % opt->nxl);
+      p->cdpx = (float)(p->xl - opt->xl0) * opt->dx;
+      p->cdpy = (float)(p->il - opt->il0) * opt->dy;
+      if (SEGYGEN_CDP3D == opt->geometry)
+        p->offset = opt->offset0 + p->ich * opt->doffset;
+      p->sx = p->cdpx - 0.5f * p->offset;
+      p->gx = p->cdpx + 0.5f * p->offset;
+      p->sy = p->gy = p->cdpy;
+      break;
+    }
+    case SEGYGEN_SHOT2D:
+      p->icdp = itrace / opt->nchan;
+      p->ich = (int)(itrace % opt->nchan);
+      p->offset = opt->offset0 + p->ich * opt->doffset;
+      p->sx = (float)p->icdp * opt->dshot;
+      p->gx = p->sx + p->offset;
+      p->cdpx = 0.5f * (p->sx + p->gx);
+      break;
+    default:
+      errorinfo("segygen: unknown geometry %d", opt->geometry);
+  }
+}
+
+void segygen_head(const segygen_opt* opt, size_t itrace, int* thead) {
+  gen_pos p;
+  gen_position(opt, itrace, &p);
+  memset(thead, 0, sizeof(int) * SEGY_THNKEYS);
+
+  thead[segykey("tracl")] = (int)(itrace + 1);
+  thead[segykey("tracr")] = (int)(itrace + 1);
+  thead[segykey("trid")] = gen_isdead(opt, itrace) ? 2 : 1;
+  /* short traces are zero-tailed to the fixed length of the binary header */
+  thead[segykey("ns")] = opt->ns;
+  thead[segykey("dt")] = (int)(opt->dt * 1000000.0f + 0.5f);
+  thead[segykey("scalco")] = -GEN_COSCALE;
+  thead[segykey("scalel")] = 1;
+  thead[segykey("counit")] = 1;
+  thead[segykey("sx")] = (int)lrintf(p.sx * GEN_COSCALE);
+  thead[segykey("sy")] = (int)lrintf(p.sy * GEN_COSCALE);
+  thead[segykey("gx")] = (int)lrintf(p.gx * GEN_COSCALE);
+  thead[segykey("gy")] = (int)lrintf(p.gy * GEN_COSCALE);
+  thead[segykey("cdpx")] = (int)lrintf(p.cdpx * GEN_COSCALE);
+  thead[segykey("cdpy")] = (int)lrintf(p.cdpy * GEN_COSCALE);
+  thead[segykey("offset")] = (int)lrintf(p.offset);
+
+  switch (opt->geometry) {
+    case SEGYGEN_2D:
+      thead[segykey("cdp")] = (int)(p.icdp + 1);
+      thead[segykey("cdpt")] = 1;
+      thead[segykey("ep")] = (int)(p.icdp + 1);
+      break;
+    case SEGYGEN_3D:
+    case SEGYGEN_CDP3D:
+      thead[segykey("cdp")] = (int)(p.icdp + 1);
+      thead[segykey("cdpt")] = p.ich + 1;
+      thead[segykey("iline")] = p.il;
+      thead[segykey("xline")] = p.xl;
+      break;
+    case SEGYGEN_SHOT2D:
+      thead[segykey("fldr")] = (int)(p.icdp + 1);
+      thead[segykey("ep")] = (int)(p.icdp + 1);
+      thead[segykey("tracf")] = p.ich + 1;
+      thead[segykey("cdp")] = (int)floorf(p.cdpx / opt->dx) + 1;
+      break;
+  }
+}
+
+/* ricker wavelet w[2*nhalf+1] sampled with dt */
+static float* gen_wavelet(const segygen_opt* opt, int* nhalf) {
+  *nhalf = (int)(1.2f / GEN_FPEAK / opt->dt);
+  if (*nhalf < 1)
+    *nhalf = 1;
+  int nw = 2 * *nhalf + 1;
+  float* w = (float*)malloc(sizeof(float) * nw);
+  if (!w)
+    errorinfo("malloc failed for segygen wavelet");
+  for (int i = 0; i < nw; i++) {
+    float t = (i - *nhalf) * opt->dt;
+    float a = (float)(M_PI * M_PI) * GEN_FPEAK * GEN_FPEAK * t * t;
+    w[i] = (1.0f - 2.0f * a) * expf(-a);
+  }
+  return w;
+}
+
+/* events with hyperbolic moveout plus uniform noise, zero after the live part */
+static int gen_fill(const segygen_opt* opt, const float* w, int nhalf,
+                    size_t itrace, float* trace) {
+  int ns = opt->ns;
+  memset(trace, 0, sizeof(float) * ns);
+  if (gen_isdead(opt, itrace))
+    return 0;
+
+  gen_pos p;
+  gen_position(opt, itrace, &p);
+  int nlive = gen_livens(opt, itrace);
+  float tmax = ns * opt->dt;
+  float x2 = p.offset * p.offset / (opt->vel * opt->vel);
+
+  for (int ie = 0; ie < opt->nevent; ie++) {
+    /* event layout depends on the seed only, with a gentle dip across the survey */
+    uint64_t ekey = gen_mix(opt->seed + 7919ULL * (uint64_t)(ie + 1));
+    float t0 = tmax * (ie + 0.5f + 0.5f * gen_unit(ekey)) / (opt->nevent + 1);
+    float dip = 2e-5f * (gen_unit(gen_mix(ekey)) - 0.5f);
+    float amp = (gen_unit(gen_mix(ekey + 1)) < 0.5f ? -1.0f : 1.0f) *
+                (0.3f + 0.7f * gen_unit(gen_mix(ekey + 2)));
+    t0 += dip * (p.cdpx + p.cdpy);
+    float t = sqrtf(t0 * t0 + x2);
+    int it = (int)lrintf(t / opt->dt);
+    int i0 = it - nhalf < 0 ? 0 : it - nhalf;
+    int i1 = it + nhalf + 1 > nlive ? nlive : it + nhalf + 1;
+    for (int i = i0; i < i1; i++)
+      trace[i] += amp * w[i - it + nhalf];
+  }
+
+  if (opt->noise > 0.0f) {
+    uint64_t s = gen_mix(gen_tracekey(opt, itrace) + 4) | 1;
+    float a = 2.0f * opt->noise;
+    for (int i = 0; i < nlive; i++) {
+      s ^= s >> 12;
+      s ^= s << 25;
+      s ^= s >> 27;
+      trace[i] += a * (gen_unit(s * 0x2545F4914F6CDD1DULL) - 0.5f);
+    }
+  }
+
+  if ((2 == opt->format || 3 == opt->format || 8 == opt->format) && opt->qkey < 0) {
+    float gain = (3 == opt->format) ? 8000.0f : (8 == opt->format) ? 30.0f : 1.0e6f;
+    for (int i = 0; i < nlive; i++)
+      trace[i] *= gain;
+  }
+  return 1;
+}
+
+int segygen_trace(const segygen_opt* opt, size_t itrace, float* trace) {
+  int nhalf;
+  float* w = gen_wavelet(opt, &nhalf);
+  int live = gen_fill(opt, w, nhalf, itrace, trace);
+  free(w);
+  return live;
+}
+
+static void gen_texthead(char* text, const segygen_opt* opt, size_t ntrace) {
+  static const char* geom[] = {"2D STACK", "3D STACK", "2D SHOT GATHERS",
+                               "3D CDP GATHERS"};
+  char line[81];
+  memset(text, ' ', SEGY_EBCBYTES);
+  for (int i = 0; i < 40; i++) {
+    switch (i) {
+      case 0:
+        snprintf(line, sizeof(line), "C 1 SYNTHETIC SEGY GENERATED BY EASYSEGY SEGYGEN");
+        break;
+      case 1:
+        snprintf(line, sizeof(line), "C 2 GEOMETRY %s  TRACES %zu",
+                 geom[opt->geometry], ntrace);
+        break;
+      case 2:
+        snprintf(line, sizeof(line), "C 3 NS %d  DT %g S  FORMAT %d", opt->ns,
+                 opt->dt, opt->format);
+        break;
+      case 3:
+        snprintf(line, sizeof(line), "C 4 SEED %llu  DEAD %g  SHORT %g",
+                 opt->seed, opt->dead_ratio, opt->short_ratio);
+        break;
+      case 4:
+        snprintf(line, sizeof(line), "C 5 COORDINATES SCALCO -%d", GEN_COSCALE);
+        break;
+      default:
+        snprintf(line, sizeof(line), "C%2d", i + 1);
+    }
+    memcpy(text + 80 * i, line, strlen(line));
+  }
+  memcpy(text + 80 * 39, "C40 END TEXTUAL HEADER", 22);
+}
+
+size_t segygen_write(FILE* fp, const segygen_opt* opt) {
+  if (opt->ns <= 0 || opt->ns > 32767)
+    errorinfo("segygen: ns %d out of range", opt->ns);
+  if (1 != opt->format && 2 != opt->format && 3 != opt->format && 5 != opt->format &&
+      8 != opt->format)
+    errorinfo("segygen: not support format %d", opt->format);
+
+  size_t ntrace = segygen_ntrace(opt);
+  size_t chunk = opt->chunk > 0 ? opt->chunk : 1024;
+  segyfile segyf = segyfile_init_write(fp, opt->ns, opt->dt, opt->format, ntrace);
+  segyfile_set_quantize(segyf, opt->qkey);
+
+  gen_texthead(segyf->textraw, opt, ntrace);
+  segywrite_texthead(segyf, 0, 1);
+  int ensemble = (SEGYGEN_SHOT2D == opt->geometry || SEGYGEN_CDP3D == opt->geometry);
+  segyf->bhead[segybhkey("ntrpr")] = ensemble ? opt->nchan : 1;
+  segyf->bhead[segybhkey("tsort")] = (SEGYGEN_SHOT2D == opt->geometry) ? 1
+                                     : (SEGYGEN_CDP3D == opt->geometry) ? 2
+                                                                        : 4;
+  segyf->bhead[segybhkey("mfeet")] = 1;
+  segywrite_binaryhead(segyf);
+  if (fflush(fp))
+    errorinfo("segygen: error writing headers");
+
+  int nhalf;
+  float* w = gen_wavelet(opt, &nhalf);
+  size_t nblock = (ntrace + chunk - 1) / chunk;
+  size_t nwritten = 0;
+  int failed = 0;
+  int nthreads = opt->nthreads;
+#ifdef _OPENMP
+  if (nthreads <= 0)
+    nthreads = omp_get_max_threads();
+#else
+  nthreads = 1;
+#endif
+
+#pragma omp parallel num_threads(nthreads) reduction(+ : nwritten) reduction(| : failed)
+  {
+    char* buf = (char*)malloc(chunk * segyf->nsegy);
+    float* trace = (float*)malloc(sizeof(float) * opt->ns);
+    int thead[SEGY_THNKEYS];
+    if (!buf || !trace)
+      errorinfo("malloc failed for segygen buffers");
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t ib = 0; ib < nblock; ib++) {
+      size_t itr0 = ib * chunk;
+      size_t n = (itr0 + chunk > ntrace) ? ntrace - itr0 : chunk;
+      for (size_t j = 0; j < n; j++) {
+        char* rec = buf + j * segyf->nsegy;
+        memset(rec, 0, SEGY_THNBYTES);
+        segygen_head(opt, itr0 + j, thead);
+        head2segy(rec, thead, SEGY_THNKEYS);
+        gen_fill(opt, w, nhalf, itr0 + j, trace);
+        segyquant_encode(segyf, rec, trace);
+      }
+      if (segy_write_at(segyf, buf, n * segyf->nsegy, segy_trace_offset(segyf, itr0))) {
+        segy_count_traces_written(segyf, n);
+        nwritten += n;
+      }
+      else
+        failed = 1;
+    }
+    free(trace);
+    free(buf);
+  }
+
+  if (failed)
+    warninginfo("segygen: error writing traces, %zu of %zu written", nwritten, ntrace);
+  /* leave the stream at the end of the written data */
+  segy_seek(segyf, segy_trace_offset(segyf, ntrace), SEEK_SET);
+  free(w);
+  segyfile_free(segyf);
+  return nwritten;
+}
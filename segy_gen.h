@@ -0,0 +1,58 @@
+/* Synthetic SEGY generator for load and scale testing */
+#ifndef _segy_gen_h
+#define _segy_gen_h
+
+#include <stdio.h>
+#include "segy.h"
+
+/* geometry of the generated survey */
+enum {
+  SEGYGEN_2D = 0,    /* 2D stacked line: ncdp traces, cdp/cdpx */
+  SEGYGEN_3D = 1,    /* 3D stacked cube: nil x nxl traces, iline/xline */
+  SEGYGEN_SHOT2D = 2, /* 2D prestack shot gathers: nshot x nchan, fldr/offset */
+  SEGYGEN_CDP3D = 3, /* 3D prestack cdp gathers: nil x nxl x nchan, iline/xline/offset */
+};
+
+/** options of the synthetic generator, fill with segygen_default first */
+typedef struct {
+  int ns;            /* samples per trace */
+  float dt;          /* sample interval in seconds */
+  int format;        /* sample format: 1 IBM, 2 int4, 3 int2, 5 IEEE, 8 int1 */
+  int qkey;          /* integer formats: header key of a per-trace quantization exponent
+                        (segyfile_set_quantize), -1 for a fixed gain */
+  int geometry;      /* SEGYGEN_* */
+  int ncdp;          /* SEGYGEN_2D: number of cdps */
+  int nil, nxl;      /* SEGYGEN_3D/CDP3D: inline and crossline count */
+  int il0, xl0;      /* first inline and crossline number */
+  int nshot, nchan;  /* SEGYGEN_SHOT2D: shots and channels, CDP3D: offsets per cdp */
+  float dx, dy;      /* cdp (or group) interval along inline and crossline (m) */
+  float dshot;       /* SEGYGEN_SHOT2D: shot interval (m) */
+  float offset0;     /* first offset (m) */
+  float doffset;     /* offset increment (m) */
+  float vel;         /* velocity of the moveout (m/s) */
+  int nevent;        /* number of reflection events */
+  float noise;       /* noise amplitude relative to the events */
+  float dead_ratio;  /* fraction of dead traces (trid=2, zero samples) */
+  float short_ratio; /* fraction of traces with a shorter live length */
+  unsigned long long seed; /* random seed, same seed gives the same file */
+  int nthreads;      /* threads, 0 means all available */
+  size_t chunk;      /* traces encoded and written per block */
+} segygen_opt;
+
+/*< fill the generator options with a small 2D IEEE line >*/
+void segygen_default(segygen_opt* opt);
+
+/*< number of traces the options describe >*/
+size_t segygen_ntrace(const segygen_opt* opt);
+
+/*< fill the header thead[SEGY_THNKEYS] of trace itrace >*/
+void segygen_head(const segygen_opt* opt, size_t itrace, int* thead);
+
+/*< fill the samples trace[ns] of trace itrace, return 0 for dead traces >*/
+int segygen_trace(const segygen_opt* opt, size_t itrace, float* trace);
+
+/*< write the whole synthetic file (text, binary header and traces) to fp
+-- return the number of traces written >*/
+size_t segygen_write(FILE* fp, const segygen_opt* opt);
+
+#endif
@@ -0,0 +1,498 @@
+/* Compressed resident trace header store with random access and column scans */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_hstore.h"
+#include "segy_internal.h"
+
+#define HSTORE_SHIFT 12                     /* log2 of the traces per block */
+#define HSTORE_BLOCK (1 << HSTORE_SHIFT)
+#define HSTORE_SEGBLOCKS 16                 /* blocks decoded per header scan */
+#define HSTORE_SEGROWS (HSTORE_BLOCK * HSTORE_SEGBLOCKS)
+#define HSTORE_MAXDICT 256
+#define HSTORE_HASHBITS 9                   /* slots of the dictionary hash, twice MAXDICT */
+#define HSTORE_SCRATCH (HSTORE_BLOCK / 2)   /* words of the largest block, 32 bits a trace */
+
+/* one block of one column, the packed bits start at word off of the column */
+typedef struct {
+  int64_t base;      /* CONST: the value, FOR: the min, DELTA: value of row 0 less the
+                        smallest residual */
+  int64_t step;      /* DELTA: added per row */
+  int32_t min, max;  /* zone map for scans */
+  uint64_t off;
+  uint8_t enc;       /* SEGY_HSTORE_* */
+  uint8_t bits;      /* bits per packed value */
+  uint16_t ndict;    /* DICT: entries, 32 bits each before the codes */
+} hs_block;
+
+typedef struct {
+  int key;
+  hs_block* blk;     /* nblock */
+  uint64_t* words;
+  size_t nword, capword;
+} hs_column;
+
+struct segy_hstore {
+  size_t ntrace;
+  size_t nblock;
+  int ncol;
+  int colof[SEGY_THNKEYS];  /* column of every key, -1 if not stored */
+  hs_column* col;
+};
+
+/* bits to hold 0..x */
+static inline int hs_width(uint64_t x) {
+  return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+/* b <= 32 bits at bit pos, the words are zeroed first */
+static inline void hs_put(uint64_t* w, uint64_t pos, int b, uint64_t x) {
+  uint64_t i = pos >> 6;
+  int s = (int)(pos & 63);
+  w[i] |= x << s;
+  if (s + b > 64)
+    w[i + 1] |= x >> (64 - s);
+}
+
+static inline uint64_t hs_get(const uint64_t* w, uint64_t pos, int b) {
+  if (0 == b)
+    return 0;
+  uint64_t i = pos >> 6;
+  int s = (int)(pos & 63);
+  uint64_t x = w[i] >> s;
+  if (s + b > 64)
+    x |= w[i + 1] << (64 - s);
+  return x & ((1ULL << b) - 1);
+}
+
+/* row r of block b */
+static inline int32_t hs_value(const hs_column* c, const hs_block* b, size_t r) {
+  const uint64_t* w = c->words + b->off;
+  switch (b->enc) {
+    case SEGY_HSTORE_CONST:
+      return (int32_t)b->base;
+    case SEGY_HSTORE_FOR:
+      return (int32_t)(b->base + (int64_t)hs_get(w, r * b->bits, b->bits));
+    case SEGY_HSTORE_DELTA:
+      return (int32_t)(b->base + b->step * (int64_t)r + (int64_t)hs_get(w, r * b->bits, b->bits));
+    default:
+      return (int32_t)hs_get(w, 32 * hs_get(w, 32 * (uint64_t)b->ndict + r * b->bits, b->bits), 32);
+  }
+}
+
+/* rows [r0, r0 + n) of block b into out[n] */
+static void hs_decode(const hs_column* c, const hs_block* b, size_t r0, size_t n, int32_t* out) {
+  const uint64_t* w = c->words + b->off;
+  int bits = b->bits;
+  switch (b->enc) {
+    case SEGY_HSTORE_CONST:
+      for (size_t i = 0; i < n; i++)
+        out[i] = (int32_t)b->base;
+      break;
+    case SEGY_HSTORE_FOR:
+      for (size_t i = 0; i < n; i++)
+        out[i] = (int32_t)(b->base + (int64_t)hs_get(w, (r0 + i) * bits, bits));
+      break;
+    case SEGY_HSTORE_DELTA:
+      for (size_t i = 0; i < n; i++)
+        out[i] = (int32_t)(b->base + b->step * (int64_t)(r0 + i) +
+                           (int64_t)hs_get(w, (r0 + i) * bits, bits));
+      break;
+    default: {
+      int32_t dict[HSTORE_MAXDICT];
+      for (int j = 0; j < b->ndict; j++)
+        dict[j] = (int32_t)hs_get(w, 32 * (uint64_t)j, 32);
+      uint64_t pos = 32 * (uint64_t)b->ndict;
+      for (size_t i = 0; i < n; i++)
+        out[i] = dict[hs_get(w, pos + (r0 + i) * bits, bits)];
+      break;
+    }
+  }
+}
+
+/* choose the smallest encoding of v[n] for b and pack it into the zeroed w, return
+   the words used */
+static size_t hs_encode(const int32_t* v, size_t n, hs_block* b, uint64_t* w) {
+  int32_t mn = v[0], mx = v[0];
+#pragma omp simd reduction(min : mn) reduction(max : mx)
+  for (size_t i = 0; i < n; i++) {
+    mn = v[i] < mn ? v[i] : mn;
+    mx = v[i] > mx ? v[i] : mx;
+  }
+  memset(b, 0, sizeof(*b));
+  b->min = mn;
+  b->max = mx;
+  b->enc = SEGY_HSTORE_CONST;
+  b->base = mn;
+  if (mn == mx)
+    return 0;
+
+  b->enc = SEGY_HSTORE_FOR;
+  b->bits = (uint8_t)hs_width((uint64_t)((int64_t)mx - mn));
+  uint64_t best = n * (uint64_t)b->bits;
+
+  /* a straight line through the first and last rows, residuals around it */
+  int64_t step = n > 1 ? ((int64_t)v[n - 1] - v[0]) / (int64_t)(n - 1) : 0;
+  if (step) {
+    int64_t rmin = 0, rmax = 0;
+    for (size_t i = 0; i < n; i++) {
+      int64_t r = (int64_t)v[i] - v[0] - step * (int64_t)i;
+      rmin = r < rmin ? r : rmin;
+      rmax = r > rmax ? r : rmax;
+    }
+    int bits = hs_width((uint64_t)(rmax - rmin));
+    if (bits <= 32 && n * (uint64_t)bits < best) {
+      b->enc = SEGY_HSTORE_DELTA;
+      b->base = v[0] + rmin;
+      b->step = step;
+      b->bits = (uint8_t)bits;
+      best = n * (uint64_t)bits;
+    }
+  }
+
+  /* dictionary, given up past HSTORE_MAXDICT distinct values */
+  int32_t dict[HSTORE_MAXDICT];
+  int16_t slot[1 << HSTORE_HASHBITS];
+  uint8_t code[HSTORE_BLOCK];
+  int ndict = 0;
+  memset(slot, -1, sizeof(slot));
+  for (size_t i = 0; i < n && ndict <= HSTORE_MAXDICT; i++) {
+    uint32_t h = ((uint32_t)v[i] * 2654435761u) >> (32 - HSTORE_HASHBITS);
+    while (slot[h] >= 0 && dict[slot[h]] != v[i])
+      h = (h + 1) & ((1 << HSTORE_HASHBITS) - 1);
+    if (slot[h] < 0) {
+      if (HSTORE_MAXDICT == ndict) {
+        ndict++;
+        break;
+      }
+      slot[h] = (int16_t)ndict;
+      dict[ndict++] = v[i];
+    }
+    code[i] = (uint8_t)slot[h];
+  }
+  if (ndict <= HSTORE_MAXDICT) {
+    int bits = hs_width((uint64_t)(ndict - 1));
+    if (32 * (uint64_t)ndict + n * (uint64_t)bits < best) {
+      b->enc = SEGY_HSTORE_DICT;
+      b->ndict = (uint16_t)ndict;
+      b->bits = (uint8_t)bits;
+      best = 32 * (uint64_t)ndict + n * (uint64_t)bits;
+    }
+  }
+
+  switch (b->enc) {
+    case SEGY_HSTORE_FOR:
+      for (size_t i = 0; i < n; i++)
+        hs_put(w, i * b->bits, b->bits, (uint64_t)((int64_t)v[i] - b->base));
+      break;
+    case SEGY_HSTORE_DELTA:
+      for (size_t i = 0; i < n; i++)
+        hs_put(w, i * b->bits, b->bits,
+               (uint64_t)((int64_t)v[i] - b->base - b->step * (int64_t)i));
+      break;
+    default:
+      for (int j = 0; j < ndict; j++)
+        hs_put(w, 32 * (uint64_t)j, 32, (uint32_t)dict[j]);
+      for (size_t i = 0; i < n; i++)
+        hs_put(w, 32 * (uint64_t)ndict + i * b->bits, b->bits, code[i]);
+      break;
+  }
+  return (size_t)((best + 63) / 64);
+}
+
+/* the decoded columns of one segment of HSTORE_SEGROWS traces */
+typedef struct {
+  const segy_hstore* hs;
+  int32_t* vals;  /* ncol * HSTORE_SEGROWS */
+  size_t seg0;
+} hs_scan;
+
+static void hs_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg, int tid) {
+  (void)tid;
+  hs_scan* sc = (hs_scan*)arg;
+  for (int ic = 0; ic < sc->hs->ncol; ic++)
+    segy_decode_column(buf, stride, n, sc->hs->col[ic].key,
+                       sc->vals + (size_t)ic * HSTORE_SEGROWS + (itr0 - sc->seg0));
+}
+
+static void hs_append(hs_column* c, hs_block* b, const uint64_t* w, size_t nw) {
+  if (c->nword + nw > c->capword) {
+    size_t cap = c->capword ? 2 * c->capword : 1024;
+    while (cap < c->nword + nw)
+      cap *= 2;
+    uint64_t* p = (uint64_t*)realloc(c->words, sizeof(uint64_t) * cap);
+    if (!p)
+      errorinfo("malloc failed for the header store of %s", segykeyword(c->key));
+    c->words = p;
+    c->capword = cap;
+  }
+  b->off = c->nword;
+  memcpy(c->words + c->nword, w, sizeof(uint64_t) * nw);
+  c->nword += nw;
+}
+
+segy_hstore* segyhstore_build(segyfile segyf, const int* keys, int nkey, int nthreads) {
+  int all[SEGY_THNKEYS];
+  if (!keys) {
+    for (int k = 0; k < SEGY_THNKEYS; k++)
+      all[k] = k;
+    keys = all;
+    nkey = SEGY_THNKEYS;
+  }
+  segy_hstore* hs = (segy_hstore*)calloc(1, sizeof(segy_hstore));
+  if (!hs || !(hs->col = (hs_column*)calloc(nkey > 0 ? nkey : 1, sizeof(hs_column))))
+    errorinfo("malloc failed for the header store");
+  for (int k = 0; k < SEGY_THNKEYS; k++)
+    hs->colof[k] = -1;
+  hs->ntrace = segyf->ntrace;
+  hs->nblock = (hs->ntrace + HSTORE_BLOCK - 1) / HSTORE_BLOCK;
+  for (int i = 0; i < nkey; i++) {
+    if (keys[i] < 0 || keys[i] >= SEGY_THNKEYS)
+      errorinfo("header store: no such key index %d", keys[i]);
+    if (hs->colof[keys[i]] >= 0)
+      continue;
+    hs_column* c = &hs->col[hs->ncol];
+    c->key = keys[i];
+    c->blk = (hs_block*)malloc(sizeof(hs_block) * (hs->nblock > 0 ? hs->nblock : 1));
+    if (!c->blk)
+      errorinfo("malloc failed for the header store");
+    hs->colof[keys[i]] = hs->ncol++;
+  }
+
+  size_t ntask = (size_t)hs->ncol * HSTORE_SEGBLOCKS;
+  int32_t* vals = (int32_t*)malloc(sizeof(int32_t) * HSTORE_SEGROWS * (hs->ncol > 0 ? hs->ncol : 1));
+  uint64_t* scratch = (uint64_t*)malloc(sizeof(uint64_t) * HSTORE_SCRATCH * (ntask > 0 ? ntask : 1));
+  size_t* nw = (size_t*)malloc(sizeof(size_t) * (ntask > 0 ? ntask : 1));
+  if (!vals || !scratch || !nw)
+    errorinfo("malloc failed for the header store buffers");
+
+  int failed = 0;
+  nthreads = segy_nthreads(nthreads);
+  for (size_t seg0 = 0; seg0 < hs->ntrace && hs->ncol > 0; seg0 += HSTORE_SEGROWS) {
+    size_t n = hs->ntrace - seg0 < HSTORE_SEGROWS ? hs->ntrace - seg0 : HSTORE_SEGROWS;
+    hs_scan sc = {hs, vals, seg0};
+    if (n != segy_scan_headers(segyf, seg0, n, nthreads, hs_batch, &sc)) {
+      failed = 1;
+      break;
+    }
+    size_t nb = (n + HSTORE_BLOCK - 1) / HSTORE_BLOCK;
+    size_t blk0 = seg0 / HSTORE_BLOCK;
+    size_t nt = (size_t)hs->ncol * nb;
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (size_t t = 0; t < nt; t++) {
+      size_t ic = t / nb, ib = t % nb;
+      size_t rows = (ib + 1) * HSTORE_BLOCK > n ? n - ib * HSTORE_BLOCK : HSTORE_BLOCK;
+      uint64_t* w = scratch + t * HSTORE_SCRATCH;
+      memset(w, 0, sizeof(uint64_t) * HSTORE_SCRATCH);
+      nw[t] = hs_encode(vals + ic * HSTORE_SEGROWS + ib * HSTORE_BLOCK, rows,
+                        &hs->col[ic].blk[blk0 + ib], w);
+    }
+    for (size_t t = 0; t < nt; t++) {
+      hs_column* c = &hs->col[t / nb];
+      hs_append(c, &c->blk[blk0 + t % nb], scratch + t * HSTORE_SCRATCH, nw[t]);
+    }
+  }
+  free(vals);
+  free(scratch);
+  free(nw);
+  if (failed) {
+    warninginfo("header store: cannot read the trace headers");
+    segyhstore_free(hs);
+    return NULL;
+  }
+  /* give back the slack of the doubling */
+  for (int ic = 0; ic < hs->ncol; ic++) {
+    hs_column* c = &hs->col[ic];
+    if (c->nword < c->capword && c->nword > 0) {
+      uint64_t* p = (uint64_t*)realloc(c->words, sizeof(uint64_t) * c->nword);
+      if (p) {
+        c->words = p;
+        c->capword = c->nword;
+      }
+    }
+  }
+  return hs;
+}
+
+size_t segyhstore_ntrace(const segy_hstore* hs) {
+  return hs->ntrace;
+}
+
+int segyhstore_has(const segy_hstore* hs, int k) {
+  return k >= 0 && k < SEGY_THNKEYS && hs->colof[k] >= 0;
+}
+
+static const hs_column* hs_col(const segy_hstore* hs, int k) {
+  if (!segyhstore_has(hs, k))
+    errorinfo("header store: key %d is not stored", k);
+  return &hs->col[hs->colof[k]];
+}
+
+int32_t segyhstore_get(const segy_hstore* hs, size_t itr, int k) {
+  const hs_column* c = hs_col(hs, k);
+  if (itr >= hs->ntrace)
+    errorinfo("header store: trace %zu past %zu traces", itr, hs->ntrace);
+  return hs_value(c, &c->blk[itr >> HSTORE_SHIFT], itr & (HSTORE_BLOCK - 1));
+}
+
+void segyhstore_row(const segy_hstore* hs, size_t itr, int* thead) {
+  if (itr >= hs->ntrace)
+    errorinfo("header store: trace %zu past %zu traces", itr, hs->ntrace);
+  memset(thead, 0, sizeof(int) * SEGY_THNKEYS);
+  for (int ic = 0; ic < hs->ncol; ic++) {
+    const hs_column* c = &hs->col[ic];
+    thead[c->key] = hs_value(c, &c->blk[itr >> HSTORE_SHIFT], itr & (HSTORE_BLOCK - 1));
+  }
+}
+
+size_t segyhstore_column(const segy_hstore* hs, int k, size_t itr0, size_t n, int32_t* out) {
+  const hs_column* c = hs_col(hs, k);
+  if (itr0 >= hs->ntrace)
+    return 0;
+  if (n > hs->ntrace - itr0)
+    n = hs->ntrace - itr0;
+  size_t done = 0;
+  while (done < n) {
+    size_t itr = itr0 + done;
+    size_t r0 = itr & (HSTORE_BLOCK - 1);
+    size_t m = HSTORE_BLOCK - r0 < n - done ? HSTORE_BLOCK - r0 : n - done;
+    hs_decode(c, &c->blk[itr >> HSTORE_SHIFT], r0, m, out + done);
+    done += m;
+  }
+  return n;
+}
+
+/* rows of block ib */
+static inline size_t hs_rows(const segy_hstore* hs, size_t ib) {
+  return (ib + 1) * HSTORE_BLOCK > hs->ntrace ? hs->ntrace - ib * HSTORE_BLOCK : HSTORE_BLOCK;
+}
+
+size_t segyhstore_select(const segy_hstore* hs, int k, int32_t lo, int32_t hi, size_t* idx,
+                         size_t maxidx, int nthreads) {
+  const hs_column* c = hs_col(hs, k);
+  if (lo > hi || 0 == hs->nblock)
+    return 0;
+  size_t* first = (size_t*)malloc(sizeof(size_t) * (hs->nblock + 1));
+  if (!first)
+    errorinfo("malloc failed for a header store scan");
+  nthreads = segy_nthreads(nthreads);
+
+  /* count the matches of every block, then place them */
+#pragma omp parallel num_threads(nthreads)
+  {
+    int32_t buf[HSTORE_BLOCK];
+#pragma omp for schedule(dynamic, 16)
+    for (size_t ib = 0; ib < hs->nblock; ib++) {
+      const hs_block* b = &c->blk[ib];
+      size_t rows = hs_rows(hs, ib), cnt = 0;
+      if (b->min >= lo && b->max <= hi) {
+        cnt = rows;
+      } else if (b->max >= lo && b->min <= hi) {
+        hs_decode(c, b, 0, rows, buf);
+#pragma omp simd reduction(+ : cnt)
+        for (size_t i = 0; i < rows; i++)
+          cnt += (buf[i] >= lo) & (buf[i] <= hi);
+      }
+      first[ib + 1] = cnt;
+    }
+  }
+  first[0] = 0;
+  for (size_t ib = 0; ib < hs->nblock; ib++)
+    first[ib + 1] += first[ib];
+  size_t total = first[hs->nblock];
+
+  if (idx) {
+#pragma omp parallel num_threads(nthreads)
+    {
+      int32_t buf[HSTORE_BLOCK];
+#pragma omp for schedule(dynamic, 16)
+      for (size_t ib = 0; ib < hs->nblock; ib++) {
+        size_t j = first[ib], end = first[ib + 1] < maxidx ? first[ib + 1] : maxidx;
+        if (j >= end)
+          continue;
+        const hs_block* b = &c->blk[ib];
+        size_t rows = hs_rows(hs, ib), itr0 = ib * HSTORE_BLOCK;
+        if (b->min >= lo && b->max <= hi) {
+          for (size_t i = 0; j < end; i++)
+            idx[j++] = itr0 + i;
+        } else {
+          hs_decode(c, b, 0, rows, buf);
+          for (size_t i = 0; i < rows && j < end; i++)
+            if (buf[i] >= lo && buf[i] <= hi)
+              idx[j++] = itr0 + i;
+        }
+      }
+    }
+  }
+  free(first);
+  return total;
+}
+
+int segyhstore_range(const segy_hstore* hs, int k, int32_t* lo, int32_t* hi) {
+  if (!segyhstore_has(hs, k) || 0 == hs->nblock)
+    return 0;
+  const hs_column* c = &hs->col[hs->colof[k]];
+  int32_t mn = c->blk[0].min, mx = c->blk[0].max;
+  for (size_t ib = 1; ib < hs->nblock; ib++) {
+    mn = c->blk[ib].min < mn ? c->blk[ib].min : mn;
+    mx = c->blk[ib].max > mx ? c->blk[ib].max : mx;
+  }
+  *lo = mn;
+  *hi = mx;
+  return 1;
+}
+
+static size_t hs_column_bytes(const segy_hstore* hs, const hs_column* c) {
+  return sizeof(hs_block) * hs->nblock + sizeof(uint64_t) * c->capword;
+}
+
+size_t segyhstore_bytes(const segy_hstore* hs) {
+  size_t n = sizeof(segy_hstore) + sizeof(hs_column) * hs->ncol;
+  for (int ic = 0; ic < hs->ncol; ic++)
+    n += hs_column_bytes(hs, &hs->col[ic]);
+  return n;
+}
+
+void segyhstore_print(const segy_hstore* hs, FILE* out) {
+  static const char* name[SEGY_HSTORE_NENC] = {"const", "for", "delta", "dict"};
+  double ntr = hs->ntrace > 0 ? (double)hs->ntrace : 1;
+  fprintf(out, "%-8s %10s  %s\n", "key", "bits/trace", "blocks by encoding");
+  for (int ic = 0; ic < hs->ncol; ic++) {
+    const hs_column* c = &hs->col[ic];
+    size_t nenc[SEGY_HSTORE_NENC] = {0};
+    for (size_t ib = 0; ib < hs->nblock; ib++)
+      nenc[c->blk[ib].enc]++;
+    fprintf(out, "%-8s %10.3f ", segykeyword(c->key), 8 * hs_column_bytes(hs, c) / ntr);
+    for (int e = 0; e < SEGY_HSTORE_NENC; e++)
+      if (nenc[e])
+        fprintf(out, " %s %zu", name[e], nenc[e]);
+    fprintf(out, "\n");
+  }
+  size_t bytes = segyhstore_bytes(hs);
+  fprintf(out, "%zu traces, %d keys: %.1f MB, %.2f bytes/trace (%d as int rows)\n", hs->ntrace,
+          hs->ncol, bytes / 1e6, bytes / ntr, (int)sizeof(int) * hs->ncol);
+}
+
+void segyhstore_free(segy_hstore* hs) {
+  if (!hs)
+    return;
+  for (int ic = 0; ic < hs->ncol; ic++) {
+    free(hs->col[ic].blk);
+    free(hs->col[ic].words);
+  }
+  free(hs->col);
+  free(hs);
+}
@@ -0,0 +1,60 @@
+/* Compressed resident trace header store with random access and column scans */
+#ifndef _segy_hstore_h
+#define _segy_hstore_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "segy.h"
+
+enum {
+  SEGY_HSTORE_CONST = 0,  /* one value for the whole block */
+  SEGY_HSTORE_FOR = 1,    /* min of the block plus bit-packed offsets */
+  SEGY_HSTORE_DELTA = 2,  /* first value plus a constant step per trace plus bit-packed
+                             residuals, for counters and monotonic keys */
+  SEGY_HSTORE_DICT = 3,   /* up to 256 distinct values plus bit-packed codes */
+  SEGY_HSTORE_NENC = 4,
+};
+
+typedef struct segy_hstore segy_hstore;
+
+/*< decode keys[nkey] (NULL for every key) of all traces of segyf with a parallel
+-- header scan and keep them compressed in blocks of 4096 traces, every block of a
+-- column takes the smallest of the SEGY_HSTORE_* encodings >*/
+segy_hstore* segyhstore_build(segyfile segyf, const int* keys, int nkey, int nthreads);
+
+/*< number of traces >*/
+size_t segyhstore_ntrace(const segy_hstore* hs);
+
+/*< 1 if key k is stored >*/
+int segyhstore_has(const segy_hstore* hs, int k);
+
+/*< value of key k of trace itr >*/
+int32_t segyhstore_get(const segy_hstore* hs, size_t itr, int k);
+
+/*< header of trace itr into thead[SEGY_THNKEYS], keys not stored are 0 >*/
+void segyhstore_row(const segy_hstore* hs, size_t itr, int* thead);
+
+/*< key k of traces [itr0, itr0 + n) into out[n], return the traces decoded >*/
+size_t segyhstore_column(const segy_hstore* hs, int k, size_t itr0, size_t n, int32_t* out);
+
+/*< traces whose key k is in [lo, hi] into idx in ascending order, at most maxidx of
+-- them (idx NULL only counts), return how many there are; blocks outside [lo, hi] are
+-- skipped and blocks inside taken whole from their min and max, the others are
+-- decoded and compared in parallel >*/
+size_t segyhstore_select(const segy_hstore* hs, int k, int32_t lo, int32_t hi, size_t* idx,
+                         size_t maxidx, int nthreads);
+
+/*< smallest and largest value of key k, 0 if it is not stored >*/
+int segyhstore_range(const segy_hstore* hs, int k, int32_t* lo, int32_t* hi);
+
+/*< bytes held by the store >*/
+size_t segyhstore_bytes(const segy_hstore* hs);
+
+/*< print the bytes per trace and the encodings of every stored key >*/
+void segyhstore_print(const segy_hstore* hs, FILE* out);
+
+/*< free the store >*/
+void segyhstore_free(segy_hstore* hs);
+
+#endif
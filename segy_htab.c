@@ -0,0 +1,181 @@
+/* Columnar trace header tables */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_htab.h"
+#include "segy_internal.h"
+
+/* keys scaled by scalco and by scalel */
+static const char* scalco_keys[] = {"sx", "sy", "gx", "gy", "cdpx", "cdpy"};
+static const char* scalel_keys[] = {"gelev", "selev", "sdepth", "gdel",
+                                    "sdel",  "swdep", "gwdep"};
+
+/* 1 for scalco keys, 2 for scalel keys, 0 otherwise */
+static int htab_scaleby(int k) {
+  const char* name = segykeyword(k);
+  for (size_t i = 0; i < sizeof(scalco_keys) / sizeof(scalco_keys[0]); i++)
+    if (!strcmp(name, scalco_keys[i]))
+      return 1;
+  for (size_t i = 0; i < sizeof(scalel_keys) / sizeof(scalel_keys[0]); i++)
+    if (!strcmp(name, scalel_keys[i]))
+      return 2;
+  return 0;
+}
+
+int segykey_isscaled(int k) {
+  return htab_scaleby(k) != 0;
+}
+
+double segyscalar(int scalar) {
+  if (0 == scalar)
+    return 1.0;
+  return scalar > 0 ? (double)scalar : -1.0 / scalar;
+}
+
+typedef struct {
+  segy_htable* tab;
+  int* scaleby;  /* per column: 0, 1 (scalco) or 2 (scalel) */
+  int kscalco, kscalel;
+} htab_scan;
+
+static void htab_batch(const char* buf, size_t stride, size_t itr0, size_t n,
+                       void* arg, int tid) {
+  htab_scan* sc = (htab_scan*)arg;
+  segy_htable* tab = sc->tab;
+  size_t row = itr0 - tab->itr0;
+  int32_t* tmp = NULL;
+  int32_t* scalar = NULL;
+  (void)tid;
+
+  for (int ic = 0; ic < tab->ncol; ic++) {
+    if (!tab->isdouble[ic]) {
+      segy_decode_column(buf, stride, n, tab->keys[ic], (int32_t*)tab->cols[ic] + row);
+      continue;
+    }
+    if (!tmp) {
+      tmp = (int32_t*)malloc(sizeof(int32_t) * n * 2);
+      if (!tmp)
+        errorinfo("malloc failed for header table batch");
+      scalar = tmp + n;
+    }
+    segy_decode_column(buf, stride, n, tab->keys[ic], tmp);
+    segy_decode_column(buf, stride, n, 1 == sc->scaleby[ic] ? sc->kscalco : sc->kscalel,
+                       scalar);
+    double* out = (double*)tab->cols[ic] + row;
+    for (size_t j = 0; j < n; j++)
+      out[j] = (double)tmp[j] * segyscalar(scalar[j]);
+  }
+  free(tmp);
+}
+
+segy_htable* segyhtab_alloc(size_t ntrace, const int* keys, int nkey, int flags) {
+  segy_htable* tab = (segy_htable*)calloc(1, sizeof(segy_htable));
+  if (!tab)
+    errorinfo("malloc failed for header table");
+  tab->ntrace = ntrace;
+  tab->ncol = nkey;
+  tab->keys = (int*)malloc(sizeof(int) * (nkey > 0 ? nkey : 1));
+  tab->isdouble = (int*)malloc(sizeof(int) * (nkey > 0 ? nkey : 1));
+  tab->cols = (void**)calloc(nkey > 0 ? nkey : 1, sizeof(void*));
+  if (!tab->keys || !tab->isdouble || !tab->cols)
+    errorinfo("malloc failed for header table");
+
+  for (int ic = 0; ic < nkey; ic++) {
+    if (keys[ic] < 0 || keys[ic] >= SEGY_THNKEYS)
+      errorinfo("header table: no such key index %d", keys[ic]);
+    tab->keys[ic] = keys[ic];
+    tab->isdouble[ic] = (flags & SEGY_HTAB_SCALE) && htab_scaleby(keys[ic]);
+    size_t esize = tab->isdouble[ic] ? sizeof(double) : sizeof(int32_t);
+    tab->cols[ic] = malloc(esize * (ntrace > 0 ? ntrace : 1));
+    if (!tab->cols[ic])
+      errorinfo("malloc failed for header table column %s", segykeyword(keys[ic]));
+  }
+  return tab;
+}
+
+size_t segyhtab_fill(segyfile segyf, segy_htable* tab, int nthreads) {
+  int* scaleby = (int*)calloc(tab->ncol > 0 ? tab->ncol : 1, sizeof(int));
+  if (!scaleby)
+    errorinfo("malloc failed for header table");
+  for (int ic = 0; ic < tab->ncol; ic++)
+    scaleby[ic] = tab->isdouble[ic] ? htab_scaleby(tab->keys[ic]) : 0;
+
+  htab_scan sc = {tab, scaleby, segykey("scalco"), segykey("scalel")};
+  size_t nscan = segy_scan_headers(segyf, tab->itr0, tab->ntrace, nthreads, htab_batch, &sc);
+  free(scaleby);
+  return nscan;
+}
+
+segy_htable* segyhtab_read(segyfile segyf, size_t itr0, size_t ntrace,
+                           const int* keys, int nkey, int flags, int nthreads) {
+  if (itr0 > segyf->ntrace)
+    itr0 = segyf->ntrace;
+  if (ntrace > segyf->ntrace - itr0)
+    ntrace = segyf->ntrace - itr0;
+
+  segy_htable* tab = segyhtab_alloc(ntrace, keys, nkey, flags);
+  tab->itr0 = itr0;
+  size_t nscan = segyhtab_fill(segyf, tab, nthreads);
+  if (nscan != ntrace) {
+    /* the rows of a failed batch may lie anywhere, keep none of them */
+    warninginfo("header table: read %zu of %zu headers, the table is empty", nscan, ntrace);
+    tab->ntrace = 0;
+  }
+  return tab;
+}
+
+segy_htable* segyhtab_read_names(segyfile segyf, size_t itr0, size_t ntrace,
+                                 const char* names, int flags, int nthreads) {
+  char* list = strdup(names);
+  int* keys = (int*)malloc(sizeof(int) * (strlen(names) / 2 + 1));
+  if (!list || !keys)
+    errorinfo("malloc failed for header table keys");
+  int nkey = 0;
+  for (char* tok = strtok(list, ", "); tok; tok = strtok(NULL, ", "))
+    keys[nkey++] = segykey(tok);
+
+  segy_htable* tab = segyhtab_read(segyf, itr0, ntrace, keys, nkey, flags, nthreads);
+  free(keys);
+  free(list);
+  return tab;
+}
+
+static int htab_find(const segy_htable* tab, int k) {
+  for (int ic = 0; ic < tab->ncol; ic++)
+    if (tab->keys[ic] == k)
+      return ic;
+  return -1;
+}
+
+const int32_t* segyhtab_int(const segy_htable* tab, int k) {
+  int ic = htab_find(tab, k);
+  return (ic < 0 || tab->isdouble[ic]) ? NULL : (const int32_t*)tab->cols[ic];
+}
+
+const double* segyhtab_double(const segy_htable* tab, int k) {
+  int ic = htab_find(tab, k);
+  return (ic < 0 || !tab->isdouble[ic]) ? NULL : (const double*)tab->cols[ic];
+}
+
+void segyhtab_free(segy_htable* tab) {
+  if (tab) {
+    for (int ic = 0; ic < tab->ncol; ic++)
+      free(tab->cols[ic]);
+    free(tab->cols);
+    free(tab->isdouble);
+    free(tab->keys);
+    free(tab);
+  }
+}
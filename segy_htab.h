@@ -0,0 +1,56 @@
+/* Columnar trace header tables */
+#ifndef _segy_htab_h
+#define _segy_htab_h
+
+#include <stdint.h>
+#include "segy.h"
+
+enum {
+  SEGY_HTAB_RAW = 0,   /* keep every column as the int32 stored in the file */
+  SEGY_HTAB_SCALE = 1, /* apply scalco to sx,sy,gx,gy,cdpx,cdpy and scalel to the
+                          elevations and depths, these columns become double */
+};
+
+/** one contiguous column per key for the traces [itr0, itr0 + ntrace) */
+typedef struct {
+  size_t itr0;    // first trace of the table
+  size_t ntrace;  // rows of every column
+  int ncol;       // number of columns
+  int* keys;      // trace header key index of each column
+  int* isdouble;  // 1 if the column is double (scaled), 0 if int32
+  void** cols;    // cols[i] is int32_t[ntrace] or double[ntrace]
+} segy_htable;
+
+/*< 1 if key k is scaled by scalco or scalel >*/
+int segykey_isscaled(int k);
+
+/*< scale factor of a SEGY scalar (scalco/scalel): >0 multiply, <0 divide, 0 is 1 >*/
+double segyscalar(int scalar);
+
+/*< allocate a table of ntrace rows for keys[nkey], itr0 is 0 >*/
+segy_htable* segyhtab_alloc(size_t ntrace, const int* keys, int nkey, int flags);
+
+/*< decode the traces [tab->itr0, tab->itr0 + tab->ntrace) of segyf into an
+-- allocated table, the double columns are scaled, return the rows decoded >*/
+size_t segyhtab_fill(segyfile segyf, segy_htable* tab, int nthreads);
+
+/*< decode keys[nkey] of traces [itr0, itr0 + ntrace) into a columnar table
+-- flags: SEGY_HTAB_RAW or SEGY_HTAB_SCALE, nthreads 0 means all threads
+-- ntrace is clipped to the end of the file, the table has no rows if a read fails >*/
+segy_htable* segyhtab_read(segyfile segyf, size_t itr0, size_t ntrace,
+                           const int* keys, int nkey, int flags, int nthreads);
+
+/*< same as segyhtab_read with comma separated key names, e.g. "cdp,offset,sx" >*/
+segy_htable* segyhtab_read_names(segyfile segyf, size_t itr0, size_t ntrace,
+                                 const char* names, int flags, int nthreads);
+
+/*< column of key k as int32, NULL if absent or scaled >*/
+const int32_t* segyhtab_int(const segy_htable* tab, int k);
+
+/*< column of key k as double, NULL if absent or not scaled >*/
+const double* segyhtab_double(const segy_htable* tab, int k);
+
+/*< free the table >*/
+void segyhtab_free(segy_htable* tab);
+
+#endif
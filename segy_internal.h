@@ -0,0 +1,293 @@
+/* Internal helpers shared by the easysegy translation units */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+#ifndef _segy_internal_h
+#define _segy_internal_h
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "segy.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define HOST_LITTLE_ENDIAN 1
+#else
+#define HOST_LITTLE_ENDIAN 0
+#endif
+
+// Check for compiler intrinsics for byte swapping
+#if defined(__GNUC__) || defined(__clang__)
+#define bswap16(x) __builtin_bswap16(x)
+#define bswap32(x) __builtin_bswap32(x)
+#define bswap64(x) __builtin_bswap64(x)
+#elif defined(_MSC_VER)
+#include <stdlib.h>
+#define bswap16(x) _byteswap_ushort(x)
+#define bswap32(x) _byteswap_ulong(x)
+#define bswap64(x) _byteswap_uint64(x)
+#else
+// Fallback for other compilers
+static inline uint16_t bswap16(uint16_t x) {
+  return (x >> 8) | (x << 8);
+}
+static inline uint32_t bswap32(uint32_t x) {
+  return (x >> 24) | ((x << 8) & 0x00FF0000) | ((x >> 8) & 0x0000FF00) |
+         (x << 24);
+}
+static inline uint64_t bswap64(uint64_t x) {
+  x = (x & 0x00000000FFFFFFFF) << 32 | (x & 0xFFFFFFFF00000000) >> 32;
+  x = (x & 0x0000FFFF0000FFFF) << 16 | (x & 0xFFFF0000FFFF0000) >> 16;
+  x = (x & 0x00FF00FF00FF00FF) << 8 | (x & 0xFF00FF00FF00FF00) >> 8;
+  return x;
+}
+#endif
+
+// Get a 2-byte integer from a big-endian buffer
+static inline uint16_t get16(const char* buf) {
+  uint16_t x;
+  memcpy(&x, buf, 2);
+#ifdef HOST_LITTLE_ENDIAN
+  x = bswap16(x);
+#endif
+  return x;
+}
+
+// Get a 4-byte integer from a big-endian buffer
+static inline uint32_t get32(const char* buf) {
+  uint32_t x;
+  memcpy(&x, buf, 4);
+#ifdef HOST_LITTLE_ENDIAN
+  x = bswap32(x);
+#endif
+  return x;
+}
+
+// Get a 8-byte integer from a big-endian buffer
+static inline uint64_t get64(const char* buf) {
+  uint64_t x;
+  memcpy(&x, buf, 8);
+#ifdef HOST_LITTLE_ENDIAN
+  x = bswap64(x);
+#endif
+  return x;
+}
+
+// Get a 4-byte float from a big-endian buffer
+static inline float get32f(const char* buf) {
+  union {
+    uint32_t u;
+    float f;
+  } x;
+  memcpy(&x.u, buf, 4);
+#ifdef HOST_LITTLE_ENDIAN
+  x.u = bswap32(x.u);
+#endif
+  return x.f;
+}
+
+// Get a 8-byte float from a big-endian buffer
+static inline double get64f(const char* buf) {
+  union {
+    uint64_t u;
+    double d;
+  } x;
+  memcpy(&x.u, buf, 8);
+#ifdef HOST_LITTLE_ENDIAN
+  x.u = bswap64(x.u);
+#endif
+  return x.d;
+}
+
+// Put a 2-byte integer into a big-endian buffer
+static inline void put16(char* buf, uint16_t val) {
+#ifdef HOST_LITTLE_ENDIAN
+  val = bswap16(val);
+#endif
+  memcpy(buf, &val, 2);
+}
+
+// Put a 4-byte integer/float into a big-endian buffer
+static inline void put32(char* buf, uint32_t val) {
+#ifdef HOST_LITTLE_ENDIAN
+  val = bswap32(val);
+#endif
+  memcpy(buf, &val, 4);
+}
+
+// put a 8-byte integerinto a big-endian buffer
+static inline void put64(char* buf, uint64_t val) {
+#ifdef HOST_LITTLE_ENDIAN
+  val = bswap64(val);
+#endif
+  memcpy(buf, &val, 8);
+}
+
+// Get a 8-byte integer from a big-endian buffer
+static inline void put32f(char* buf, float val) {
+  union {
+    uint32_t u;
+    float f;
+  } x;
+  x.f = val;
+#ifdef HOST_LITTLE_ENDIAN
+  x.u = bswap32(x.u);
+#endif
+  memcpy(buf, &x.u, 4);
+}
+
+static inline void put64f(char* buf, double val) {
+  union {
+    uint64_t u;
+    double d;
+  } x;
+  x.d = val;
+#ifdef HOST_LITTLE_ENDIAN
+  x.u = bswap64(x.u);
+#endif
+  memcpy(buf, &x.u, 8);
+}
+
+/* USDT probes for perf/bpftrace, build with -DESEGY_USDT (needs <sys/sdt.h>)
+ probe arguments are (offset, bytes) for I/O and (traces, nanoseconds) for decode */
+#ifdef ESEGY_USDT
+#include <sys/sdt.h>
+#define SEGY_PROBE2(name, a, b) DTRACE_PROBE2(esegy, name, a, b)
+#else
+#define SEGY_PROBE2(name, a, b) ((void)0)
+#endif
+
+/*< monotonic clock in nanoseconds */
+static inline uint64_t segy_clock_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* start a timer, costs one branch when counters are disabled */
+#define SEGY_TIC(segyf) ((segyf)->stats ? segy_clock_ns() : 0)
+
+static inline void segy_stats_add(uint64_t* counter, uint64_t v) {
+  __atomic_fetch_add(counter, v, __ATOMIC_RELAXED);
+}
+
+/*< count one read call of nbytes started at t0 */
+static inline void segy_count_read(segyfile segyf, size_t nbytes, uint64_t t0) {
+  if (segyf->stats) {
+    segy_stats_add(&segyf->stats->io_ns, segy_clock_ns() - t0);
+    segy_stats_add(&segyf->stats->bytes_read, nbytes);
+    segy_stats_add(&segyf->stats->nread, 1);
+  }
+}
+
+/*< count one write call of nbytes started at t0 */
+static inline void segy_count_write(segyfile segyf, size_t nbytes, uint64_t t0) {
+  if (segyf->stats) {
+    segy_stats_add(&segyf->stats->io_ns, segy_clock_ns() - t0);
+    segy_stats_add(&segyf->stats->bytes_written, nbytes);
+    segy_stats_add(&segyf->stats->nwrite, 1);
+  }
+}
+
+/*< count ntr traces of sample conversion started at t0 */
+static inline void segy_count_sample(segyfile segyf, size_t ntr, uint64_t t0) {
+  (void)ntr;
+  if (segyf->stats)
+    segy_stats_add(&segyf->stats->sample_ns, segy_clock_ns() - t0);
+  SEGY_PROBE2(sample_convert, ntr, segyf->stats ? segy_clock_ns() - t0 : 0);
+}
+
+/*< count ntr traces of header conversion started at t0 */
+static inline void segy_count_header(segyfile segyf, size_t ntr, uint64_t t0) {
+  (void)ntr;
+  if (segyf->stats)
+    segy_stats_add(&segyf->stats->header_ns, segy_clock_ns() - t0);
+  SEGY_PROBE2(header_convert, ntr, segyf->stats ? segy_clock_ns() - t0 : 0);
+}
+
+/*< count ntr traces read */
+static inline void segy_count_traces_read(segyfile segyf, size_t ntr) {
+  if (segyf->stats)
+    segy_stats_add(&segyf->stats->traces_read, ntr);
+}
+
+/*< count ntr traces written */
+static inline void segy_count_traces_written(segyfile segyf, size_t ntr) {
+  if (segyf->stats)
+    segy_stats_add(&segyf->stats->traces_written, ntr);
+}
+
+/*< byte offset of trace itrace (0-based) from the start of the file */
+static inline off_t segy_trace_offset(const SEGY_FILE* segyf, size_t itrace) {
+  return (off_t)(SEGY_EBCBYTES + SEGY_BHNBYTES) + (off_t)itrace * (off_t)segyf->nsegy;
+}
+
+/*< bytes of one sample for a SEGY format code */
+static inline int segy_samplebytes(int format) {
+  return (3 == format) ? 2 : (8 == format) ? 1 : 4;
+}
+
+/*< positional read of n bytes at off, return 1 if all bytes were read */
+int segy_read_at(segyfile segyf, void* buf, size_t n, off_t off);
+
+/*< positional write of n bytes at off, return 1 if all bytes were written */
+int segy_write_at(segyfile segyf, const void* buf, size_t n, off_t off);
+
+#define SEGY_STAMPBYTES 24 /* bytes of the stamp that sidecars keep of a SEGY file */
+
+/*< stamp of the file behind segyf into stamp[SEGY_STAMPBYTES]: a hash of the binary
+-- header and of trace headers spread over the file, its inode and modification time */
+void segy_stamp(segyfile segyf, char* stamp);
+
+/*< 1 if a stamp kept by a sidecar still matches segyf */
+int segy_stamp_match(segyfile segyf, const char* stamp);
+
+/*< move the position of the sequential calls like fseeko, return it or -1 */
+int64_t segy_seek(segyfile segyf, int64_t off, int whence);
+
+/*< byte offset of trace header key k in the 240 bytes header */
+int segy_keyoffset(int k);
+
+/*< byte size (2 or 4) of trace header key k */
+int segy_keysize(int k);
+
+/*< stop the prefetcher and free a trace block cache (segy_cache.c), NULL is ignored */
+void segy_cache_free(struct segy_cache* cache);
+
+/* header and record scans (segy_scan.c) */
+
+/* callback of a scan: n trace headers or records of traces itr0..itr0+n-1,
+ header j starts at buf + j * stride, tid is the calling thread in [0, nthreads) */
+typedef void (*segy_scanfn)(const char* buf, size_t stride, size_t itr0, size_t n,
+                            void* arg, int tid);
+
+/*< resolve a thread count, 0 or less means all available threads */
+int segy_nthreads(int nthreads);
+
+/*< scan the headers of traces [itr0, itr0 + n) in batches and in parallel,
+-- batches are read as whole records when traces are short and as single
+-- headers when the samples between two headers are large,
+-- return the number of traces scanned */
+size_t segy_scan_headers(segyfile segyf, size_t itr0, size_t n, int nthreads,
+                         segy_scanfn fn, void* arg);
+
+/*< scan the whole records of traces [itr0, itr0 + n) in batches and in parallel,
+-- the stride is nsegy, return the number of traces scanned */
+size_t segy_scan_records(segyfile segyf, size_t itr0, size_t n, int nthreads,
+                         segy_scanfn fn, void* arg);
+
+/*< decode key k of n headers at stride into out[n] */
+void segy_decode_column(const char* buf, size_t stride, size_t n, int k, int32_t* out);
+
+/*< encode in[n] into key k of n headers at stride, clamping to the key's range,
+-- return the number of values clamped */
+size_t segy_encode_column(char* buf, size_t stride, size_t n, int k, const int64_t* in);
+
+#endif
@@ -0,0 +1,561 @@
+/* Pluggable I/O backends: stdio, file descriptor, mmap and memory */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#define _GNU_SOURCE /* mremap */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+
+/* pread/pwrite until done, EOF or an error */
+static size_t fd_pread(int fd, void* buf, size_t n, int64_t off) {
+  char* p = (char*)buf;
+  size_t done = 0;
+  while (done < n) {
+    ssize_t nr = pread(fd, p + done, n - done, (off_t)(off + done));
+    if (nr < 0 && EINTR == errno)
+      continue;
+    if (nr <= 0)
+      break;
+    done += (size_t)nr;
+  }
+  return done;
+}
+
+static size_t fd_pwrite(int fd, const void* buf, size_t n, int64_t off) {
+  const char* p = (const char*)buf;
+  size_t done = 0;
+  while (done < n) {
+    ssize_t nw = pwrite(fd, p + done, n - done, (off_t)(off + done));
+    if (nw < 0 && EINTR == errno)
+      continue;
+    if (nw <= 0)
+      break;
+    done += (size_t)nw;
+  }
+  return done;
+}
+
+static int64_t fd_size(int fd) {
+  struct stat st;
+  return 0 == fstat(fd, &st) ? (int64_t)st.st_size : -1;
+}
+
+static int fd_advice(int advice) {
+  switch (advice) {
+    case SEGY_IO_SEQUENTIAL:
+      return POSIX_FADV_SEQUENTIAL;
+    case SEGY_IO_RANDOM:
+      return POSIX_FADV_RANDOM;
+    case SEGY_IO_WILLNEED:
+      return POSIX_FADV_WILLNEED;
+    case SEGY_IO_DONTNEED:
+      return POSIX_FADV_DONTNEED;
+    default:
+      return POSIX_FADV_NORMAL;
+  }
+}
+
+/* ---- file descriptor ---- */
+
+typedef struct {
+  segy_io io;
+  int own;
+} io_fd;
+
+static size_t fdio_read_at(segy_io* io, void* buf, size_t n, int64_t off) {
+  return fd_pread(io->fd, buf, n, off);
+}
+
+static size_t fdio_write_at(segy_io* io, const void* buf, size_t n, int64_t off) {
+  return fd_pwrite(io->fd, buf, n, off);
+}
+
+static int64_t fdio_size(segy_io* io) {
+  return fd_size(io->fd);
+}
+
+static int fdio_truncate(segy_io* io, int64_t size) {
+  return ftruncate(io->fd, (off_t)size);
+}
+
+static void fdio_hint(segy_io* io, int64_t off, int64_t len, int advice) {
+  (void)posix_fadvise(io->fd, (off_t)off, (off_t)len, fd_advice(advice));
+}
+
+static int fdio_flush(segy_io* io, int durable) {
+  return durable ? fdatasync(io->fd) : 0;
+}
+
+static void fdio_close(segy_io* io) {
+  if (((io_fd*)io)->own)
+    close(io->fd);
+  free(io);
+}
+
+static const segy_io_ops fd_ops = {
+    "fd",     fdio_read_at, fdio_write_at, fdio_size, fdio_truncate, fdio_hint,
+    fdio_flush, fdio_close, NULL,          NULL,      NULL,
+};
+
+segy_io* segyio_fd(int fd, int own) {
+  io_fd* f = (io_fd*)malloc(sizeof(io_fd));
+  if (!f)
+    errorinfo("malloc failed for segy_io");
+  f->io.ops = &fd_ops;
+  f->io.fd = fd;
+  f->io.fp = NULL;
+  f->own = own;
+  return &f->io;
+}
+
+static int open_flags(const char* mode) {
+  if (!strcmp(mode, "r") || !strcmp(mode, "rb"))
+    return O_RDONLY;
+  if (!strcmp(mode, "r+") || !strcmp(mode, "r+b") || !strcmp(mode, "rb+"))
+    return O_RDWR;
+  if (!strcmp(mode, "w") || !strcmp(mode, "wb") || !strcmp(mode, "w+") ||
+      !strcmp(mode, "w+b") || !strcmp(mode, "wb+"))
+    return O_RDWR | O_CREAT | O_TRUNC;
+  return -1;
+}
+
+segy_io* segyio_open(const char* path, const char* mode) {
+  int flags = open_flags(mode);
+  if (flags < 0) {
+    warninginfo("segyio_open: bad mode \"%s\"", mode);
+    return NULL;
+  }
+  int fd = open(path, flags, 0666);
+  if (fd < 0) {
+    warninginfo("segyio_open: cannot open %s: %s", path, strerror(errno));
+    return NULL;
+  }
+  return segyio_fd(fd, 1);
+}
+
+/* ---- stdio: stream for sequential calls, its descriptor for positional ones ---- */
+
+typedef struct {
+  segy_io io;
+  int own;
+} io_stdio;
+
+static int64_t stdio_size(segy_io* io) {
+  fflush(io->fp); /* count the bytes still in the stream buffer */
+  return fd_size(io->fd);
+}
+
+static int stdio_truncate(segy_io* io, int64_t size) {
+  fflush(io->fp);
+  return ftruncate(io->fd, (off_t)size);
+}
+
+static int stdio_flush(segy_io* io, int durable) {
+  if (fflush(io->fp))
+    return -1;
+  return durable ? fdatasync(io->fd) : 0;
+}
+
+static void stdio_close(segy_io* io) {
+  if (((io_stdio*)io)->own)
+    fclose(io->fp);
+  free(io);
+}
+
+static size_t stdio_read(segy_io* io, void* buf, size_t n) {
+  return fread(buf, 1, n, io->fp);
+}
+
+static size_t stdio_write(segy_io* io, const void* buf, size_t n) {
+  return fwrite(buf, 1, n, io->fp);
+}
+
+static int64_t stdio_seek(segy_io* io, int64_t off, int whence) {
+  if (fseeko(io->fp, (off_t)off, whence))
+    return -1;
+  return (int64_t)ftello(io->fp);
+}
+
+static const segy_io_ops stdio_ops = {
+    "stdio",     fdio_read_at, fdio_write_at, stdio_size, stdio_truncate, fdio_hint,
+    stdio_flush, stdio_close,  stdio_read,    stdio_write, stdio_seek,
+};
+
+segy_io* segyio_stdio(FILE* fp, int own) {
+  io_stdio* s = (io_stdio*)malloc(sizeof(io_stdio));
+  if (!s)
+    errorinfo("malloc failed for segy_io");
+  s->io.ops = &stdio_ops;
+  s->io.fd = fileno(fp);
+  s->io.fp = fp;
+  s->own = own;
+  return &s->io;
+}
+
+/* ---- shared handling of the mmap and memory backends ----
+   reads and writes inside the data take the lock shared, growing takes it exclusive */
+
+typedef struct {
+  segy_io io;
+  pthread_rwlock_t lock;
+  char* buf;
+  size_t len; /* bytes of data */
+  size_t cap; /* bytes of buf */
+  int writable;
+  int mapfd; /* the mapped file, -1 for memory */
+  int (*grow)(segy_io* io, size_t need); /* make cap >= need, NULL if fixed */
+  int (*setlen)(segy_io* io, size_t len); /* apply a new length, e.g. to the file */
+} io_buf;
+
+static size_t buf_read_at(segy_io* io, void* buf, size_t n, int64_t off) {
+  io_buf* b = (io_buf*)io;
+  size_t m = 0;
+  pthread_rwlock_rdlock(&b->lock);
+  if (off >= 0 && (size_t)off < b->len) {
+    m = b->len - (size_t)off < n ? b->len - (size_t)off : n;
+    memcpy(buf, b->buf + off, m);
+  }
+  pthread_rwlock_unlock(&b->lock);
+  return m;
+}
+
+/* set the data length to len under the exclusive lock, new bytes read as zeros */
+static int buf_resize(io_buf* b, size_t len) {
+  if (len > b->cap && (!b->grow || b->grow(&b->io, len)))
+    return -1;
+  if (b->setlen && b->setlen(&b->io, len))
+    return -1;
+  if (len > b->len)
+    memset(b->buf + b->len, 0, len - b->len);
+  b->len = len;
+  return 0;
+}
+
+static size_t buf_write_at(segy_io* io, const void* buf, size_t n, int64_t off) {
+  io_buf* b = (io_buf*)io;
+  if (!b->writable || off < 0)
+    return 0;
+  size_t end = (size_t)off + n;
+  pthread_rwlock_rdlock(&b->lock);
+  if (end > b->len) {
+    pthread_rwlock_unlock(&b->lock);
+    pthread_rwlock_wrlock(&b->lock);
+    if (end > b->len && buf_resize(b, end)) {
+      /* write what fits */
+      n = (size_t)off < b->len ? b->len - (size_t)off : 0;
+    }
+  }
+  memcpy(b->buf + off, buf, n);
+  pthread_rwlock_unlock(&b->lock);
+  return n;
+}
+
+static int64_t buf_size(segy_io* io) {
+  io_buf* b = (io_buf*)io;
+  pthread_rwlock_rdlock(&b->lock);
+  int64_t len = (int64_t)b->len;
+  pthread_rwlock_unlock(&b->lock);
+  return len;
+}
+
+static int buf_truncate(segy_io* io, int64_t size) {
+  io_buf* b = (io_buf*)io;
+  if (!b->writable || size < 0)
+    return -1;
+  pthread_rwlock_wrlock(&b->lock);
+  int r = buf_resize(b, (size_t)size);
+  pthread_rwlock_unlock(&b->lock);
+  return r;
+}
+
+static void buf_init(io_buf* b, const segy_io_ops* ops, int writable) {
+  b->io.ops = ops;
+  b->io.fd = -1;
+  b->io.fp = NULL;
+  pthread_rwlock_init(&b->lock, NULL);
+  b->buf = NULL;
+  b->len = b->cap = 0;
+  b->writable = writable;
+  b->mapfd = -1;
+  b->grow = NULL;
+  b->setlen = NULL;
+}
+
+/* ---- memory ---- */
+
+typedef struct {
+  io_buf b;
+  int own;
+} io_mem;
+
+static int mem_grow(segy_io* io, size_t need) {
+  io_buf* b = (io_buf*)io;
+  size_t cap = b->cap ? b->cap : 4096;
+  while (cap < need)
+    cap *= 2;
+  char* p = (char*)realloc(b->buf, cap);
+  if (!p)
+    return -1;
+  b->buf = p;
+  b->cap = cap;
+  return 0;
+}
+
+static int mem_flush(segy_io* io, int durable) {
+  (void)io;
+  (void)durable;
+  return 0;
+}
+
+static void mem_close(segy_io* io) {
+  io_mem* m = (io_mem*)io;
+  if (m->own)
+    free(m->b.buf);
+  pthread_rwlock_destroy(&m->b.lock);
+  free(m);
+}
+
+static const segy_io_ops mem_ops = {
+    "memory",  buf_read_at, buf_write_at, buf_size, buf_truncate, NULL,
+    mem_flush, mem_close,   NULL,         NULL,     NULL,
+};
+
+static io_mem* mem_alloc(int writable, int own) {
+  io_mem* m = (io_mem*)malloc(sizeof(io_mem));
+  if (!m)
+    errorinfo("malloc failed for segy_io");
+  buf_init(&m->b, &mem_ops, writable);
+  m->own = own;
+  return m;
+}
+
+segy_io* segyio_memory(void* buf, size_t n, int writable) {
+  io_mem* m = mem_alloc(writable, 0);
+  m->b.buf = (char*)buf;
+  m->b.len = m->b.cap = n;
+  return &m->b.io;
+}
+
+segy_io* segyio_memory_new(size_t capacity) {
+  io_mem* m = mem_alloc(1, 1);
+  m->b.grow = mem_grow;
+  if (capacity && mem_grow(&m->b.io, capacity))
+    errorinfo("malloc failed for segy_io memory");
+  return &m->b.io;
+}
+
+const void* segyio_memory_data(segy_io* io, size_t* n) {
+  if (io->ops != &mem_ops) {
+    warninginfo("segyio_memory_data: not a memory backend");
+    if (n)
+      *n = 0;
+    return NULL;
+  }
+  io_buf* b = (io_buf*)io;
+  if (n)
+    *n = b->len;
+  return b->buf;
+}
+
+/* ---- mmap: the mapping may be longer than the file, only len bytes are used ---- */
+
+static int mmap_grow(segy_io* io, size_t need) {
+  io_buf* b = (io_buf*)io;
+  size_t cap = b->cap ? b->cap : 1 << 20;
+  while (cap < need)
+    cap *= 2;
+  void* p = b->buf ? mremap(b->buf, b->cap, cap, MREMAP_MAYMOVE)
+                   : mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_SHARED, b->mapfd, 0);
+  if (MAP_FAILED == p)
+    return -1;
+  b->buf = (char*)p;
+  b->cap = cap;
+  return 0;
+}
+
+static int mmap_setlen(segy_io* io, size_t len) {
+  return ftruncate(((io_buf*)io)->mapfd, (off_t)len);
+}
+
+static void mmap_hint(segy_io* io, int64_t off, int64_t len, int advice) {
+  io_buf* b = (io_buf*)io;
+  static const int madv[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED,
+                             MADV_DONTNEED};
+  if (advice < 0 || advice > SEGY_IO_DONTNEED)
+    return;
+  pthread_rwlock_rdlock(&b->lock);
+  if (b->buf && off >= 0 && (size_t)off < b->len) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t a = (size_t)off / page * page;
+    size_t e = len > 0 && (size_t)(off + len) < b->len ? (size_t)(off + len) : b->len;
+    (void)madvise(b->buf + a, e - a, madv[advice]);
+  }
+  pthread_rwlock_unlock(&b->lock);
+}
+
+static int mmap_flush(segy_io* io, int durable) {
+  io_buf* b = (io_buf*)io;
+  int r = 0;
+  pthread_rwlock_rdlock(&b->lock);
+  if (b->buf && b->writable && b->len)
+    r = msync(b->buf, b->len, durable ? MS_SYNC : MS_ASYNC);
+  pthread_rwlock_unlock(&b->lock);
+  return r;
+}
+
+static void mmap_close(segy_io* io) {
+  io_buf* b = (io_buf*)io;
+  if (b->buf)
+    munmap(b->buf, b->cap);
+  close(b->mapfd);
+  pthread_rwlock_destroy(&b->lock);
+  free(b);
+}
+
+static const segy_io_ops mmap_ops = {
+    "mmap",     buf_read_at, buf_write_at, buf_size, buf_truncate, mmap_hint,
+    mmap_flush, mmap_close,  NULL,         NULL,     NULL,
+};
+
+segy_io* segyio_mmap(const char* path, int writable) {
+  int fd = open(path, writable ? O_RDWR : O_RDONLY);
+  if (fd < 0) {
+    warninginfo("segyio_mmap: cannot open %s: %s", path, strerror(errno));
+    return NULL;
+  }
+  io_buf* b = (io_buf*)malloc(sizeof(io_buf));
+  if (!b)
+    errorinfo("malloc failed for segy_io");
+  buf_init(b, &mmap_ops, writable);
+  b->mapfd = fd;
+  int64_t size = fd_size(fd);
+  if (size > 0) {
+    void* p = mmap(NULL, (size_t)size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                   MAP_SHARED, fd, 0);
+    if (MAP_FAILED == p) {
+      warninginfo("segyio_mmap: cannot map %s: %s", path, strerror(errno));
+      close(fd);
+      pthread_rwlock_destroy(&b->lock);
+      free(b);
+      return NULL;
+    }
+    b->buf = (char*)p;
+    b->len = b->cap = (size_t)size;
+  }
+  if (writable) {
+    b->grow = mmap_grow;
+    b->setlen = mmap_setlen;
+  }
+  return &b->io;
+}
+
+/* ---- calls on any backend ---- */
+
+int segyio_read_at(segy_io* io, void* buf, size_t n, int64_t off) {
+  char* p = (char*)buf;
+  while (n > 0) {
+    size_t nr = io->ops->read_at(io, p, n, off);
+    if (0 == nr)
+      break;
+    p += nr;
+    off += (int64_t)nr;
+    n -= nr;
+  }
+  return 0 == n;
+}
+
+int segyio_write_at(segy_io* io, const void* buf, size_t n, int64_t off) {
+  const char* p = (const char*)buf;
+  while (n > 0) {
+    size_t nw = io->ops->write_at(io, p, n, off);
+    if (0 == nw)
+      break;
+    p += nw;
+    off += (int64_t)nw;
+    n -= nw;
+  }
+  return 0 == n;
+}
+
+int64_t segyio_size(segy_io* io) {
+  return io->ops->size(io);
+}
+
+void segyio_hint(segy_io* io, int64_t off, int64_t len, int advice) {
+  if (io->ops->hint)
+    io->ops->hint(io, off, len, advice);
+}
+
+int segyio_flush(segy_io* io, int durable) {
+  return 0 == io->ops->flush(io, durable);
+}
+
+void segyio_close(segy_io* io) {
+  if (io)
+    io->ops->close(io);
+}
+
+#define SEGY_STAMP_NTRACE 64 /* trace headers hashed into a stamp */
+
+static uint64_t stamp_hash(uint64_t h, const void* buf, size_t n) {
+  const unsigned char* p = (const unsigned char*)buf;
+  for (size_t i = 0; i < n; i++)
+    h = (h ^ p[i]) * 1099511628211ULL;
+  return h;
+}
+
+/** stamp of the file behind segyf kept by sidecars: a hash of the binary header and of
+* the headers of up to 64 traces spread over the file, then the device and inode and
+* the modification time in ns when the backend has a descriptor (else 0)
+*/
+void segy_stamp(segyfile segyf, char* stamp) {
+  uint64_t h = 14695981039346656037ULL, ino = 0, mtime = 0;
+  char buf[SEGY_BHNBYTES];
+  if (segy_read_at(segyf, buf, SEGY_BHNBYTES, SEGY_EBCBYTES))
+    h = stamp_hash(h, buf, SEGY_BHNBYTES);
+  size_t n = segyf->ntrace < SEGY_STAMP_NTRACE ? segyf->ntrace : SEGY_STAMP_NTRACE;
+  for (size_t i = 0; i < n; i++) {
+    size_t itr = n > 1 ? i * (segyf->ntrace - 1) / (n - 1) : 0;
+    if (segy_read_at(segyf, buf, SEGY_THNBYTES, segy_trace_offset(segyf, itr)))
+      h = stamp_hash(h, buf, SEGY_THNBYTES);
+  }
+  struct stat st;
+  if (segyf->io->fd >= 0 && 0 == fstat(segyf->io->fd, &st)) {
+    ino = stamp_hash(stamp_hash(14695981039346656037ULL, &st.st_dev, sizeof(st.st_dev)),
+                     &st.st_ino, sizeof(st.st_ino));
+    mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + (uint64_t)st.st_mtim.tv_nsec;
+  }
+  put64(stamp, h);
+  put64(stamp + 8, ino);
+  put64(stamp + 16, mtime);
+}
+
+/** 1 if a stamp kept by a sidecar is the stamp of segyf, the inode and the time are
+* only compared when both stamps have them
+*/
+int segy_stamp_match(segyfile segyf, const char* stamp) {
+  char now[SEGY_STAMPBYTES];
+  segy_stamp(segyf, now);
+  for (int i = 0; i < SEGY_STAMPBYTES; i += 8)
+    if (get64(stamp + i) != get64(now + i) && (0 == i || (get64(stamp + i) && get64(now + i))))
+      return 0;
+  return 1;
+}
@@ -0,0 +1,109 @@
+/* Pluggable I/O backends of a segyfile */
+#ifndef _segy_io_h
+#define _segy_io_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "segy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* access pattern hints, see segyio_hint */
+enum {
+  SEGY_IO_NORMAL = 0,
+  SEGY_IO_SEQUENTIAL = 1, /* the range is read front to back once */
+  SEGY_IO_RANDOM = 2,     /* no read ahead */
+  SEGY_IO_WILLNEED = 3,   /* the range is read soon */
+  SEGY_IO_DONTNEED = 4,   /* the range is not read again */
+};
+
+typedef struct segy_io segy_io;
+
+/** backend operations; read_at and write_at are positional and must be safe to call
+-- from several threads, they return the bytes moved (short at the end of the data or
+-- on errors); ops marked optional may be NULL */
+typedef struct {
+  const char* name;
+  size_t (*read_at)(segy_io* io, void* buf, size_t n, int64_t off);
+  size_t (*write_at)(segy_io* io, const void* buf, size_t n, int64_t off);
+  int64_t (*size)(segy_io* io);                                    // -1 on errors
+  int (*truncate)(segy_io* io, int64_t size);                      // optional, 0 on success
+  void (*hint)(segy_io* io, int64_t off, int64_t len, int advice); // optional
+  int (*flush)(segy_io* io, int durable);                          // 0 on success
+  void (*close)(segy_io* io);                                      // frees io
+  /* optional stream, the sequential segyread_ and segywrite_ calls use it when set
+     (so the stream position stays meaningful), else a cursor in the segyfile */
+  size_t (*read)(segy_io* io, void* buf, size_t n);
+  size_t (*write)(segy_io* io, const void* buf, size_t n);
+  int64_t (*seek)(segy_io* io, int64_t off, int whence); // new position, -1 on errors
+} segy_io_ops;
+
+/** a backend instance, backends embed it as the first member of their own state */
+struct segy_io {
+  const segy_io_ops* ops;
+  int fd;   // descriptor read_at and write_at go to, -1 if they go elsewhere
+  FILE* fp; // stdio stream, NULL if the backend has none
+};
+
+/*< stdio stream, positional calls go to fileno(fp) with pread/pwrite; fp is closed
+-- with the backend only if own >*/
+segy_io* segyio_stdio(FILE* fp, int own);
+
+/*< file descriptor with pread/pwrite, closed with the backend only if own >*/
+segy_io* segyio_fd(int fd, int own);
+
+/*< open path with mode "r", "r+" or "w" (create or truncate) as an fd backend,
+-- return NULL and warn on errors >*/
+segy_io* segyio_open(const char* path, const char* mode);
+
+/*< map the whole file path, read only unless writable; writes past the end grow the
+-- file and the mapping; return NULL and warn on errors >*/
+segy_io* segyio_mmap(const char* path, int writable);
+
+/*< the n bytes at buf, writable or read only; the caller keeps the buffer, writes
+-- can not go past n bytes >*/
+segy_io* segyio_memory(void* buf, size_t n, int writable);
+
+/*< an empty in-memory file owned by the backend, grown as it is written >*/
+segy_io* segyio_memory_new(size_t capacity);
+
+/*< the bytes of a memory backend and their number in *n, valid until the next write
+-- or close >*/
+const void* segyio_memory_data(segy_io* io, size_t* n);
+
+/*< read n bytes at off, return 1 if all were read >*/
+int segyio_read_at(segy_io* io, void* buf, size_t n, int64_t off);
+
+/*< write n bytes at off, return 1 if all were written >*/
+int segyio_write_at(segy_io* io, const void* buf, size_t n, int64_t off);
+
+/*< size in bytes, -1 on errors >*/
+int64_t segyio_size(segy_io* io);
+
+/*< give the access pattern of len bytes at off (len 0 to the end), no-op if the
+-- backend takes no hints >*/
+void segyio_hint(segy_io* io, int64_t off, int64_t len, int advice);
+
+/*< push buffered writes to the backend, to stable storage if durable; 1 on success >*/
+int segyio_flush(segy_io* io, int durable);
+
+/*< close and free a backend >*/
+void segyio_close(segy_io* io);
+
+/*< initialize segyfile in read mode on a backend, the segyfile owns io from now on
+-- and closes it in segyfile_free >*/
+segyfile segyfile_init_read_io(segy_io* io);
+
+/*< initialize segyfile in write mode on a backend, owning io like segyfile_init_read_io >*/
+segyfile segyfile_init_write_io(segy_io* io, int ns, float dt, int format, size_t ntrace);
+
+/*< segyfile_init_append on a backend, io is closed if NULL is returned >*/
+segyfile segyfile_init_append_io(segy_io* io, int ns, float dt, int format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
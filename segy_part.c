@@ -0,0 +1,145 @@
+/* Work partitioning and collective writes for multi-process jobs */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_part.h"
+
+#define PART_BATCH 256 /* headers read per step when looking for a gather start */
+#define PART_BATCH_BYTES (4 << 20) /* bytes of records read per step at most */
+#define PART_WRITE_BYTES (4 << 20) /* bytes encoded per positional write */
+
+static int32_t part_key(segyfile segyf, size_t itr, int key, char* head) {
+  if (!segy_read_at(segyf, head, SEGY_THNBYTES, segy_trace_offset(segyf, itr)))
+    errorinfo("partition: error reading trace %zu", itr);
+  int32_t v;
+  segy_decode_column(head, SEGY_THNBYTES, 1, key, &v);
+  return v;
+}
+
+/* first trace at or after itr that starts a new gather, the records of a step are
+ read at once up to the last header */
+static size_t part_gather_start(segyfile segyf, size_t itr, int key) {
+  if (0 == itr || itr >= segyf->ntrace)
+    return itr < segyf->ntrace ? itr : segyf->ntrace;
+  size_t batch = PART_BATCH_BYTES / segyf->nsegy;
+  batch = batch < 1 ? 1 : (batch > PART_BATCH ? PART_BATCH : batch);
+  char* buf = (char*)malloc((batch - 1) * segyf->nsegy + SEGY_THNBYTES);
+  if (!buf)
+    errorinfo("malloc failed for partition headers");
+  int32_t prev = part_key(segyf, itr - 1, key, buf);
+  int32_t v[PART_BATCH];
+  while (itr < segyf->ntrace) {
+    size_t n = segyf->ntrace - itr < batch ? segyf->ntrace - itr : batch;
+    if (!segy_read_at(segyf, buf, (n - 1) * segyf->nsegy + SEGY_THNBYTES,
+                      segy_trace_offset(segyf, itr)))
+      errorinfo("partition: error reading traces %zu to %zu", itr, itr + n - 1);
+    segy_decode_column(buf, segyf->nsegy, n, key, v);
+    for (size_t j = 0; j < n; j++, itr++)
+      if (v[j] != prev) {
+        free(buf);
+        return itr;
+      }
+  }
+  free(buf);
+  return segyf->ntrace;
+}
+
+/* nominal boundary r of an equal count split */
+static size_t part_split(size_t ntrace, int r, int nranks) {
+  return (size_t)(((unsigned __int128)ntrace * (unsigned)r) / (unsigned)nranks);
+}
+
+segy_range segyfile_partition_key(segyfile segyf, int rank, int nranks, int key) {
+  segy_range range = {0, 0};
+  if (nranks < 1 || rank < 0 || rank >= nranks)
+    errorinfo("partition: rank %d out of [0, %d)", rank, nranks);
+  size_t b0 = part_split(segyf->ntrace, rank, nranks);
+  size_t b1 = part_split(segyf->ntrace, rank + 1, nranks);
+  if (key >= 0) {
+    b0 = part_gather_start(segyf, b0, key);
+    b1 = part_gather_start(segyf, b1, key);
+  }
+  range.itr0 = b0;
+  range.ntrace = b1 > b0 ? b1 - b0 : 0;
+  return range;
+}
+
+segy_range segyfile_partition(segyfile segyf, int rank, int nranks, int policy) {
+  int key = -1;
+  if (SEGY_PART_GATHER == policy)
+    key = 2 == segyf->bhead[segybhkey("tsort")] ? segykey("cdp") : segykey("fldr");
+  else if (SEGY_PART_COUNT != policy)
+    errorinfo("partition: unknown policy %d", policy);
+  return segyfile_partition_key(segyf, rank, nranks, key);
+}
+
+FILE* segyfile_fopen_shared(const char* path) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return NULL;
+  FILE* fp = fdopen(fd, "r+b");
+  if (!fp)
+    close(fd);
+  return fp;
+}
+
+segyfile segyfile_init_collective(FILE* fp, int rank, int ns, float dt, int format,
+                                  size_t ntrace) {
+  segyfile segyf = segyfile_init_write(fp, ns, dt, format, ntrace);
+  /* writes of the other ranks past the end only extend the file, so rank 0
+   can set the final size at any time without losing their traces */
+  segy_io* io = segyf->io;
+  if (0 == rank && (!io->ops->truncate || io->ops->truncate(io, segy_trace_offset(segyf, ntrace))))
+    errorinfo("collective write: cannot set the size of the output");
+  return segyf;
+}
+
+size_t segywrite_tracerange(segyfile segyf, size_t itr0, const int* theads,
+                            const float* traces, size_t n) {
+  size_t nsegy = segyf->nsegy;
+  size_t batch = PART_WRITE_BYTES / nsegy > 0 ? PART_WRITE_BYTES / nsegy : 1;
+  if (batch > n)
+    batch = n > 0 ? n : 1;
+  char* buf = (char*)malloc(batch * nsegy);
+  if (!buf)
+    errorinfo("malloc failed for trace range buffer");
+
+  size_t nwritten = 0;
+  while (nwritten < n) {
+    size_t m = n - nwritten < batch ? n - nwritten : batch;
+    uint64_t t0 = SEGY_TIC(segyf);
+    for (size_t j = 0; j < m; j++) {
+      char* rec = buf + j * nsegy;
+      memset(rec, 0, SEGY_THNBYTES);
+      head2segy(rec, theads + (nwritten + j) * SEGY_THNKEYS, SEGY_THNKEYS);
+    }
+    segy_count_header(segyf, m, t0);
+    t0 = SEGY_TIC(segyf);
+    for (size_t j = 0; j < m; j++)
+      segyquant_encode(segyf, buf + j * nsegy, traces + (nwritten + j) * (size_t)segyf->ns);
+    segy_count_sample(segyf, m, t0);
+    if (!segy_write_at(segyf, buf, m * nsegy, segy_trace_offset(segyf, itr0 + nwritten)))
+      break;
+    nwritten += m;
+  }
+  segy_count_traces_written(segyf, nwritten);
+  free(buf);
+  return nwritten;
+}
@@ -0,0 +1,41 @@
+/* Work partitioning and collective writes for multi-process jobs */
+#ifndef _segy_part_h
+#define _segy_part_h
+
+#include <stdio.h>
+#include "segy.h"
+
+enum {
+  SEGY_PART_COUNT = 0,  /* equal trace counts */
+  SEGY_PART_GATHER = 1, /* equal counts moved to the next gather start, the gather
+                           key is cdp for cdp sorted files (tsort 2) and fldr otherwise */
+};
+
+/** traces [itr0, itr0 + ntrace) of one rank */
+typedef struct {
+  size_t itr0;
+  size_t ntrace;
+} segy_range;
+
+/*< traces of rank in [0, nranks) for a policy SEGY_PART_COUNT or SEGY_PART_GATHER,
+-- every rank computes the same split from the file alone >*/
+segy_range segyfile_partition(segyfile segyf, int rank, int nranks, int policy);
+
+/*< same as SEGY_PART_GATHER with an explicit gather key, no gather is split across ranks >*/
+segy_range segyfile_partition_key(segyfile segyf, int rank, int nranks, int key);
+
+/*< open path for reading and writing without truncating it, for a file shared by ranks >*/
+FILE* segyfile_fopen_shared(const char* path);
+
+/*< initialize one rank's handle on a shared output of ntrace traces in total,
+-- rank 0 sets the final file size and then writes the text and binary headers
+-- with segywrite_texthead/segywrite_binaryhead as usual >*/
+segyfile segyfile_init_collective(FILE* fp, int rank, int ns, float dt, int format,
+                                  size_t ntrace);
+
+/*< encode and write n traces at trace itr0 with positional writes, safe for
+-- several ranks or threads writing disjoint ranges, return the traces written >*/
+size_t segywrite_tracerange(segyfile segyf, size_t itr0, const int* theads,
+                            const float* traces, size_t n);
+
+#endif
@@ -0,0 +1,262 @@
+/* In-place batched trace header patching */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "segy.h"
+#include "segy_expr.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_patch.h"
+
+typedef struct {
+  int key;
+  segy_expr* e;
+} patch_assign;
+
+struct segy_patch {
+  int n;
+  patch_assign* a;
+};
+
+/* per thread buffers, grown to the largest batch */
+typedef struct {
+  size_t cap;
+  char* work;
+  int64_t* vals;
+} patch_tbuf;
+
+typedef struct {
+  segyfile segyf;
+  const segy_patch* p;
+  int flags;
+  char* map;        /* shared mapping of the file, NULL for pwrite */
+  patch_tbuf* tbuf; /* one per thread */
+  segy_patch_result* res;
+} patch_scan;
+
+static int patch_keyindex(const char* name) {
+  for (int k = 0; k < SEGY_THNKEYS; k++)
+    if (!strcmp(name, segykeyword(k)))
+      return k;
+  return -1;
+}
+
+/* compile one "key = expression", return 0 on errors */
+static int patch_add(segy_patch* p, const char* s, size_t len, segy_lut* const* luts,
+                     int nlut) {
+  char* text = (char*)malloc(len + 1);
+  if (!text)
+    errorinfo("malloc failed for patch");
+  memcpy(text, s, len);
+  text[len] = '\0';
+
+  char* q = text;
+  while (isspace((unsigned char)*q))
+    q++;
+  if ('\0' == *q) {
+    free(text);
+    return 1;
+  }
+  char* name = q;
+  while (isalnum((unsigned char)*q) || '_' == *q)
+    q++;
+  char* end = q;
+  while (isspace((unsigned char)*q))
+    q++;
+  if ('=' != *q || '=' == q[1] || end == name) {
+    warninginfo("patch: expected key = expression in \"%s\"", text);
+    free(text);
+    return 0;
+  }
+  *end = '\0';
+  int k = patch_keyindex(name);
+  if (k < 0) {
+    warninginfo("patch: unknown header key %s", name);
+    free(text);
+    return 0;
+  }
+  segy_expr* e = segyexpr_parse_lut(q + 1, luts, nlut);
+  free(text);
+  if (!e)
+    return 0;
+
+  p->a = (patch_assign*)realloc(p->a, sizeof(patch_assign) * (p->n + 1));
+  if (!p->a)
+    errorinfo("malloc failed for patch");
+  p->a[p->n].key = k;
+  p->a[p->n].e = e;
+  p->n++;
+  return 1;
+}
+
+segy_patch* segypatch_parse(const char* text, segy_lut* const* luts, int nlut) {
+  segy_patch* p = (segy_patch*)calloc(1, sizeof(segy_patch));
+  if (!p)
+    errorinfo("malloc failed for patch");
+  const char* s = text;
+  for (;;) {
+    size_t len = strcspn(s, ";\n");
+    if (!patch_add(p, s, len, luts, nlut)) {
+      segypatch_free(p);
+      return NULL;
+    }
+    if ('\0' == s[len])
+      break;
+    s += len + 1;
+  }
+  if (0 == p->n) {
+    warninginfo("patch: no assignment in \"%s\"", text);
+    segypatch_free(p);
+    return NULL;
+  }
+  return p;
+}
+
+void segypatch_free(segy_patch* p) {
+  if (p) {
+    for (int i = 0; i < p->n; i++)
+      segyexpr_free(p->a[i].e);
+    free(p->a);
+    free(p);
+  }
+}
+
+uint64_t segypatch_headers(const segy_patch* p, char* buf, size_t stride, size_t n) {
+  if (0 == n)
+    return 0;
+  int64_t* vals = (int64_t*)malloc(sizeof(int64_t) * n);
+  if (!vals)
+    errorinfo("malloc failed for patch buffers");
+  uint64_t nclamped = 0;
+  for (int i = 0; i < p->n; i++) {
+    segyexpr_eval_headers(p->a[i].e, buf, stride, n, vals);
+    nclamped += segy_encode_column(buf, stride, n, p->a[i].key, vals);
+  }
+  free(vals);
+  return nclamped;
+}
+
+static void patch_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg,
+                        int tid) {
+  patch_scan* sc = (patch_scan*)arg;
+  segyfile segyf = sc->segyf;
+  patch_tbuf* tb = sc->tbuf + tid;
+  if (tb->cap < n) {
+    free(tb->work);
+    free(tb->vals);
+    tb->work = (char*)malloc(n * SEGY_THNBYTES);
+    tb->vals = (int64_t*)malloc(sizeof(int64_t) * n);
+    if (!tb->work || !tb->vals)
+      errorinfo("malloc failed for patch buffers");
+    tb->cap = n;
+  }
+
+  uint64_t t0 = SEGY_TIC(segyf);
+  for (size_t j = 0; j < n; j++)
+    memcpy(tb->work + j * SEGY_THNBYTES, buf + j * stride, SEGY_THNBYTES);
+  uint64_t nclamped = 0;
+  for (int i = 0; i < sc->p->n; i++) {
+    const patch_assign* a = sc->p->a + i;
+    segyexpr_eval_headers(a->e, tb->work, SEGY_THNBYTES, n, tb->vals);
+    nclamped += segy_encode_column(tb->work, SEGY_THNBYTES, n, a->key, tb->vals);
+  }
+  segy_count_header(segyf, n, t0);
+
+  uint64_t nchanged = 0, nfailed = 0;
+  for (size_t j = 0; j < n; j++) {
+    const char* h = tb->work + j * SEGY_THNBYTES;
+    if (!memcmp(h, buf + j * stride, SEGY_THNBYTES))
+      continue;
+    nchanged++;
+    if (sc->flags & SEGY_PATCH_DRYRUN)
+      continue;
+    off_t off = segy_trace_offset(segyf, itr0 + j);
+    if (sc->map)
+      memcpy(sc->map + off, h, SEGY_THNBYTES);
+    else if (!segy_write_at(segyf, h, SEGY_THNBYTES, off))
+      nfailed++;
+  }
+  segy_stats_add(&sc->res->nscan, n);
+  segy_stats_add(&sc->res->nchanged, nchanged);
+  segy_stats_add(&sc->res->nclamped, nclamped);
+  segy_stats_add(&sc->res->nfailed, nfailed);
+}
+
+int segypatch_apply(segyfile segyf, const segy_patch* p, int flags, int nthreads,
+                    segy_patch_result* res) {
+  segy_patch_result r;
+  memset(&r, 0, sizeof(r));
+  int fd = segyf->io->fd;
+  if (!(flags & SEGY_PATCH_DRYRUN) && fd >= 0 &&
+      O_RDWR != (fcntl(fd, F_GETFL) & O_ACCMODE)) {
+    warninginfo("patch: the file is not open for reading and writing");
+    if (res)
+      *res = r;
+    return 0;
+  }
+
+  patch_scan sc;
+  sc.segyf = segyf;
+  sc.p = p;
+  sc.flags = flags;
+  sc.map = NULL;
+  sc.res = &r;
+  size_t maplen = 0;
+  if ((flags & SEGY_PATCH_MMAP) && !(flags & SEGY_PATCH_DRYRUN) && fd >= 0) {
+    struct stat st;
+    if (0 == fstat(fd, &st) && st.st_size > 0) {
+      maplen = (size_t)st.st_size;
+      void* m = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (MAP_FAILED != m)
+        sc.map = (char*)m;
+      else
+        warninginfo("patch: mmap failed, writing with pwrite");
+    }
+  }
+
+  nthreads = segy_nthreads(nthreads);
+  sc.tbuf = (patch_tbuf*)calloc(nthreads, sizeof(patch_tbuf));
+  if (!sc.tbuf)
+    errorinfo("malloc failed for patch buffers");
+  segy_scan_headers(segyf, 0, segyf->ntrace, nthreads, patch_batch, &sc);
+  for (int t = 0; t < nthreads; t++) {
+    free(sc.tbuf[t].work);
+    free(sc.tbuf[t].vals);
+  }
+  free(sc.tbuf);
+
+  if (sc.map) {
+    if (msync(sc.map, maplen, MS_SYNC))
+      r.nfailed = r.nchanged;
+    munmap(sc.map, maplen);
+  }
+  /* drop stdio data buffered before the patch */
+  segy_seek(segyf, segy_seek(segyf, 0, SEEK_CUR), SEEK_SET);
+
+  if (r.nscan != segyf->ntrace)
+    warninginfo("patch: read %llu of %zu headers", (unsigned long long)r.nscan,
+                segyf->ntrace);
+  if (r.nclamped)
+    warninginfo("patch: %llu values clamped to their key range",
+                (unsigned long long)r.nclamped);
+  if (r.nfailed)
+    warninginfo("patch: %llu headers could not be written", (unsigned long long)r.nfailed);
+  if (res)
+    *res = r;
+  return r.nscan == segyf->ntrace && 0 == r.nfailed;
+}
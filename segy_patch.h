@@ -0,0 +1,43 @@
+/* In-place batched trace header patching */
+#ifndef _segy_patch_h
+#define _segy_patch_h
+
+#include <stdint.h>
+#include "segy.h"
+#include "segy_expr.h"
+
+enum {
+  SEGY_PATCH_DRYRUN = 1, /* count the changes, write nothing */
+  SEGY_PATCH_MMAP = 2,   /* write through a shared mapping instead of pwrite */
+};
+
+/** assignments "key = expression; ..." applied to every trace header */
+typedef struct segy_patch segy_patch;
+
+/** what a patch did */
+typedef struct {
+  uint64_t nscan;     // headers evaluated
+  uint64_t nchanged;  // headers whose bytes changed, written unless SEGY_PATCH_DRYRUN
+  uint64_t nclamped;  // values clamped to the 2 or 4 byte range of their key
+  uint64_t nfailed;   // changed headers that could not be written
+} segy_patch_result;
+
+/*< compile assignments separated by ; or newlines, e.g. "offset = gx - sx; scalco = -100",
+-- run in order so later ones see earlier results, the right hand sides may use
+-- lut(name, x) with the tables luts[nlut]; return NULL and warn on errors >*/
+segy_patch* segypatch_parse(const char* text, segy_lut* const* luts, int nlut);
+
+/*< apply a patch to all trace headers of segyf in parallel batches, only changed
+-- 240 bytes headers are written back and the samples are never touched; segyf must
+-- be open for reading and writing unless SEGY_PATCH_DRYRUN; return 1 on success >*/
+int segypatch_apply(segyfile segyf, const segy_patch* p, int flags, int nthreads,
+                    segy_patch_result* res);
+
+/*< apply a patch in memory to n raw headers at buf, header j at buf + j * stride
+-- (SEGY_THNBYTES for headers, nsegy for whole records); return the values clamped >*/
+uint64_t segypatch_headers(const segy_patch* p, char* buf, size_t stride, size_t n);
+
+/*< free a patch >*/
+void segypatch_free(segy_patch* p);
+
+#endif
@@ -0,0 +1,724 @@
+/* Multi-stage trace processing pipelines on a thread pool */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+/* Traces move in packets. Parallel stages (read, map, filter, reduce, encode) run on
+   any worker; a packet runs through consecutive parallel stages on the worker that
+   took it. Serial stages (gather, sink) get the packets through a reorder buffer and
+   handle them one at a time in sequence order. Workers keep their packets in their
+   own deque and steal from the others when it is empty. Packets come from a free list
+   and go back to it; the source waits while depth packets are in flight, which bounds
+   the queues and the memory behind them. */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_pipe.h"
+
+#define PIPE_BATCH 64    /* default traces per packet */
+#define PIPE_DEPTH 4     /* default packets in flight per worker */
+#define PIPE_MAXSTAGE 32
+
+enum { PIPE_READ, PIPE_MAP, PIPE_FILTER, PIPE_GATHER, PIPE_REDUCE, PIPE_ENCODE, PIPE_SINK };
+
+typedef struct pipe_packet {
+  struct pipe_packet* next; /* free list */
+  size_t seq;               /* order at the next serial stage */
+  int stage;                /* next stage to run */
+  int eos;                  /* the end of the stream, after the last packet */
+  size_t itr0;              /* first trace of a file source packet */
+  size_t n, cap;            /* traces, room for traces */
+  size_t* itr;
+  int* thead;               /* cap * SEGY_THNKEYS */
+  float* trace;             /* cap * ns */
+  char* raw;                /* records of file sources and sinks */
+  size_t rawcap;            /* room for records */
+} pipe_packet;
+
+typedef struct {
+  int kind;
+  segy_pipe_fn fn;
+  segy_pipe_reduce_fn reduce;
+  segy_pipe_sink_fn sink;
+  void* arg;
+  int key;             /* gather key */
+  segyfile segyf;      /* file source or sink */
+
+  /* serial stages */
+  pthread_mutex_t lock;
+  int busy;            /* a worker is handling packets in order */
+  size_t next;         /* sequence number handled next */
+  pipe_packet** rob;   /* reorder buffer, slot seq % robcap */
+  size_t robcap;       /* power of two */
+  size_t nout;         /* gather: packets emitted */
+  pipe_packet* cur;    /* gather: the gather being collected */
+  size_t itr;          /* file sink: trace the next packet is written at */
+} pipe_stage;
+
+typedef struct {
+  pthread_mutex_t lock;
+  pipe_packet** buf;   /* ring, the owner works at the bottom, thieves at the top */
+  size_t top, bottom, cap;
+} pipe_deque;
+
+struct segy_pipe {
+  int ns, nthreads;
+  size_t batch, depth;
+  int nstage;
+  pipe_stage stage[PIPE_MAXSTAGE];
+  int hassource, hassink;
+  segy_pipe_source_fn source;
+  void* sourcearg;
+  segyfile in;
+  size_t in0, inn;
+
+  /* packets */
+  pthread_mutex_t lock;
+  pthread_cond_t room;  /* a packet went back to the free list */
+  pthread_cond_t done;  /* the end of the stream reached the sink */
+  pipe_packet* free;
+  size_t inflight;
+  int finished;
+
+  /* workers */
+  pipe_deque* dq;
+  pthread_t* thread;
+  pthread_mutex_t wlock;
+  pthread_cond_t wcond;
+  size_t nqueued;
+  int nsleep;
+  int quit;
+  size_t rr;           /* deque for packets of the source thread */
+
+  int failed;
+  segy_pipe_stats st;
+};
+
+typedef struct {
+  segy_pipe* p;
+  int tid;
+} pipe_worker;
+
+static inline void pipe_fail(segy_pipe* p) {
+  __atomic_store_n(&p->failed, 1, __ATOMIC_RELAXED);
+}
+
+static inline int pipe_failed(segy_pipe* p) {
+  return __atomic_load_n(&p->failed, __ATOMIC_RELAXED);
+}
+
+/* room for cap traces in q */
+static void pipe_grow(segy_pipe* p, pipe_packet* q, size_t cap) {
+  if (q->cap >= cap)
+    return;
+  cap = cap > 2 * q->cap ? cap : 2 * q->cap;
+  q->itr = (size_t*)realloc(q->itr, sizeof(size_t) * cap);
+  q->thead = (int*)realloc(q->thead, sizeof(int) * SEGY_THNKEYS * cap);
+  q->trace = (float*)realloc(q->trace, sizeof(float) * p->ns * cap);
+  if (!q->itr || !q->thead || !q->trace)
+    errorinfo("malloc failed for pipeline packet");
+  q->cap = cap;
+  segy_stats_add(&p->st.nalloc, 1);
+}
+
+/* room for n records of nsegy bytes in q */
+static void pipe_grow_raw(segy_pipe* p, pipe_packet* q, size_t n, size_t nsegy) {
+  if (q->rawcap >= n * nsegy)
+    return;
+  q->rawcap = n * nsegy > 2 * q->rawcap ? n * nsegy : 2 * q->rawcap;
+  q->raw = (char*)realloc(q->raw, q->rawcap);
+  if (!q->raw)
+    errorinfo("malloc failed for pipeline packet");
+  segy_stats_add(&p->st.nalloc, 1);
+}
+
+/* a packet from the free list, the source waits for one when wait is set */
+static pipe_packet* pipe_get(segy_pipe* p, int wait) {
+  pthread_mutex_lock(&p->lock);
+  if (wait && p->inflight >= p->depth) {
+    p->st.nstall++;
+    while (p->inflight >= p->depth)
+      pthread_cond_wait(&p->room, &p->lock);
+  }
+  pipe_packet* q = p->free;
+  if (q)
+    p->free = q->next;
+  p->inflight++;
+  pthread_mutex_unlock(&p->lock);
+  if (!q) {
+    q = (pipe_packet*)calloc(1, sizeof(pipe_packet));
+    if (!q)
+      errorinfo("malloc failed for pipeline packet");
+    segy_stats_add(&p->st.nalloc, 1);
+    pipe_grow(p, q, p->batch);
+  }
+  q->n = 0;
+  q->eos = 0;
+  q->stage = 0;
+  return q;
+}
+
+static void pipe_put(segy_pipe* p, pipe_packet* q) {
+  pthread_mutex_lock(&p->lock);
+  q->next = p->free;
+  p->free = q;
+  p->inflight--;
+  pthread_cond_signal(&p->room);
+  pthread_mutex_unlock(&p->lock);
+}
+
+static void pipe_packet_free(pipe_packet* q) {
+  free(q->itr);
+  free(q->thead);
+  free(q->trace);
+  free(q->raw);
+  free(q);
+}
+
+/* queue q on the deque of worker tid, or of the next worker for the source thread */
+static void pipe_push(segy_pipe* p, pipe_packet* q, int tid) {
+  if (tid < 0)
+    tid = (int)(p->rr++ % (size_t)p->nthreads);
+  /* counted first, a worker may take q before this returns */
+  pthread_mutex_lock(&p->wlock);
+  p->nqueued++;
+  if (p->nsleep)
+    pthread_cond_signal(&p->wcond);
+  pthread_mutex_unlock(&p->wlock);
+
+  pipe_deque* d = p->dq + tid;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom - d->top == d->cap) {
+    size_t cap = d->cap ? 2 * d->cap : 64;
+    pipe_packet** buf = (pipe_packet**)malloc(sizeof(pipe_packet*) * cap);
+    if (!buf)
+      errorinfo("malloc failed for pipeline queue");
+    for (size_t i = d->top; i < d->bottom; i++)
+      buf[i % cap] = d->buf[i % d->cap];
+    free(d->buf);
+    d->buf = buf;
+    d->cap = cap;
+  }
+  d->buf[d->bottom++ % d->cap] = q;
+  pthread_mutex_unlock(&d->lock);
+}
+
+/* the newest packet of worker tid, else the oldest of another worker */
+static pipe_packet* pipe_take(segy_pipe* p, int tid) {
+  pipe_packet* q = NULL;
+  pipe_deque* d = p->dq + tid;
+  pthread_mutex_lock(&d->lock);
+  if (d->bottom > d->top)
+    q = d->buf[--d->bottom % d->cap];
+  pthread_mutex_unlock(&d->lock);
+  for (int i = 1; !q && i < p->nthreads; i++) {
+    d = p->dq + (tid + i) % p->nthreads;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+      q = d->buf[d->top++ % d->cap];
+      segy_stats_add(&p->st.nsteal, 1);
+    }
+    pthread_mutex_unlock(&d->lock);
+  }
+  if (q) {
+    pthread_mutex_lock(&p->wlock);
+    p->nqueued--;
+    pthread_mutex_unlock(&p->wlock);
+  }
+  return q;
+}
+
+static void pipe_read(segy_pipe* p, pipe_stage* s, pipe_packet* q) {
+  segyfile segyf = s->segyf;
+  size_t nsegy = segyf->nsegy;
+  pipe_grow_raw(p, q, q->n, nsegy);
+  if (q->n != segyread_traces_raw(segyf, q->itr0, q->n, q->raw)) {
+    warninginfo("pipeline: cannot read traces %zu to %zu", q->itr0, q->itr0 + q->n);
+    pipe_fail(p);
+    return;
+  }
+  uint64_t t0 = SEGY_TIC(segyf);
+  for (size_t j = 0; j < q->n; j++) {
+    char* rec = q->raw + j * nsegy;
+    q->itr[j] = q->itr0 + j;
+    segy2head(rec, q->thead + j * SEGY_THNKEYS, SEGY_THNKEYS);
+    segy2trace(rec + SEGY_THNBYTES, q->trace + j * p->ns, p->ns, segyf->format);
+    segyquant_rescale(q->trace + j * p->ns, p->ns, segyquant_exponent(segyf, rec));
+  }
+  segy_count_sample(segyf, q->n, t0);
+  segy_count_traces_read(segyf, q->n);
+}
+
+static void pipe_encode(segy_pipe* p, pipe_stage* s, pipe_packet* q) {
+  segyfile segyf = s->segyf;
+  size_t nsegy = segyf->nsegy;
+  pipe_grow_raw(p, q, q->n, nsegy);
+  for (size_t j = 0; j < q->n; j++) {
+    char* rec = q->raw + j * nsegy;
+    memset(rec, 0, SEGY_THNBYTES); /* head2segy leaves zero keys alone */
+    head2segy(rec, q->thead + j * SEGY_THNKEYS, SEGY_THNKEYS);
+    segyquant_encode(segyf, rec, q->trace + j * p->ns);
+  }
+}
+
+/* run parallel stage s on q */
+static void pipe_parallel(segy_pipe* p, pipe_stage* s, pipe_packet* q, int tid) {
+  size_t m = 0;
+  switch (s->kind) {
+    case PIPE_READ:
+      pipe_read(p, s, q);
+      break;
+    case PIPE_MAP:
+      for (size_t j = 0; j < q->n; j++)
+        if (!s->fn(s->arg, q->itr[j], q->thead + j * SEGY_THNKEYS, q->trace + j * p->ns, p->ns,
+                   tid)) {
+          warninginfo("pipeline: a map stopped at trace %zu", q->itr[j]);
+          pipe_fail(p);
+          break;
+        }
+      break;
+    case PIPE_FILTER:
+      for (size_t j = 0; j < q->n; j++) {
+        if (!s->fn(s->arg, q->itr[j], q->thead + j * SEGY_THNKEYS, q->trace + j * p->ns, p->ns,
+                   tid))
+          continue;
+        if (m != j) {
+          q->itr[m] = q->itr[j];
+          memcpy(q->thead + m * SEGY_THNKEYS, q->thead + j * SEGY_THNKEYS,
+                 sizeof(int) * SEGY_THNKEYS);
+          memcpy(q->trace + m * p->ns, q->trace + j * p->ns, sizeof(float) * p->ns);
+        }
+        m++;
+      }
+      q->n = m;
+      break;
+    case PIPE_REDUCE:
+      m = s->reduce(s->arg, q->n, q->itr, q->thead, q->trace, p->ns, tid);
+      q->n = m < q->n ? m : q->n;
+      break;
+    case PIPE_ENCODE:
+      pipe_encode(p, s, q);
+      break;
+  }
+}
+
+/* gather stage: collect the traces of q into gathers, emit the finished ones */
+static void pipe_gather(segy_pipe* p, pipe_stage* s, pipe_packet* q, int tid) {
+  int here = (int)(s - p->stage);
+  for (size_t j = 0; j < q->n && !pipe_failed(p); j++) {
+    const int* h = q->thead + j * SEGY_THNKEYS;
+    pipe_packet* g = s->cur;
+    if (g && g->n > 0 && g->thead[s->key] != h[s->key]) {
+      g->seq = s->nout++;
+      g->stage = here + 1;
+      pipe_push(p, g, tid);
+      g = NULL;
+    }
+    if (!g)
+      g = s->cur = pipe_get(p, 0);
+    pipe_grow(p, g, g->n + 1);
+    g->itr[g->n] = q->itr[j];
+    memcpy(g->thead + g->n * SEGY_THNKEYS, h, sizeof(int) * SEGY_THNKEYS);
+    memcpy(g->trace + g->n * p->ns, q->trace + j * p->ns, sizeof(float) * p->ns);
+    g->n++;
+  }
+  if (!q->eos) {
+    pipe_put(p, q);
+    return;
+  }
+  if (s->cur) {
+    s->cur->seq = s->nout++;
+    s->cur->stage = here + 1;
+    pipe_push(p, s->cur, tid);
+    s->cur = NULL;
+  }
+  q->seq = s->nout++;
+  q->stage = here + 1;
+  pipe_push(p, q, tid);
+}
+
+static void pipe_sink(segy_pipe* p, pipe_stage* s, pipe_packet* q) {
+  if (q->eos) {
+    pipe_put(p, q);
+    pthread_mutex_lock(&p->lock);
+    p->finished = 1;
+    pthread_cond_signal(&p->done);
+    pthread_mutex_unlock(&p->lock);
+    return;
+  }
+  if (!pipe_failed(p) && q->n > 0) {
+    if (s->segyf) {
+      segyfile out = s->segyf;
+      if (q->n != segywrite_traces_raw(out, s->itr, q->n, q->raw)) {
+        warninginfo("pipeline: cannot write traces after %zu", s->itr);
+        pipe_fail(p);
+      } else {
+        s->itr += q->n;
+        if (out->ntrace < s->itr)
+          out->ntrace = s->itr;
+      }
+    } else {
+      for (size_t j = 0; j < q->n; j++)
+        if (!s->sink(s->arg, q->itr[j], q->thead + j * SEGY_THNKEYS, q->trace + j * p->ns,
+                     p->ns)) {
+          warninginfo("pipeline: the sink stopped at trace %zu", q->itr[j]);
+          pipe_fail(p);
+          break;
+        }
+    }
+    if (!pipe_failed(p))
+      p->st.ntrace_out += q->n;
+  }
+  p->st.npacket++;
+  pipe_put(p, q);
+}
+
+/* put q in the reorder buffer of serial stage s, then handle the packets that are next
+   in order unless another worker already does */
+static void pipe_serial(segy_pipe* p, pipe_stage* s, pipe_packet* q, int tid) {
+  pthread_mutex_lock(&s->lock);
+  if (q->seq - s->next >= s->robcap) {
+    size_t cap = s->robcap ? s->robcap : 16;
+    while (q->seq - s->next >= cap)
+      cap *= 2;
+    pipe_packet** rob = (pipe_packet**)calloc(cap, sizeof(pipe_packet*));
+    if (!rob)
+      errorinfo("malloc failed for pipeline reorder buffer");
+    for (size_t i = 0; i < s->robcap; i++)
+      if (s->rob[i])
+        rob[s->rob[i]->seq % cap] = s->rob[i];
+    free(s->rob);
+    s->rob = rob;
+    s->robcap = cap;
+    segy_stats_add(&p->st.nalloc, 1);
+  }
+  s->rob[q->seq % s->robcap] = q;
+  if (s->busy) {
+    pthread_mutex_unlock(&s->lock);
+    return;
+  }
+  s->busy = 1;
+  while ((q = s->rob[s->next % s->robcap]) && q->seq == s->next) {
+    s->rob[s->next % s->robcap] = NULL;
+    s->next++;
+    pthread_mutex_unlock(&s->lock);
+    if (PIPE_GATHER == s->kind)
+      pipe_gather(p, s, q, tid);
+    else
+      pipe_sink(p, s, q);
+    pthread_mutex_lock(&s->lock);
+  }
+  s->busy = 0;
+  pthread_mutex_unlock(&s->lock);
+}
+
+/* run q through the stages until a serial stage takes it */
+static void pipe_advance(segy_pipe* p, pipe_packet* q, int tid) {
+  for (; q->stage < p->nstage; q->stage++) {
+    pipe_stage* s = p->stage + q->stage;
+    if (PIPE_GATHER == s->kind || PIPE_SINK == s->kind) {
+      pipe_serial(p, s, q, tid);
+      return;
+    }
+    if (!q->eos && !pipe_failed(p))
+      pipe_parallel(p, s, q, tid);
+  }
+}
+
+static void* pipe_work(void* arg) {
+  pipe_worker* w = (pipe_worker*)arg;
+  segy_pipe* p = w->p;
+  for (;;) {
+    pipe_packet* q = pipe_take(p, w->tid);
+    if (q) {
+      pipe_advance(p, q, w->tid);
+      continue;
+    }
+    pthread_mutex_lock(&p->wlock);
+    while (0 == p->nqueued && !p->quit) {
+      p->nsleep++;
+      pthread_cond_wait(&p->wcond, &p->wlock);
+      p->nsleep--;
+    }
+    int quit = p->quit && 0 == p->nqueued;
+    pthread_mutex_unlock(&p->wlock);
+    if (quit)
+      break;
+  }
+  return NULL;
+}
+
+segy_pipe* segypipe_new(int ns, int nthreads, int batch, int depth) {
+  if (ns <= 0)
+    errorinfo("pipeline: ns must be positive, not %d", ns);
+  segy_pipe* p = (segy_pipe*)calloc(1, sizeof(segy_pipe));
+  if (!p)
+    errorinfo("malloc failed for pipeline");
+  p->ns = ns;
+  p->nthreads = segy_nthreads(nthreads);
+  p->batch = batch > 0 ? (size_t)batch : PIPE_BATCH;
+  p->depth = depth > 0 ? (size_t)depth : (size_t)PIPE_DEPTH * p->nthreads;
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->room, NULL);
+  pthread_cond_init(&p->done, NULL);
+  pthread_mutex_init(&p->wlock, NULL);
+  pthread_cond_init(&p->wcond, NULL);
+  p->dq = (pipe_deque*)calloc(p->nthreads, sizeof(pipe_deque));
+  if (!p->dq)
+    errorinfo("malloc failed for pipeline queues");
+  for (int t = 0; t < p->nthreads; t++)
+    pthread_mutex_init(&p->dq[t].lock, NULL);
+  return p;
+}
+
+static pipe_stage* pipe_add(segy_pipe* p, int kind) {
+  if (p->hassink) {
+    warninginfo("pipeline: no stage can follow the sink");
+    return NULL;
+  }
+  if (p->nstage == PIPE_MAXSTAGE) {
+    warninginfo("pipeline: more than %d stages", PIPE_MAXSTAGE);
+    return NULL;
+  }
+  pipe_stage* s = p->stage + p->nstage++;
+  memset(s, 0, sizeof(*s));
+  s->kind = kind;
+  pthread_mutex_init(&s->lock, NULL);
+  return s;
+}
+
+int segypipe_source_file(segy_pipe* p, segyfile in, size_t itr0, size_t n) {
+  if (p->hassource || p->nstage > 0) {
+    warninginfo("pipeline: the source must be the first stage");
+    return 0;
+  }
+  if (in->ns != p->ns) {
+    warninginfo("pipeline: the source has ns %d, the pipeline %d", in->ns, p->ns);
+    return 0;
+  }
+  pipe_stage* s = pipe_add(p, PIPE_READ);
+  s->segyf = in;
+  p->in = in;
+  p->in0 = itr0 < in->ntrace ? itr0 : in->ntrace;
+  p->inn = n < in->ntrace - p->in0 ? n : in->ntrace - p->in0;
+  p->hassource = 1;
+  return 1;
+}
+
+int segypipe_source(segy_pipe* p, segy_pipe_source_fn fn, void* arg) {
+  if (p->hassource || p->nstage > 0) {
+    warninginfo("pipeline: the source must be the first stage");
+    return 0;
+  }
+  p->source = fn;
+  p->sourcearg = arg;
+  p->hassource = 1;
+  return 1;
+}
+
+int segypipe_map(segy_pipe* p, segy_pipe_fn fn, void* arg) {
+  pipe_stage* s = pipe_add(p, PIPE_MAP);
+  if (s) {
+    s->fn = fn;
+    s->arg = arg;
+  }
+  return NULL != s;
+}
+
+int segypipe_filter(segy_pipe* p, segy_pipe_fn fn, void* arg) {
+  pipe_stage* s = pipe_add(p, PIPE_FILTER);
+  if (s) {
+    s->fn = fn;
+    s->arg = arg;
+  }
+  return NULL != s;
+}
+
+int segypipe_gather(segy_pipe* p, int key, segy_pipe_reduce_fn fn, void* arg) {
+  if (key < 0 || key >= SEGY_THNKEYS) {
+    warninginfo("pipeline: no trace header key %d", key);
+    return 0;
+  }
+  if (p->hassink || p->nstage + 2 > PIPE_MAXSTAGE) {
+    warninginfo("pipeline: cannot add the gather");
+    return 0;
+  }
+  pipe_stage* s = pipe_add(p, PIPE_GATHER);
+  s->key = key;
+  s = pipe_add(p, PIPE_REDUCE);
+  s->reduce = fn;
+  s->arg = arg;
+  return 1;
+}
+
+int segypipe_sink_file(segy_pipe* p, segyfile out) {
+  if (out->ns != p->ns) {
+    warninginfo("pipeline: the sink has ns %d, the pipeline %d", out->ns, p->ns);
+    return 0;
+  }
+  if (p->hassink || p->nstage + 2 > PIPE_MAXSTAGE) {
+    warninginfo("pipeline: cannot add the sink");
+    return 0;
+  }
+  pipe_add(p, PIPE_ENCODE)->segyf = out;
+  pipe_add(p, PIPE_SINK)->segyf = out;
+  p->hassink = 1;
+  return 1;
+}
+
+int segypipe_sink(segy_pipe* p, segy_pipe_sink_fn fn, void* arg) {
+  pipe_stage* s = pipe_add(p, PIPE_SINK);
+  if (!s)
+    return 0;
+  s->sink = fn;
+  s->arg = arg;
+  p->hassink = 1;
+  return 1;
+}
+
+/* the next packet of a source callback, NULL at the end */
+static pipe_packet* pipe_source_next(segy_pipe* p, size_t* itr) {
+  pipe_packet* q = pipe_get(p, 1);
+  if (p->in) {
+    size_t end = p->in0 + p->inn;
+    q->itr0 = *itr;
+    q->n = end - *itr < p->batch ? end - *itr : p->batch;
+  } else {
+    while (q->n < p->batch) {
+      int* h = q->thead + q->n * SEGY_THNKEYS;
+      memset(h, 0, sizeof(int) * SEGY_THNKEYS);
+      if (!p->source(p->sourcearg, h, q->trace + q->n * p->ns, p->ns))
+        break;
+      q->itr[q->n] = *itr + q->n;
+      q->n++;
+    }
+  }
+  if (0 == q->n) {
+    pipe_put(p, q);
+    return NULL;
+  }
+  *itr += q->n;
+  return q;
+}
+
+size_t segypipe_run(segy_pipe* p) {
+  if (!p->hassource || !p->hassink) {
+    warninginfo("pipeline: a source and a sink are needed");
+    return 0;
+  }
+  memset(&p->st, 0, sizeof(p->st));
+  p->failed = 0;
+  p->finished = 0;
+  p->quit = 0;
+  size_t ngather = 0;
+  for (int i = 0; i < p->nstage; i++) {
+    pipe_stage* s = p->stage + i;
+    s->next = 0;
+    s->nout = 0;
+    ngather += PIPE_GATHER == s->kind;
+    if (PIPE_SINK == s->kind && s->segyf) {
+      /* the traces go after the sequential position of the sink, headers a stream
+         still buffers go out first */
+      segyio_flush(s->segyf->io, 0);
+      int64_t pos = segy_seek(s->segyf, 0, SEEK_CUR);
+      int64_t off0 = segy_trace_offset(s->segyf, 0);
+      s->itr = pos > off0 ? (size_t)((pos - off0) / s->segyf->nsegy) : 0;
+    }
+  }
+  /* every gather holds the packet it collects, the source needs one more */
+  if (p->depth <= ngather)
+    p->depth = ngather + 1;
+  if (p->in)
+    segyio_hint(p->in->io, segy_trace_offset(p->in, p->in0),
+                (int64_t)(p->inn * p->in->nsegy), SEGY_IO_SEQUENTIAL);
+
+  pipe_worker* w = (pipe_worker*)malloc(sizeof(pipe_worker) * p->nthreads);
+  p->thread = (pthread_t*)malloc(sizeof(pthread_t) * p->nthreads);
+  if (!w || !p->thread)
+    errorinfo("malloc failed for pipeline workers");
+  for (int t = 0; t < p->nthreads; t++) {
+    w[t].p = p;
+    w[t].tid = t;
+    if (pthread_create(p->thread + t, NULL, pipe_work, w + t))
+      errorinfo("pipeline: cannot start worker %d", t);
+  }
+
+  size_t seq = 0, itr = p->in ? p->in0 : 0;
+  pipe_packet* q;
+  while (!pipe_failed(p) && (q = pipe_source_next(p, &itr))) {
+    p->st.ntrace_in += q->n;
+    q->seq = seq++;
+    pipe_push(p, q, -1);
+  }
+  q = pipe_get(p, 0);
+  q->eos = 1;
+  q->seq = seq;
+  pipe_push(p, q, -1);
+
+  pthread_mutex_lock(&p->lock);
+  while (!p->finished)
+    pthread_cond_wait(&p->done, &p->lock);
+  pthread_mutex_unlock(&p->lock);
+
+  pthread_mutex_lock(&p->wlock);
+  p->quit = 1;
+  pthread_cond_broadcast(&p->wcond);
+  pthread_mutex_unlock(&p->wlock);
+  for (int t = 0; t < p->nthreads; t++)
+    pthread_join(p->thread[t], NULL);
+  free(p->thread);
+  p->thread = NULL;
+  free(w);
+
+  if (p->in) {
+    /* the sequential calls continue after the traces read */
+    segy_seek(p->in, segy_trace_offset(p->in, itr), SEEK_SET);
+  }
+  for (int i = 0; i < p->nstage; i++)
+    if (PIPE_SINK == p->stage[i].kind && p->stage[i].segyf)
+      segy_seek(p->stage[i].segyf, segy_trace_offset(p->stage[i].segyf, p->stage[i].itr),
+                SEEK_SET);
+  p->st.failed = p->failed;
+  return p->st.ntrace_out;
+}
+
+void segypipe_stats(const segy_pipe* p, segy_pipe_stats* st) {
+  *st = p->st;
+}
+
+void segypipe_free(segy_pipe* p) {
+  if (!p)
+    return;
+  while (p->free) {
+    pipe_packet* q = p->free;
+    p->free = q->next;
+    pipe_packet_free(q);
+  }
+  for (int i = 0; i < p->nstage; i++) {
+    free(p->stage[i].rob);
+    pthread_mutex_destroy(&p->stage[i].lock);
+  }
+  for (int t = 0; t < p->nthreads; t++) {
+    free(p->dq[t].buf);
+    pthread_mutex_destroy(&p->dq[t].lock);
+  }
+  free(p->dq);
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->room);
+  pthread_cond_destroy(&p->done);
+  pthread_mutex_destroy(&p->wlock);
+  pthread_cond_destroy(&p->wcond);
+  free(p);
+}
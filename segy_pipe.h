@@ -0,0 +1,77 @@
+/* Multi-stage trace processing pipelines on a thread pool */
+#ifndef _segy_pipe_h
+#define _segy_pipe_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "segy.h"
+
+typedef struct segy_pipe segy_pipe;
+
+/* a map or filter on trace itr with thead[SEGY_THNKEYS] and trace[ns], tid is the
+   worker; a map returns 0 to stop the pipeline with an error, a filter returns 0 to
+   drop the trace */
+typedef int (*segy_pipe_fn)(void* arg, size_t itr, int* thead, float* trace, int ns, int tid);
+
+/* a gather of n traces, itr[n], thead[n * SEGY_THNKEYS] and trace[n * ns], reduced in
+   place to the first m <= n traces, return m */
+typedef size_t (*segy_pipe_reduce_fn)(void* arg, size_t n, size_t* itr, int* thead, float* trace,
+                                      int ns, int tid);
+
+/* a source fills thead (zeroed) and trace of the next trace, return 0 at the end */
+typedef int (*segy_pipe_source_fn)(void* arg, int* thead, float* trace, int ns);
+
+/* a sink gets the traces in order, return 0 to stop the pipeline with an error */
+typedef int (*segy_pipe_sink_fn)(void* arg, size_t itr, const int* thead, const float* trace,
+                                 int ns);
+
+/** pipeline counters */
+typedef struct {
+  uint64_t ntrace_in;   // traces from the source
+  uint64_t ntrace_out;  // traces to the sink
+  uint64_t npacket;     // packets that went through the stages
+  uint64_t nalloc;      // packet allocations and growths, stops at the steady state
+  uint64_t nsteal;      // packets a worker took from another worker
+  uint64_t nstall;      // times the source waited for a free packet
+  int failed;           // a stage stopped the pipeline
+} segy_pipe_stats;
+
+/*< new pipeline of traces of ns samples on nthreads workers (0 for all cores); traces
+-- move in packets of batch traces (0 means 64), at most depth packets (0 means 4 per
+-- worker, at least one more than the gathers) are in flight before the source waits >*/
+segy_pipe* segypipe_new(int ns, int nthreads, int batch, int depth);
+
+/*< read traces [itr0, itr0 + n) of in, decoded in parallel by the workers >*/
+int segypipe_source_file(segy_pipe* p, segyfile in, size_t itr0, size_t n);
+
+/*< take traces from fn, called on the thread of segypipe_run >*/
+int segypipe_source(segy_pipe* p, segy_pipe_source_fn fn, void* arg);
+
+/*< add a map, run on many traces at once by the workers >*/
+int segypipe_map(segy_pipe* p, segy_pipe_fn fn, void* arg);
+
+/*< add a filter, run on many traces at once by the workers >*/
+int segypipe_filter(segy_pipe* p, segy_pipe_fn fn, void* arg);
+
+/*< group consecutive traces of equal header key into gathers, reduced by fn on many
+-- gathers at once >*/
+int segypipe_gather(segy_pipe* p, int key, segy_pipe_reduce_fn fn, void* arg);
+
+/*< write the traces in order to out from its sequential position on (after the
+-- headers of a new file), encoded in parallel; the position ends after them >*/
+int segypipe_sink_file(segy_pipe* p, segyfile out);
+
+/*< hand the traces in order to fn >*/
+int segypipe_sink(segy_pipe* p, segy_pipe_sink_fn fn, void* arg);
+
+/*< run the stages from the source to the sink in the order they were added, return
+-- the traces that reached the sink >*/
+size_t segypipe_run(segy_pipe* p);
+
+/*< copy the counters of the last run >*/
+void segypipe_stats(const segy_pipe* p, segy_pipe_stats* st);
+
+/*< free the pipeline and its packets >*/
+void segypipe_free(segy_pipe* p);
+
+#endif
@@ -0,0 +1,515 @@
+/* Multi-resolution overview pyramids of SEGY lines and cubes in a sidecar file */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_pyramid.h"
+
+#define PYR_MAGIC "ESEGYPY1"      /* sidecar magic */
+#define PYR_HEADBYTES 512         /* magic, ns, format, ntrace, file size, grid, levels, stamp */
+#define PYR_STAMPOFF 472          /* after the SEGY_PYR_MAXLEVEL + 1 levels */
+#define PYR_LEVELBYTES 24         /* nx, ny, nt, 0, offset */
+#define PYR_TOPSIZE 512           /* automatic levels stop at this spatial size */
+#define PYR_BATCHBYTES (4 << 20)  /* bytes of records a thread reads at a time */
+#define PYR_NOCELL SIZE_MAX
+
+void segypyr_opts_init(segy_pyr_opts* o) {
+  memset(o, 0, sizeof(*o));
+  o->ikey = -1;
+  o->xkey = -1;
+}
+
+static inline int pyr_half(int n) {
+  return (n + 1) / 2;
+}
+
+/* sizes and offsets of the levels above level 0 of nx x ny cells of ns samples */
+static void pyr_levels(segy_pyramid* p, int nx, int ny, int ns, int nlevel) {
+  int autolevel = nlevel <= 0;
+  if (autolevel || nlevel > SEGY_PYR_MAXLEVEL)
+    nlevel = SEGY_PYR_MAXLEVEL;
+  p->level[0].nx = nx;
+  p->level[0].ny = ny;
+  p->level[0].nt = ns;
+  p->level[0].off = 0;
+  int64_t off = PYR_HEADBYTES;
+  int l;
+  for (l = 1; l <= nlevel; l++) {
+    const segy_pyr_level* d = &p->level[l - 1];
+    int big = d->nx > d->ny ? d->nx : d->ny;
+    if ((autolevel && l > 1 && big <= PYR_TOPSIZE) || (1 == big && 1 == d->nt))
+      break;
+    segy_pyr_level* v = &p->level[l];
+    v->nx = pyr_half(d->nx);
+    v->ny = pyr_half(d->ny);
+    v->nt = pyr_half(d->nt);
+    v->off = off;
+    off += 4 * (int64_t)v->nx * v->ny * v->nt;
+  }
+  p->nlevel = l - 1;
+}
+
+/* header scans: the key ranges, then the traces of every slab */
+typedef struct {
+  const segy_pyramid* g;
+  int32_t* range;  /* imin, imax, xmin, xmax per thread */
+  size_t* lo;      /* first and last trace of every slab per thread */
+  size_t* hi;
+  size_t nslab;
+  size_t slab;     /* rows of a slab */
+} pyr_scan;
+
+static void pyr_range_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg,
+                            int tid) {
+  (void)itr0;
+  pyr_scan* sc = (pyr_scan*)arg;
+  int32_t* r = sc->range + 4 * tid;
+  for (size_t j = 0; j < n; j++) {
+    int32_t iv, xv = 0;
+    segy_decode_column(buf + j * stride, 0, 1, sc->g->ikey, &iv);
+    if (sc->g->xkey >= 0)
+      segy_decode_column(buf + j * stride, 0, 1, sc->g->xkey, &xv);
+    r[0] = iv < r[0] ? iv : r[0];
+    r[1] = iv > r[1] ? iv : r[1];
+    r[2] = xv < r[2] ? xv : r[2];
+    r[3] = xv > r[3] ? xv : r[3];
+  }
+}
+
+static void pyr_slab_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg,
+                           int tid) {
+  pyr_scan* sc = (pyr_scan*)arg;
+  size_t* lo = sc->lo + (size_t)tid * sc->nslab;
+  size_t* hi = sc->hi + (size_t)tid * sc->nslab;
+  for (size_t j = 0; j < n; j++) {
+    int32_t iv;
+    segy_decode_column(buf + j * stride, 0, 1, sc->g->ikey, &iv);
+    size_t s = (size_t)((iv - sc->g->i0) / sc->g->di) / sc->slab;
+    if (itr0 + j < lo[s])
+      lo[s] = itr0 + j;
+    if (itr0 + j + 1 > hi[s])
+      hi[s] = itr0 + j + 1;
+  }
+}
+
+/* level l of a slab from level l - 1 (m0, c0 with rows0 rows): the mean of the children
+   present weighted by their trace counts, samples averaged in pairs */
+static void pyr_down(const segy_pyr_level* d, const float* m0, const float* c0, int rows0,
+                     const segy_pyr_level* v, float* m1, float* c1, int rows1, int nthreads) {
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+  for (int y = 0; y < rows1; y++) {
+    for (int x = 0; x < v->nx; x++) {
+      float* out = m1 + ((size_t)y * v->nx + x) * v->nt;
+      float w = 0;
+      memset(out, 0, sizeof(float) * v->nt);
+      for (int yy = 2 * y; yy < 2 * y + 2 && yy < rows0; yy++)
+        for (int xx = 2 * x; xx < 2 * x + 2 && xx < d->nx; xx++) {
+          float c = c0[(size_t)yy * d->nx + xx];
+          if (0 == c)
+            continue;
+          const float* s = m0 + ((size_t)yy * d->nx + xx) * d->nt;
+          for (int t = 0; t < v->nt; t++) {
+            float b = 2 * t + 1 < d->nt ? s[2 * t + 1] : s[2 * t];
+            out[t] += c * 0.5f * (s[2 * t] + b);
+          }
+          w += c;
+        }
+      if (w > 0)
+        for (int t = 0; t < v->nt; t++)
+          out[t] /= w;
+      c1[(size_t)y * v->nx + x] = w;
+    }
+  }
+}
+
+static void pyr_head(const segy_pyramid* p, segyfile segyf, char* head) {
+  memset(head, 0, PYR_HEADBYTES);
+  memcpy(head, PYR_MAGIC, 8);
+  put32(head + 8, (uint32_t)segyf->ns);
+  put32(head + 12, (uint32_t)segyf->format);
+  put64(head + 16, (uint64_t)segyf->ntrace);
+  put64(head + 24, (uint64_t)segyio_size(segyf->io));
+  put32(head + 32, (uint32_t)p->ikey);
+  put32(head + 36, (uint32_t)p->xkey);
+  put32(head + 40, (uint32_t)p->i0);
+  put32(head + 44, (uint32_t)p->di);
+  put32(head + 48, (uint32_t)p->x0);
+  put32(head + 52, (uint32_t)p->dx);
+  put32(head + 56, (uint32_t)p->nlevel);
+  for (int l = 0; l <= p->nlevel; l++) {
+    char* q = head + 64 + l * PYR_LEVELBYTES;
+    put32(q, (uint32_t)p->level[l].nx);
+    put32(q + 4, (uint32_t)p->level[l].ny);
+    put32(q + 8, (uint32_t)p->level[l].nt);
+    put64(q + 16, (uint64_t)p->level[l].off);
+  }
+  segy_stamp(segyf, head + PYR_STAMPOFF);
+}
+
+int segypyr_build(segyfile segyf, const char* path, const segy_pyr_opts* o) {
+  if (0 == segyf->ntrace || segyf->ns <= 0) {
+    warninginfo("pyramid: no traces");
+    return 0;
+  }
+  int nthreads = segy_nthreads(o->nthreads);
+  segy_pyramid g;
+  memset(&g, 0, sizeof(g));
+  g.ikey = o->ikey;
+  g.xkey = o->ikey >= 0 ? o->xkey : -1;
+  g.di = o->di > 0 ? o->di : 1;
+  g.dx = o->dx > 0 ? o->dx : 1;
+  pyr_scan sc;
+  memset(&sc, 0, sizeof(sc));
+  sc.g = &g;
+
+  int nx = 1, ny;
+  if (g.ikey < 0) {
+    g.di = 1;
+    ny = (int)segyf->ntrace;
+  } else {
+    sc.range = (int32_t*)malloc(sizeof(int32_t) * 4 * nthreads);
+    if (!sc.range)
+      errorinfo("malloc failed for the pyramid scan");
+    for (int t = 0; t < nthreads; t++) {
+      sc.range[4 * t] = sc.range[4 * t + 2] = INT32_MAX;
+      sc.range[4 * t + 1] = sc.range[4 * t + 3] = INT32_MIN;
+    }
+    size_t nscan = segy_scan_headers(segyf, 0, segyf->ntrace, nthreads, pyr_range_batch, &sc);
+    if (nscan != segyf->ntrace) {
+      warninginfo("pyramid: read %zu of %zu trace headers", nscan, segyf->ntrace);
+      free(sc.range);
+      return 0;
+    }
+    int32_t r[4] = {INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN};
+    for (int t = 0; t < nthreads; t++) {
+      r[0] = sc.range[4 * t] < r[0] ? sc.range[4 * t] : r[0];
+      r[1] = sc.range[4 * t + 1] > r[1] ? sc.range[4 * t + 1] : r[1];
+      r[2] = sc.range[4 * t + 2] < r[2] ? sc.range[4 * t + 2] : r[2];
+      r[3] = sc.range[4 * t + 3] > r[3] ? sc.range[4 * t + 3] : r[3];
+    }
+    free(sc.range);
+    g.i0 = r[0];
+    g.x0 = g.xkey >= 0 ? r[2] : 0;
+    ny = (int)(((int64_t)r[1] - r[0]) / g.di + 1);
+    nx = g.xkey >= 0 ? (int)(((int64_t)r[3] - r[2]) / g.dx + 1) : 1;
+  }
+  pyr_levels(&g, nx, ny, segyf->ns, o->nlevel);
+  int L = g.nlevel;
+  if (0 == L) {
+    warninginfo("pyramid: %d x %d x %d needs no level", ny, nx, segyf->ns);
+    return 0;
+  }
+
+  /* slabs are a multiple of 2^L rows so that every level gets whole rows */
+  size_t unit = (size_t)1 << L;
+  size_t unitbytes = 0;
+  for (int l = 1; l <= L; l++)
+    unitbytes += (unit >> l) * g.level[l].nx * (g.level[l].nt + 1) * sizeof(float);
+  size_t budget = o->membudget > 0 ? o->membudget : (size_t)256 << 20;
+  size_t k = budget / unitbytes;
+  if (k < 1) {
+    warninginfo("pyramid: %zu KB for %zu rows, over the budget of %zu KB", unitbytes >> 10, unit,
+                budget >> 10);
+    k = 1;
+  }
+  size_t slab = k * unit, ny_up = ((size_t)ny + unit - 1) / unit * unit;
+  if (slab > ny_up)
+    slab = ny_up;
+  size_t nslab = ((size_t)ny + slab - 1) / slab;
+
+  /* trace range of every slab, one range per slab for a 2D line */
+  size_t* lo = (size_t*)malloc(sizeof(size_t) * nslab * nthreads);
+  size_t* hi = (size_t*)calloc(nslab * nthreads, sizeof(size_t));
+  if (!lo || !hi)
+    errorinfo("malloc failed for the pyramid slabs");
+  for (size_t s = 0; s < nslab * nthreads; s++)
+    lo[s] = SIZE_MAX;
+  if (g.ikey < 0) {
+    for (size_t s = 0; s < nslab; s++) {
+      lo[s] = s * slab;
+      hi[s] = (s + 1) * slab < segyf->ntrace ? (s + 1) * slab : segyf->ntrace;
+    }
+  } else {
+    sc.lo = lo;
+    sc.hi = hi;
+    sc.nslab = nslab;
+    sc.slab = slab;
+    size_t nscan = segy_scan_headers(segyf, 0, segyf->ntrace, nthreads, pyr_slab_batch, &sc);
+    if (nscan != segyf->ntrace) {
+      warninginfo("pyramid: read %zu of %zu trace headers", nscan, segyf->ntrace);
+      free(lo);
+      free(hi);
+      return 0;
+    }
+    for (int t = 1; t < nthreads; t++)
+      for (size_t s = 0; s < nslab; s++) {
+        lo[s] = lo[t * nslab + s] < lo[s] ? lo[t * nslab + s] : lo[s];
+        hi[s] = hi[t * nslab + s] > hi[s] ? hi[t * nslab + s] : hi[s];
+      }
+    size_t nread = 0;
+    for (size_t s = 0; s < nslab; s++)
+      nread += hi[s] > lo[s] ? hi[s] - lo[s] : 0;
+    if (nread > segyf->ntrace)
+      warninginfo("pyramid: traces are not sorted by %s, %.1f times the file is read",
+                  segykeyword(g.ikey), (double)nread / segyf->ntrace);
+  }
+
+  /* slab levels, and the decoded traces of one round with their level 1 cells */
+  float* m[SEGY_PYR_MAXLEVEL + 1] = {NULL};
+  float* c[SEGY_PYR_MAXLEVEL + 1] = {NULL};
+  for (int l = 1; l <= L; l++) {
+    size_t cells = (slab >> l) * g.level[l].nx;
+    m[l] = (float*)malloc(sizeof(float) * cells * g.level[l].nt);
+    c[l] = (float*)malloc(sizeof(float) * cells);
+    if (!m[l] || !c[l])
+      errorinfo("malloc failed for the pyramid slab of level %d", l);
+  }
+  const segy_pyr_level* v1 = &g.level[1];
+  size_t batch = PYR_BATCHBYTES / segyf->nsegy > 0 ? PYR_BATCHBYTES / segyf->nsegy : 1;
+  size_t round = batch * nthreads;
+  float* half = (float*)malloc(sizeof(float) * round * v1->nt);
+  size_t* cell = (size_t*)malloc(sizeof(size_t) * round);
+  char* raw = (char*)malloc(round * segyf->nsegy);
+  float* trace = (float*)malloc(sizeof(float) * segyf->ns * nthreads);
+  if (!half || !cell || !raw || !trace)
+    errorinfo("malloc failed for the pyramid buffers");
+
+  segy_io* io = segyio_open(path, "w");
+  int failed = !io;
+  size_t nread = 0;
+  for (size_t s = 0; !failed && s < nslab; s++) {
+    size_t ys = s * slab;
+    size_t rows1 = slab >> 1;
+    memset(m[1], 0, sizeof(float) * rows1 * v1->nx * v1->nt);
+    memset(c[1], 0, sizeof(float) * rows1 * v1->nx);
+    if (hi[s] > lo[s])
+      segyio_hint(segyf->io, segy_trace_offset(segyf, lo[s]),
+                  (int64_t)((hi[s] - lo[s]) * segyf->nsegy), SEGY_IO_SEQUENTIAL);
+
+    for (size_t r0 = lo[s]; !failed && r0 < hi[s]; r0 += round) {
+      size_t n = hi[s] - r0 < round ? hi[s] - r0 : round;
+      size_t nsub = (n + batch - 1) / batch;
+#pragma omp parallel num_threads(nthreads)
+      {
+        int tid = 0, nth = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        nth = omp_get_num_threads();
+#endif
+        float* tr = trace + (size_t)tid * segyf->ns;
+        /* decode the records and average the sample pairs */
+#pragma omp for schedule(static)
+        for (size_t ib = 0; ib < nsub; ib++) {
+          size_t t0 = ib * batch, nb = t0 + batch > n ? n - t0 : batch;
+          char* buf = raw + t0 * segyf->nsegy;
+          if (!segy_read_at(segyf, buf, nb * segyf->nsegy, segy_trace_offset(segyf, r0 + t0))) {
+#pragma omp atomic write
+            failed = 1;
+            continue;
+          }
+          uint64_t tic = SEGY_TIC(segyf);
+          for (size_t j = 0; j < nb; j++) {
+            const char* rec = buf + j * segyf->nsegy;
+            int64_t y = (int64_t)(r0 + t0 + j), x = 0;
+            if (g.ikey >= 0) {
+              int32_t v;
+              segy_decode_column(rec, 0, 1, g.ikey, &v);
+              y = ((int64_t)v - g.i0) / g.di;
+              if (g.xkey >= 0) {
+                segy_decode_column(rec, 0, 1, g.xkey, &v);
+                x = ((int64_t)v - g.x0) / g.dx;
+              }
+            }
+            cell[t0 + j] = PYR_NOCELL;
+            if (y < (int64_t)ys || y >= (int64_t)(ys + slab) || x < 0 || x >= nx)
+              continue;
+            cell[t0 + j] = (size_t)((y - ys) >> 1) * v1->nx + (size_t)(x >> 1);
+            segy2trace(rec + SEGY_THNBYTES, tr, segyf->ns, segyf->format);
+            segyquant_rescale(tr, segyf->ns, segyquant_exponent(segyf, rec));
+            float* h = half + (t0 + j) * v1->nt;
+            for (int t = 0; t < v1->nt; t++)
+              h[t] = 2 * t + 1 < segyf->ns ? 0.5f * (tr[2 * t] + tr[2 * t + 1]) : tr[2 * t];
+          }
+          segy_count_sample(segyf, nb, tic);
+        }
+        /* every thread adds the traces of its own cells */
+        for (size_t j = 0; j < n; j++) {
+          size_t cj = cell[j];
+          if (PYR_NOCELL == cj || (int)(cj % nth) != tid)
+            continue;
+          float* acc = m[1] + cj * v1->nt;
+          const float* h = half + j * v1->nt;
+          for (int t = 0; t < v1->nt; t++)
+            acc[t] += h[t];
+          c[1][cj] += 1;
+        }
+      }
+      nread += n;
+    }
+    if (failed)
+      break;
+
+    /* means of level 1, then the levels above it, then write them all */
+    int valid[SEGY_PYR_MAXLEVEL + 1];
+    for (int l = 1; l <= L; l++) {
+      size_t yl = ys >> l;
+      valid[l] = (int)((slab >> l) < g.level[l].ny - yl ? (slab >> l) : g.level[l].ny - yl);
+    }
+    size_t cells1 = (size_t)valid[1] * v1->nx;
+#pragma omp parallel for num_threads(nthreads)
+    for (size_t i = 0; i < cells1; i++)
+      if (c[1][i] > 0)
+        for (int t = 0; t < v1->nt; t++)
+          m[1][i * v1->nt + t] /= c[1][i];
+    for (int l = 2; l <= L; l++)
+      pyr_down(&g.level[l - 1], m[l - 1], c[l - 1], valid[l - 1], &g.level[l], m[l], c[l],
+               valid[l], nthreads);
+    for (int l = 1; l <= L && !failed; l++) {
+      const segy_pyr_level* v = &g.level[l];
+      size_t nval = (size_t)valid[l] * v->nx * v->nt;
+      for (size_t i = 0; i < nval; i++)
+        put32f((char*)(m[l] + i), m[l][i]);
+      int64_t off = v->off + 4 * (int64_t)((ys >> l) * v->nx * v->nt);
+      failed = !segyio_write_at(io, m[l], nval * sizeof(float), off);
+    }
+  }
+  segy_count_traces_read(segyf, nread);
+
+  if (!failed) {
+    char head[PYR_HEADBYTES];
+    pyr_head(&g, segyf, head);
+    failed = !segyio_write_at(io, head, PYR_HEADBYTES, 0) || !segyio_flush(io, 1);
+  }
+  if (failed)
+    warninginfo("pyramid: cannot build %s", path);
+  segyio_close(io);
+  for (int l = 1; l <= L; l++) {
+    free(m[l]);
+    free(c[l]);
+  }
+  free(half);
+  free(cell);
+  free(raw);
+  free(trace);
+  free(lo);
+  free(hi);
+  return !failed;
+}
+
+segy_pyramid* segypyr_open(const char* path, segyfile segyf) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  segy_io* io = segyio_fd(fd, 1);
+  char head[PYR_HEADBYTES];
+  if (!segyio_read_at(io, head, PYR_HEADBYTES, 0) || memcmp(head, PYR_MAGIC, 8) ||
+      (int)get32(head + 8) != segyf->ns || (int)get32(head + 12) != segyf->format ||
+      get64(head + 16) != segyf->ntrace ||
+      get64(head + 24) != (uint64_t)segyio_size(segyf->io) ||
+      get32(head + 56) > SEGY_PYR_MAXLEVEL || !segy_stamp_match(segyf, head + PYR_STAMPOFF)) {
+    segyio_close(io);
+    return NULL;
+  }
+  segy_pyramid* p = (segy_pyramid*)calloc(1, sizeof(segy_pyramid));
+  if (!p)
+    errorinfo("malloc failed for the pyramid");
+  p->io = io;
+  p->ikey = (int32_t)get32(head + 32);
+  p->xkey = (int32_t)get32(head + 36);
+  p->i0 = (int32_t)get32(head + 40);
+  p->di = (int32_t)get32(head + 44);
+  p->x0 = (int32_t)get32(head + 48);
+  p->dx = (int32_t)get32(head + 52);
+  p->nlevel = (int)get32(head + 56);
+  for (int l = 0; l <= p->nlevel; l++) {
+    const char* q = head + 64 + l * PYR_LEVELBYTES;
+    p->level[l].nx = (int)get32(q);
+    p->level[l].ny = (int)get32(q + 4);
+    p->level[l].nt = (int)get32(q + 8);
+    p->level[l].off = (int64_t)get64(q + 16);
+  }
+  return p;
+}
+
+int segypyr_lod(const segy_pyramid* p, int ny, int nx, int nt, size_t maxcells, int maxsamples) {
+  for (int l = 0; l < p->nlevel; l++) {
+    int f = 1 << l;
+    size_t cy = (size_t)(ny + f - 1) / f, cx = (size_t)(nx + f - 1) / f;
+    if (cy * cx <= maxcells && (nt + f - 1) / f <= maxsamples)
+      return l;
+  }
+  return p->nlevel;
+}
+
+int segypyr_read(const segy_pyramid* p, int level, int y0, int ny, int x0, int nx, int t0,
+                 int nt, float* out) {
+  if (level < 1 || level > p->nlevel) {
+    warninginfo("pyramid: no level %d, the levels are 1 to %d", level, p->nlevel);
+    return 0;
+  }
+  const segy_pyr_level* v = &p->level[level];
+  if (y0 < 0 || x0 < 0 || t0 < 0 || ny < 0 || nx < 0 || nt < 0 || y0 + ny > v->ny ||
+      x0 + nx > v->nx || t0 + nt > v->nt) {
+    warninginfo("pyramid: region out of level %d (%d x %d x %d)", level, v->ny, v->nx, v->nt);
+    return 0;
+  }
+  size_t rowbytes = 4 * (size_t)nx * v->nt;
+  char* buf = (char*)malloc(rowbytes > 0 ? rowbytes : 1);
+  if (!buf)
+    errorinfo("malloc failed for a pyramid read");
+  int ok = 1;
+  for (int y = 0; ok && y < ny; y++) {
+    int64_t off = v->off + 4 * (((int64_t)(y0 + y) * v->nx + x0) * v->nt);
+    ok = segyio_read_at(p->io, buf, rowbytes, off);
+    for (int x = 0; ok && x < nx; x++)
+      for (int t = 0; t < nt; t++)
+        out[((size_t)y * nx + x) * nt + t] = get32f(buf + 4 * ((size_t)x * v->nt + t0 + t));
+  }
+  free(buf);
+  if (!ok)
+    warninginfo("pyramid: cannot read level %d", level);
+  return ok;
+}
+
+void segypyr_print(const segy_pyramid* p, FILE* out) {
+  if (p->ikey >= 0)
+    fprintf(out, "grid: %s from %d step %d", segykeyword(p->ikey), p->i0, p->di);
+  else
+    fprintf(out, "grid: trace order");
+  if (p->xkey >= 0)
+    fprintf(out, ", %s from %d step %d", segykeyword(p->xkey), p->x0, p->dx);
+  fprintf(out, "\n");
+  for (int l = 0; l <= p->nlevel; l++) {
+    const segy_pyr_level* v = &p->level[l];
+    fprintf(out, "level %2d: %8d x %6d cells x %6d samples", l, v->ny, v->nx, v->nt);
+    if (l > 0)
+      fprintf(out, "  %10.2f MB", 4e-6 * v->nx * v->ny * v->nt);
+    fprintf(out, "\n");
+  }
+}
+
+void segypyr_free(segy_pyramid* p) {
+  if (p) {
+    segyio_close(p->io);
+    free(p);
+  }
+}
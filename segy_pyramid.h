@@ -0,0 +1,67 @@
+/* Multi-resolution overview pyramids of SEGY lines and cubes in a sidecar file */
+#ifndef _segy_pyramid_h
+#define _segy_pyramid_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "segy.h"
+
+#define SEGY_PYR_MAXLEVEL 16
+
+/** grid and build options */
+typedef struct {
+  int ikey;           // slow spatial key (iline), -1: the trace order of a 2D line
+  int xkey;           // fast spatial key (xline), -1: one trace per ikey value
+  int di, dx;         // key increments between grid cells, 0 means 1
+  int nlevel;         // levels, 0: until the larger spatial size is at most 512
+  size_t membudget;   // bytes of the slab buffers, 0 means 256MB
+  int nthreads;       // 0 for all cores
+} segy_pyr_opts;
+
+/** one level, samples of cell (y, x) are at off + 4 * ((y * nx + x) * nt), big-endian */
+typedef struct {
+  int nx, ny, nt;     // cells along the fast and slow axes, samples per cell
+  int64_t off;        // first byte of the level in the sidecar
+} segy_pyr_level;
+
+/** an open pyramid sidecar */
+typedef struct {
+  struct segy_io* io;
+  int ikey, xkey;
+  int i0, di;         // slow cell y = (ikey - i0) / di, the trace number for a 2D line
+  int x0, dx;         // fast cell x = (xkey - x0) / dx
+  int nlevel;
+  segy_pyr_level level[SEGY_PYR_MAXLEVEL + 1];  // level[l] is decimated by 2^l, 0 is the file
+} segy_pyramid;
+
+/*< a 2D line in trace order, automatic levels >*/
+void segypyr_opts_init(segy_pyr_opts* o);
+
+/*< write the levels of segyf to the sidecar path: every level halves the samples and
+-- the spatial axes of the level below with a 2 x 2 (x 2) box average over the traces
+-- present; the file is read once, slab by slab of the slow axis in parallel, when it
+-- is sorted by ikey; return 1 on success >*/
+int segypyr_build(segyfile segyf, const char* path, const segy_pyr_opts* o);
+
+/*< open the sidecar path of segyf, NULL if it is missing or does not match segyf (ns,
+-- format, trace count, file size or the stamp of its headers, inode and modification
+-- time) >*/
+segy_pyramid* segypyr_open(const char* path, segyfile segyf);
+
+/*< finest level at which a region of ny x nx cells and nt samples of the full
+-- resolution takes at most maxcells cells of at most maxsamples samples >*/
+int segypyr_lod(const segy_pyramid* p, int ny, int nx, int nt, size_t maxcells, int maxsamples);
+
+/*< read cells [y0, y0 + ny) x [x0, x0 + nx), samples [t0, t0 + nt) of level (1 to
+-- nlevel, in the cells of that level) into out[ny][nx][nt], return 1 on success >*/
+int segypyr_read(const segy_pyramid* p, int level, int y0, int ny, int x0, int nx, int t0,
+                 int nt, float* out);
+
+/*< print the levels >*/
+void segypyr_print(const segy_pyramid* p, FILE* out);
+
+/*< close the sidecar >*/
+void segypyr_free(segy_pyramid* p);
+
+#endif
@@ -0,0 +1,302 @@
+/* One-pass amplitude statistics and QC of a SEGY file */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_qc.h"
+
+#define QC_BLOCK 512         /* samples decoded and reduced at a time */
+#define QC_MAGIC "ESEGYQC2"  /* sidecar magic */
+#define QC_HEADBYTES 64      /* magic, ns, format, ntrace, file size, nbin, qkey, stamp */
+#define QC_TRACEBYTES 20     /* min, max, rms, nbad, flags */
+
+typedef struct {
+  segy_qc* qc;
+  segyfile segyf;
+  int ktrid;
+  uint64_t* hist;  /* SEGYQC_NBIN per thread */
+  float* block;    /* QC_BLOCK per thread */
+} qc_scan;
+
+static inline uint32_t qc_bits(float v) {
+  uint32_t u;
+  memcpy(&u, &v, 4);
+  return u;
+}
+
+static inline float qc_float(uint32_t u) {
+  float v;
+  memcpy(&v, &u, 4);
+  return v;
+}
+
+/* reduce m decoded samples into the running min, max, sum of squares and bad count */
+static void qc_reduce(const float* a, int m, float* mn, float* mx, double* ss,
+                      uint32_t* nbad, uint64_t* hist) {
+  float lo = *mn, hi = *mx;
+  double s = *ss;
+  uint32_t bad = 0;
+#pragma omp simd reduction(min : lo) reduction(max : hi) reduction(+ : s, bad)
+  for (int i = 0; i < m; i++) {
+    float v = a[i];
+    int ok = fabsf(v) <= FLT_MAX;
+    lo = fminf(lo, ok ? v : FLT_MAX);
+    hi = fmaxf(hi, ok ? v : -FLT_MAX);
+    s += ok ? (double)v * v : 0.0;
+    bad += !ok;
+  }
+  for (int i = 0; i < m; i++) {
+    uint32_t b = (qc_bits(a[i]) & 0x7fffffffu) >> 21;
+    if (b < SEGYQC_NBIN)
+      hist[b]++;
+  }
+  *mn = lo;
+  *mx = hi;
+  *ss = s;
+  *nbad += bad;
+}
+
+static void qc_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg,
+                     int tid) {
+  qc_scan* sc = (qc_scan*)arg;
+  segy_qc* qc = sc->qc;
+  int ns = qc->ns, format = sc->segyf->format;
+  int nb = segy_samplebytes(format);
+  uint64_t* hist = sc->hist + (size_t)tid * SEGYQC_NBIN;
+  float* block = sc->block + (size_t)tid * QC_BLOCK;
+  uint64_t t0 = SEGY_TIC(sc->segyf);
+
+  for (size_t j = 0; j < n; j++) {
+    const char* rec = buf + j * stride;
+    segyqc_trace* t = qc->tr + itr0 + j;
+    float mn = FLT_MAX, mx = -FLT_MAX;
+    double ss = 0;
+    uint32_t nbad = 0;
+    int expo = segyquant_exponent(sc->segyf, rec);
+    for (int i0 = 0; i0 < ns; i0 += QC_BLOCK) {
+      int m = ns - i0 < QC_BLOCK ? ns - i0 : QC_BLOCK;
+      segy2trace(rec + SEGY_THNBYTES + (size_t)i0 * nb, block, m, format);
+      segyquant_rescale(block, m, expo);
+      qc_reduce(block, m, &mn, &mx, &ss, &nbad, hist);
+    }
+    int nfin = ns - (int)nbad;
+    t->min = nfin > 0 ? mn : 0;
+    t->max = nfin > 0 ? mx : 0;
+    t->rms = nfin > 0 ? (float)sqrt(ss / nfin) : 0;
+    t->nbad = nbad;
+    t->flags = 0;
+    if (nbad)
+      t->flags |= SEGYQC_NONFINITE;
+    else if (0 == mn && 0 == mx)
+      t->flags |= SEGYQC_ZERO;
+    if (2 == (int16_t)get16(rec + segy_keyoffset(sc->ktrid)))
+      t->flags |= SEGYQC_DEADHEAD;
+  }
+  segy_count_sample(sc->segyf, n, t0);
+}
+
+/* file totals from the per-trace statistics */
+static void qc_totals(segy_qc* qc) {
+  double ss = 0;
+  uint64_t nfin = 0;
+  qc->min = FLT_MAX;
+  qc->max = -FLT_MAX;
+  qc->nbad = qc->nzero = qc->ndead = 0;
+  for (size_t i = 0; i < qc->ntrace; i++) {
+    const segyqc_trace* t = qc->tr + i;
+    uint64_t m = (uint64_t)qc->ns - t->nbad;
+    if (m > 0) {
+      qc->min = t->min < qc->min ? t->min : qc->min;
+      qc->max = t->max > qc->max ? t->max : qc->max;
+      ss += (double)t->rms * t->rms * m;
+      nfin += m;
+    }
+    qc->nbad += t->nbad;
+    qc->nzero += (t->flags & SEGYQC_ZERO) != 0;
+    qc->ndead += (t->flags & SEGYQC_DEADHEAD) != 0;
+  }
+  if (0 == nfin)
+    qc->min = qc->max = 0;
+  qc->rms = nfin > 0 ? sqrt(ss / nfin) : 0;
+}
+
+static segy_qc* qc_alloc(size_t ntrace, int ns) {
+  segy_qc* qc = (segy_qc*)calloc(1, sizeof(segy_qc));
+  if (!qc)
+    errorinfo("malloc failed for QC statistics");
+  qc->ntrace = ntrace;
+  qc->ns = ns;
+  qc->tr = (segyqc_trace*)calloc(ntrace > 0 ? ntrace : 1, sizeof(segyqc_trace));
+  if (!qc->tr)
+    errorinfo("malloc failed for QC trace statistics");
+  return qc;
+}
+
+segy_qc* segyqc_run(segyfile segyf, int nthreads) {
+  segy_qc* qc = qc_alloc(segyf->ntrace, segyf->ns);
+  nthreads = segy_nthreads(nthreads);
+  qc_scan sc;
+  sc.qc = qc;
+  sc.segyf = segyf;
+  sc.ktrid = segykey("trid");
+  sc.hist = (uint64_t*)calloc((size_t)nthreads * SEGYQC_NBIN, sizeof(uint64_t));
+  sc.block = (float*)malloc(sizeof(float) * QC_BLOCK * nthreads);
+  if (!sc.hist || !sc.block)
+    errorinfo("malloc failed for QC buffers");
+
+  size_t nscan = segy_scan_records(segyf, 0, segyf->ntrace, nthreads, qc_batch, &sc);
+  if (nscan != segyf->ntrace) {
+    warninginfo("QC: read %zu of %zu traces", nscan, segyf->ntrace);
+    free(sc.hist);
+    free(sc.block);
+    segyqc_free(qc);
+    return NULL;
+  }
+
+  for (int t = 0; t < nthreads; t++)
+    for (int b = 0; b < SEGYQC_NBIN; b++)
+      qc->hist[b] += sc.hist[(size_t)t * SEGYQC_NBIN + b];
+  free(sc.hist);
+  free(sc.block);
+  qc_totals(qc);
+  return qc;
+}
+
+float segyqc_percentile(const segy_qc* qc, double p) {
+  uint64_t total = 0;
+  for (int b = 0; b < SEGYQC_NBIN; b++)
+    total += qc->hist[b];
+  if (0 == total)
+    return 0;
+  double target = p * (double)total;
+  uint64_t sum = 0;
+  for (int b = 0; b < SEGYQC_NBIN; b++) {
+    sum += qc->hist[b];
+    if ((double)sum >= target && qc->hist[b] > 0)
+      return b + 1 < SEGYQC_NBIN ? qc_float((uint32_t)(b + 1) << 21) : FLT_MAX;
+  }
+  return FLT_MAX;
+}
+
+static uint64_t qc_filesize(segyfile segyf) {
+  int64_t size = segyio_size(segyf->io);
+  return size > 0 ? (uint64_t)size : 0;
+}
+
+int segyqc_save(const segy_qc* qc, segyfile segyf, const char* path) {
+  FILE* fp = fopen(path, "wb");
+  if (!fp) {
+    warninginfo("QC: cannot create %s", path);
+    return 0;
+  }
+  char head[QC_HEADBYTES];
+  memcpy(head, QC_MAGIC, 8);
+  put32(head + 8, (uint32_t)qc->ns);
+  put32(head + 12, (uint32_t)segyf->format);
+  put64(head + 16, (uint64_t)qc->ntrace);
+  put64(head + 24, qc_filesize(segyf));
+  put32(head + 32, SEGYQC_NBIN);
+  put32(head + 36, (uint32_t)segyf->qkey);
+  segy_stamp(segyf, head + 40);
+  int ok = 1 == fwrite(head, QC_HEADBYTES, 1, fp);
+
+  char hist[SEGYQC_NBIN * 8];
+  for (int b = 0; b < SEGYQC_NBIN; b++)
+    put64(hist + b * 8, qc->hist[b]);
+  ok = ok && 1 == fwrite(hist, sizeof(hist), 1, fp);
+
+  char rec[QC_TRACEBYTES * 256];
+  for (size_t i0 = 0; ok && i0 < qc->ntrace; i0 += 256) {
+    size_t m = qc->ntrace - i0 < 256 ? qc->ntrace - i0 : 256;
+    for (size_t j = 0; j < m; j++) {
+      const segyqc_trace* t = qc->tr + i0 + j;
+      char* p = rec + j * QC_TRACEBYTES;
+      put32f(p, t->min);
+      put32f(p + 4, t->max);
+      put32f(p + 8, t->rms);
+      put32(p + 12, t->nbad);
+      put32(p + 16, t->flags);
+    }
+    ok = m == fwrite(rec, QC_TRACEBYTES, m, fp);
+  }
+  if (fclose(fp))
+    ok = 0;
+  if (!ok)
+    warninginfo("QC: error writing %s", path);
+  return ok;
+}
+
+segy_qc* segyqc_load(const char* path, segyfile segyf) {
+  FILE* fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+  char head[QC_HEADBYTES];
+  if (1 != fread(head, QC_HEADBYTES, 1, fp) || memcmp(head, QC_MAGIC, 8) ||
+      (int)get32(head + 8) != segyf->ns || (int)get32(head + 12) != segyf->format ||
+      get64(head + 16) != segyf->ntrace || get64(head + 24) != qc_filesize(segyf) ||
+      get32(head + 32) != SEGYQC_NBIN || (int32_t)get32(head + 36) != segyf->qkey ||
+      !segy_stamp_match(segyf, head + 40)) {
+    fclose(fp);
+    return NULL;
+  }
+
+  segy_qc* qc = qc_alloc(segyf->ntrace, segyf->ns);
+  char hist[SEGYQC_NBIN * 8];
+  int ok = 1 == fread(hist, sizeof(hist), 1, fp);
+  for (int b = 0; ok && b < SEGYQC_NBIN; b++)
+    qc->hist[b] = get64(hist + b * 8);
+
+  char rec[QC_TRACEBYTES * 256];
+  for (size_t i0 = 0; ok && i0 < qc->ntrace; i0 += 256) {
+    size_t m = qc->ntrace - i0 < 256 ? qc->ntrace - i0 : 256;
+    ok = m == fread(rec, QC_TRACEBYTES, m, fp);
+    for (size_t j = 0; ok && j < m; j++) {
+      segyqc_trace* t = qc->tr + i0 + j;
+      const char* p = rec + j * QC_TRACEBYTES;
+      t->min = get32f(p);
+      t->max = get32f(p + 4);
+      t->rms = get32f(p + 8);
+      t->nbad = get32(p + 12);
+      t->flags = get32(p + 16);
+    }
+  }
+  fclose(fp);
+  if (!ok) {
+    segyqc_free(qc);
+    return NULL;
+  }
+  qc_totals(qc);
+  return qc;
+}
+
+void segyqc_print(const segy_qc* qc, FILE* out) {
+  fprintf(out, "traces           %zu x %d samples\n", qc->ntrace, qc->ns);
+  fprintf(out, "amplitude        min %g  max %g  rms %g\n", qc->min, qc->max, qc->rms);
+  fprintf(out, "|amplitude|      p50 %g  p99 %g  p99.9 %g\n", segyqc_percentile(qc, 0.5),
+          segyqc_percentile(qc, 0.99), segyqc_percentile(qc, 0.999));
+  fprintf(out, "zero traces      %zu\n", qc->nzero);
+  fprintf(out, "dead (trid 2)    %zu\n", qc->ndead);
+  fprintf(out, "NaN/Inf samples  %llu\n", (unsigned long long)qc->nbad);
+}
+
+void segyqc_free(segy_qc* qc) {
+  if (qc) {
+    free(qc->tr);
+    free(qc);
+  }
+}
@@ -0,0 +1,64 @@
+/* One-pass amplitude statistics and QC of a SEGY file */
+#ifndef _segy_qc_h
+#define _segy_qc_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "segy.h"
+
+/* |amplitude| histogram bins, 4 bins per power of two over the float range */
+#define SEGYQC_NBIN 1020
+
+enum {
+  SEGYQC_ZERO = 1,      /* all samples are zero */
+  SEGYQC_DEADHEAD = 2,  /* trace identification code trid is 2 (dead) */
+  SEGYQC_NONFINITE = 4, /* some samples are NaN or Inf */
+};
+
+/** statistics of one trace, NaN and Inf samples are left out of min, max and rms */
+typedef struct {
+  float min;
+  float max;
+  float rms;
+  uint32_t nbad;   // NaN and Inf samples
+  uint32_t flags;  // SEGYQC_* bits
+} segyqc_trace;
+
+/** statistics of every trace and of the whole file */
+typedef struct {
+  size_t ntrace;
+  int ns;
+  segyqc_trace* tr;             // tr[ntrace]
+  uint64_t hist[SEGYQC_NBIN];   // finite |amplitude|, bin b starts at the float with bits b << 21
+  float min;
+  float max;
+  double rms;
+  uint64_t nbad;   // NaN and Inf samples of all traces
+  size_t nzero;    // traces with SEGYQC_ZERO
+  size_t ndead;    // traces with SEGYQC_DEADHEAD
+} segy_qc;
+
+/*< compute the statistics of all traces in one parallel pass, the samples are
+-- decoded block by block (and rescaled when segyf quantizes, see segyfile_set_quantize)
+-- and reduced without being stored; NULL when a trace cannot be read >*/
+segy_qc* segyqc_run(segyfile segyf, int nthreads);
+
+/*< amplitude below which a fraction p in [0, 1] of the finite samples lie,
+-- accurate to the histogram bin width (about 19%) >*/
+float segyqc_percentile(const segy_qc* qc, double p);
+
+/*< write the statistics to a sidecar file, return 1 on success >*/
+int segyqc_save(const segy_qc* qc, segyfile segyf, const char* path);
+
+/*< read a sidecar written by segyqc_save, return NULL if it is missing or
+-- does not match segyf (ns, format, trace count, file size or the stamp of its
+-- headers, inode and modification time) >*/
+segy_qc* segyqc_load(const char* path, segyfile segyf);
+
+/*< print a QC report >*/
+void segyqc_print(const segy_qc* qc, FILE* out);
+
+/*< free the statistics >*/
+void segyqc_free(segy_qc* qc);
+
+#endif
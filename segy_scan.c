@@ -0,0 +1,146 @@
+/* Batched and parallel header and record scans */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+
+#define SCAN_BATCH_BYTES (4 << 20) /* bytes read per batch of whole records */
+#define SCAN_BATCH_HEADS 4096      /* headers per batch of single header reads */
+#define SCAN_MAX_GAP (32 << 10)    /* larger sample blocks are skipped, not read */
+
+int segy_nthreads(int nthreads) {
+#ifdef _OPENMP
+  return nthreads > 0 ? nthreads : omp_get_max_threads();
+#else
+  (void)nthreads;
+  return 1;
+#endif
+}
+
+/* scan traces [itr0, itr0 + n), whole records when records is set,
+ otherwise headers only */
+static size_t scan_traces(segyfile segyf, size_t itr0, size_t n, int nthreads,
+                          segy_scanfn fn, void* arg, int records) {
+  if (itr0 >= segyf->ntrace)
+    return 0;
+  if (itr0 + n > segyf->ntrace)
+    n = segyf->ntrace - itr0;
+  if (0 == n)
+    return 0;
+
+  nthreads = segy_nthreads(nthreads);
+  int whole = records || segyf->nsegy - SEGY_THNBYTES <= SCAN_MAX_GAP;
+  size_t batch = whole ? SCAN_BATCH_BYTES / segyf->nsegy : SCAN_BATCH_HEADS;
+  if (batch < 1)
+    batch = 1;
+  /* keep every thread busy on small ranges */
+  if (batch * nthreads > n)
+    batch = (n + nthreads - 1) / nthreads;
+  segyio_hint(segyf->io, segy_trace_offset(segyf, itr0),
+              segy_trace_offset(segyf, itr0 + n) - segy_trace_offset(segyf, itr0),
+              SEGY_IO_SEQUENTIAL);
+  size_t stride = whole ? segyf->nsegy : SEGY_THNBYTES;
+  size_t nbatch = (n + batch - 1) / batch;
+  size_t nscan = 0;
+
+#pragma omp parallel num_threads(nthreads) reduction(+ : nscan)
+  {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    char* buf = (char*)malloc(batch * stride);
+    if (!buf)
+      errorinfo("malloc failed for trace scan buffer");
+
+#pragma omp for schedule(dynamic, 1)
+    for (size_t ib = 0; ib < nbatch; ib++) {
+      size_t i0 = itr0 + ib * batch;
+      size_t nb = (ib + 1) * batch > n ? n - ib * batch : batch;
+      size_t ok = nb;
+      if (whole) {
+        /* for a header scan the last record may be followed by nothing,
+         read its header only */
+        size_t nbytes = records ? nb * segyf->nsegy : (nb - 1) * segyf->nsegy + SEGY_THNBYTES;
+        if (!segy_read_at(segyf, buf, nbytes, segy_trace_offset(segyf, i0)))
+          ok = 0;
+      } else {
+        for (size_t j = 0; j < nb; j++) {
+          if (!segy_read_at(segyf, buf + j * SEGY_THNBYTES, SEGY_THNBYTES,
+                            segy_trace_offset(segyf, i0 + j))) {
+            ok = j;
+            break;
+          }
+        }
+      }
+      if (ok > 0) {
+        fn(buf, stride, i0, ok, arg, tid);
+        nscan += ok;
+      }
+    }
+    free(buf);
+  }
+  return nscan;
+}
+
+size_t segy_scan_headers(segyfile segyf, size_t itr0, size_t n, int nthreads,
+                         segy_scanfn fn, void* arg) {
+  return scan_traces(segyf, itr0, n, nthreads, fn, arg, 0);
+}
+
+size_t segy_scan_records(segyfile segyf, size_t itr0, size_t n, int nthreads,
+                         segy_scanfn fn, void* arg) {
+  size_t nscan = scan_traces(segyf, itr0, n, nthreads, fn, arg, 1);
+  segy_count_traces_read(segyf, nscan);
+  return nscan;
+}
+
+/* decode one key of n headers into a contiguous column */
+void segy_decode_column(const char* buf, size_t stride, size_t n, int k, int32_t* out) {
+  const char* p = buf + segy_keyoffset(k);
+  if (2 == segy_keysize(k)) {
+    for (size_t j = 0; j < n; j++)
+      out[j] = (int16_t)get16(p + j * stride);
+  } else {
+    for (size_t j = 0; j < n; j++)
+      out[j] = (int32_t)get32(p + j * stride);
+  }
+}
+
+/* encode n values into key k of n headers at stride, values out of the key's
+ range are clamped; return the number clamped */
+size_t segy_encode_column(char* buf, size_t stride, size_t n, int k, const int64_t* in) {
+  char* p = buf + segy_keyoffset(k);
+  int64_t lo = 2 == segy_keysize(k) ? INT16_MIN : INT32_MIN;
+  int64_t hi = 2 == segy_keysize(k) ? INT16_MAX : INT32_MAX;
+  size_t nclamp = 0;
+  for (size_t j = 0; j < n; j++) {
+    int64_t v = in[j];
+    if (v < lo || v > hi) {
+      v = v < lo ? lo : hi;
+      nclamp++;
+    }
+    if (2 == segy_keysize(k))
+      put16(p + j * stride, (uint16_t)(int16_t)v);
+    else
+      put32(p + j * stride, (uint32_t)(int32_t)v);
+  }
+  return nclamp;
+}
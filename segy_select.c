@@ -0,0 +1,105 @@
+/* Trace selection by header predicates */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_expr.h"
+#include "segy_internal.h"
+#include "segy_select.h"
+
+typedef struct {
+  const segy_expr* e;
+  uint64_t* bitmap;
+} select_scan;
+
+static void select_batch(const char* buf, size_t stride, size_t itr0, size_t n,
+                         void* arg, int tid) {
+  select_scan* sc = (select_scan*)arg;
+  int64_t* val = (int64_t*)malloc(sizeof(int64_t) * n);
+  (void)tid;
+  if (!val)
+    errorinfo("malloc failed for selection batch");
+  segyexpr_eval_headers(sc->e, buf, stride, n, val);
+
+  /* gather the bits of a word locally, batches may share their edge words */
+  size_t j = 0;
+  while (j < n) {
+    size_t itr = itr0 + j;
+    size_t w = itr / 64;
+    size_t m = 64 - itr % 64;
+    if (m > n - j)
+      m = n - j;
+    uint64_t bits = 0;
+    for (size_t b = 0; b < m; b++)
+      bits |= (uint64_t)(val[j + b] != 0) << ((itr + b) % 64);
+    if (bits)
+      __atomic_fetch_or(sc->bitmap + w, bits, __ATOMIC_RELAXED);
+    j += m;
+  }
+  free(val);
+}
+
+segy_selection* segyselect_expr(segyfile segyf, const segy_expr* e, int nthreads) {
+  segy_selection* sel = (segy_selection*)calloc(1, sizeof(segy_selection));
+  if (!sel)
+    errorinfo("malloc failed for selection");
+  size_t nword = (segyf->ntrace + 63) / 64;
+  sel->ntrace = segyf->ntrace;
+  sel->bitmap = (uint64_t*)calloc(nword > 0 ? nword : 1, sizeof(uint64_t));
+  if (!sel->bitmap)
+    errorinfo("malloc failed for selection bitmap");
+
+  select_scan sc = {e, sel->bitmap};
+  size_t nscan = segy_scan_headers(segyf, 0, segyf->ntrace, nthreads, select_batch, &sc);
+  if (nscan != segyf->ntrace)
+    warninginfo("selection: scanned %zu of %zu headers", nscan, segyf->ntrace);
+
+  for (size_t w = 0; w < nword; w++)
+    sel->n += (size_t)__builtin_popcountll(sel->bitmap[w]);
+  sel->idx = (size_t*)malloc(sizeof(size_t) * (sel->n > 0 ? sel->n : 1));
+  if (!sel->idx)
+    errorinfo("malloc failed for selection index");
+  size_t k = 0;
+  for (size_t w = 0; w < nword; w++) {
+    uint64_t bits = sel->bitmap[w];
+    while (bits) {
+      sel->idx[k++] = w * 64 + (size_t)__builtin_ctzll(bits);
+      bits &= bits - 1;
+    }
+  }
+  return sel;
+}
+
+segy_selection* segyselect(segyfile segyf, const char* expr, int nthreads) {
+  segy_expr* e = segyexpr_parse(expr);
+  if (!e)
+    return NULL;
+  segy_selection* sel = segyselect_expr(segyf, e, nthreads);
+  segyexpr_free(e);
+  return sel;
+}
+
+int segyselect_has(const segy_selection* sel, size_t itrace) {
+  if (itrace >= sel->ntrace)
+    return 0;
+  return (int)((sel->bitmap[itrace / 64] >> (itrace % 64)) & 1);
+}
+
+void segyselect_free(segy_selection* sel) {
+  if (sel) {
+    free(sel->idx);
+    free(sel->bitmap);
+    free(sel);
+  }
+}
@@ -0,0 +1,30 @@
+/* Trace selection by header predicates */
+#ifndef _segy_select_h
+#define _segy_select_h
+
+#include <stdint.h>
+#include "segy.h"
+#include "segy_expr.h"
+
+/** traces of a file that satisfy a predicate */
+typedef struct {
+  size_t ntrace;     // traces scanned (the whole file)
+  size_t n;          // selected traces
+  size_t* idx;       // ascending indexes of the selected traces [n]
+  uint64_t* bitmap;  // bit i of word i/64 set if trace i is selected
+} segy_selection;
+
+/*< select the traces where the expression is not zero, e.g. "cdp>=100 && cdp<200"
+-- with a header-only scan, return NULL if the expression does not compile >*/
+segy_selection* segyselect(segyfile segyf, const char* expr, int nthreads);
+
+/*< same as segyselect with a compiled expression >*/
+segy_selection* segyselect_expr(segyfile segyf, const segy_expr* e, int nthreads);
+
+/*< 1 if trace itrace is selected >*/
+int segyselect_has(const segy_selection* sel, size_t itrace);
+
+/*< free the selection >*/
+void segyselect_free(segy_selection* sel);
+
+#endif
@@ -0,0 +1,348 @@
+/* Out-of-core sort of traces by header keys */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_sort.h"
+
+/* up to four 32 bit keys packed so that unsigned order is the sort order,
+ the trace index breaks ties, which makes the sort stable */
+typedef struct {
+  uint64_t hi, lo;
+  uint64_t idx;
+} sort_entry;
+
+static inline int entry_less(const sort_entry* a, const sort_entry* b) {
+  if (a->hi != b->hi)
+    return a->hi < b->hi;
+  if (a->lo != b->lo)
+    return a->lo < b->lo;
+  return a->idx < b->idx;
+}
+
+static int entry_cmp(const void* pa, const void* pb) {
+  const sort_entry* a = (const sort_entry*)pa;
+  const sort_entry* b = (const sort_entry*)pb;
+  return entry_less(a, b) ? -1 : (entry_less(b, a) ? 1 : 0);
+}
+
+void segysort_default(segysort_opt* opt) {
+  memset(opt, 0, sizeof(*opt));
+  for (int i = 0; i < SEGYSORT_MAXKEY; i++)
+    opt->order[i] = 1;
+  opt->membudget = (size_t)1 << 30;
+  opt->nthreads = 0;
+  opt->tmpdir = NULL;
+}
+
+void segysort_addkey(segysort_opt* opt, const char* key, int order) {
+  if (opt->nkey >= SEGYSORT_MAXKEY)
+    errorinfo("segysort: at most %d keys", SEGYSORT_MAXKEY);
+  opt->keys[opt->nkey] = segykey(key);
+  opt->order[opt->nkey] = order < 0 ? -1 : 1;
+  opt->nkey++;
+}
+
+/* key table scan of one chunk of traces */
+typedef struct {
+  const segysort_opt* opt;
+  sort_entry* entries; /* entries of traces chunk0.. */
+  size_t chunk0;
+} sort_scan;
+
+static void sort_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg,
+                       int tid) {
+  sort_scan* sc = (sort_scan*)arg;
+  const segysort_opt* opt = sc->opt;
+  sort_entry* e = sc->entries + (itr0 - sc->chunk0);
+  int32_t* col = (int32_t*)malloc(sizeof(int32_t) * n);
+  (void)tid;
+  if (!col)
+    errorinfo("malloc failed for sort keys");
+
+  for (size_t j = 0; j < n; j++) {
+    e[j].hi = e[j].lo = 0;
+    e[j].idx = itr0 + j;
+  }
+  for (int ik = 0; ik < opt->nkey; ik++) {
+    segy_decode_column(buf, stride, n, opt->keys[ik], col);
+    int shift = (ik % 2) ? 0 : 32;
+    uint32_t flip = opt->order[ik] < 0 ? 0xFFFFFFFFu : 0u;
+    for (size_t j = 0; j < n; j++) {
+      uint64_t u = (uint64_t)(((uint32_t)col[j] ^ 0x80000000u) ^ flip) << shift;
+      if (ik < 2)
+        e[j].hi |= u;
+      else
+        e[j].lo |= u;
+    }
+  }
+  free(col);
+}
+
+/* a sorted run, in memory or in a temporary file */
+typedef struct {
+  sort_entry* buf;
+  size_t pos, n; /* buffered entries */
+  FILE* fp;      /* NULL for runs in memory */
+  size_t left;   /* entries still in the file */
+  size_t cap;    /* capacity of buf for file runs */
+} sort_run;
+
+static int run_fill(sort_run* r) {
+  if (r->pos < r->n)
+    return 1;
+  if (!r->fp || 0 == r->left)
+    return 0;
+  size_t m = r->left < r->cap ? r->left : r->cap;
+  if (m != fread(r->buf, sizeof(sort_entry), m, r->fp))
+    errorinfo("segysort: error reading a sorted run");
+  r->pos = 0;
+  r->n = m;
+  r->left -= m;
+  return 1;
+}
+
+/* k-way merge of runs with a binary heap of run indexes */
+typedef struct {
+  sort_run* runs;
+  int* heap;
+  int nheap;
+} sort_merger;
+
+static inline int heap_less(const sort_merger* m, int a, int b) {
+  return entry_less(m->runs[a].buf + m->runs[a].pos, m->runs[b].buf + m->runs[b].pos);
+}
+
+static void heap_down(sort_merger* m, int i) {
+  for (;;) {
+    int l = 2 * i + 1, r = l + 1, s = i;
+    if (l < m->nheap && heap_less(m, m->heap[l], m->heap[s]))
+      s = l;
+    if (r < m->nheap && heap_less(m, m->heap[r], m->heap[s]))
+      s = r;
+    if (s == i)
+      return;
+    int t = m->heap[i];
+    m->heap[i] = m->heap[s];
+    m->heap[s] = t;
+    i = s;
+  }
+}
+
+static void merger_init(sort_merger* m, sort_run* runs, int nrun) {
+  m->runs = runs;
+  m->heap = (int*)malloc(sizeof(int) * (nrun > 0 ? nrun : 1));
+  if (!m->heap)
+    errorinfo("malloc failed for sort merge");
+  m->nheap = 0;
+  for (int i = 0; i < nrun; i++)
+    if (run_fill(runs + i))
+      m->heap[m->nheap++] = i;
+  for (int i = m->nheap / 2 - 1; i >= 0; i--)
+    heap_down(m, i);
+}
+
+/* next entry in sort order, 0 when all runs are exhausted */
+static int merger_next(sort_merger* m, sort_entry* e) {
+  if (0 == m->nheap)
+    return 0;
+  sort_run* r = m->runs + m->heap[0];
+  *e = r->buf[r->pos++];
+  if (!run_fill(r))
+    m->heap[0] = m->heap[--m->nheap];
+  heap_down(m, 0);
+  return 1;
+}
+
+/* sort entries[n] as nparts runs in memory, sorted in parallel */
+static int sort_parts(sort_entry* entries, size_t n, int nthreads, sort_run* parts) {
+  int nparts = nthreads;
+  if ((size_t)nparts > n)
+    nparts = n > 0 ? (int)n : 1;
+  size_t per = (n + nparts - 1) / nparts;
+
+#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+  for (int ip = 0; ip < nparts; ip++) {
+    size_t i0 = ip * per < n ? ip * per : n;
+    size_t i1 = i0 + per < n ? i0 + per : n;
+    qsort(entries + i0, i1 - i0, sizeof(sort_entry), entry_cmp);
+    memset(parts + ip, 0, sizeof(sort_run));
+    parts[ip].buf = entries + i0;
+    parts[ip].n = i1 - i0;
+  }
+  return nparts;
+}
+
+static FILE* sort_tmpfile(const char* dir) {
+  if (!dir)
+    return tmpfile();
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/esegy_sortXXXXXX", dir);
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return NULL;
+  unlink(path);
+  return fdopen(fd, "w+b");
+}
+
+/* copy the records of idx[n] to the output traces [oitr, oitr + n) */
+static size_t sort_copy(segyfile in, segyfile out, const uint64_t* idx, size_t n,
+                        size_t oitr, char* win, int nthreads) {
+  size_t nsegy = in->nsegy;
+  size_t ncopy = 0;
+
+  /* consecutive input traces in consecutive slots are read together */
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 64) reduction(+ : ncopy)
+  for (size_t j = 0; j < n; j++) {
+    if (j > 0 && idx[j] == idx[j - 1] + 1)
+      continue;
+    size_t m = 1;
+    while (j + m < n && idx[j + m] == idx[j + m - 1] + 1)
+      m++;
+    if (segy_read_at(in, win + j * nsegy, m * nsegy, segy_trace_offset(in, idx[j])))
+      ncopy += m;
+  }
+  if (ncopy != n)
+    errorinfo("segysort: error reading input traces");
+  if (!segy_write_at(out, win, n * nsegy, segy_trace_offset(out, oitr)))
+    errorinfo("segysort: error writing output traces");
+  segy_count_traces_read(in, n);
+  segy_count_traces_written(out, n);
+  return n;
+}
+
+size_t segysort(segyfile in, FILE* fp, const segysort_opt* opt) {
+  if (opt->nkey < 1)
+    errorinfo("segysort: no sort key");
+  int nthreads = segy_nthreads(opt->nthreads);
+  size_t ntrace = in->ntrace;
+  size_t nsegy = in->nsegy;
+  size_t half = opt->membudget / 2;
+
+  /* one chunk holds the scanned keys and, when spilling, their merged copy */
+  size_t chunk = half / (2 * sizeof(sort_entry));
+  if (chunk < 4096)
+    chunk = 4096;
+  int inmemory = ntrace * sizeof(sort_entry) <= half || ntrace <= chunk;
+  if (inmemory)
+    chunk = ntrace > 0 ? ntrace : 1;
+
+  sort_entry* entries = (sort_entry*)malloc(sizeof(sort_entry) * chunk);
+  if (!entries)
+    errorinfo("malloc failed for sort key table");
+  sort_run* parts = (sort_run*)malloc(sizeof(sort_run) * nthreads);
+  if (!parts)
+    errorinfo("malloc failed for sort runs");
+
+  sort_run* runs = NULL;
+  int nrun = 0;
+  if (inmemory) {
+    sort_scan sc = {opt, entries, 0};
+    if (ntrace != segy_scan_headers(in, 0, ntrace, nthreads, sort_batch, &sc))
+      errorinfo("segysort: error reading trace headers");
+    nrun = sort_parts(entries, ntrace, nthreads, parts);
+    runs = parts;
+  } else {
+    /* sorted runs of one chunk each, spilled to temporary files */
+    int maxrun = (int)((ntrace + chunk - 1) / chunk);
+    runs = (sort_run*)calloc(maxrun, sizeof(sort_run));
+    sort_entry* merged = (sort_entry*)malloc(sizeof(sort_entry) * chunk);
+    if (!runs || !merged)
+      errorinfo("malloc failed for sort runs");
+    for (size_t c0 = 0; c0 < ntrace; c0 += chunk) {
+      size_t n = ntrace - c0 < chunk ? ntrace - c0 : chunk;
+      sort_scan sc = {opt, entries, c0};
+      if (n != segy_scan_headers(in, c0, n, nthreads, sort_batch, &sc))
+        errorinfo("segysort: error reading trace headers");
+      int np = sort_parts(entries, n, nthreads, parts);
+      sort_merger m;
+      merger_init(&m, parts, np);
+      size_t k = 0;
+      while (merger_next(&m, merged + k))
+        k++;
+      free(m.heap);
+
+      sort_run* r = runs + nrun++;
+      r->fp = sort_tmpfile(opt->tmpdir);
+      if (!r->fp)
+        errorinfo("segysort: cannot create a temporary run file");
+      if (k != fwrite(merged, sizeof(sort_entry), k, r->fp) || fflush(r->fp))
+        errorinfo("segysort: error writing a sorted run");
+      rewind(r->fp);
+      r->left = k;
+    }
+    free(merged);
+    free(entries);
+    /* the run buffers share one chunk of the budget */
+    size_t cap = chunk / nrun > 1024 ? chunk / nrun : 1024;
+    for (int i = 0; i < nrun; i++) {
+      runs[i].cap = cap;
+      runs[i].buf = (sort_entry*)malloc(sizeof(sort_entry) * cap);
+      if (!runs[i].buf)
+        errorinfo("malloc failed for sort run buffer");
+    }
+    entries = NULL;
+  }
+
+  /* headers of the output, then the records in merged order */
+  segyfile out = segyfile_init_write(fp, in->ns, in->dt, in->format, ntrace);
+  memcpy(out->textraw, in->textraw, SEGY_EBCBYTES);
+  memcpy(out->bhraw, in->bhraw, SEGY_BHNBYTES);
+  memcpy(out->bhead, in->bhead, sizeof(int) * SEGY_BHNKEYS);
+  if (segykey("cdp") == opt->keys[0])
+    out->bhead[segybhkey("tsort")] = 2;
+  segywrite_texthead(out, 0, 0);
+  segywrite_binaryhead(out);
+  if (fflush(fp))
+    errorinfo("segysort: error writing headers");
+
+  size_t nwin = half / nsegy > 0 ? half / nsegy : 1;
+  if (nwin > ntrace)
+    nwin = ntrace > 0 ? ntrace : 1;
+  char* win = (char*)malloc(nwin * nsegy);
+  uint64_t* widx = (uint64_t*)malloc(sizeof(uint64_t) * nwin);
+  if (!win || !widx)
+    errorinfo("malloc failed for sort copy window");
+
+  sort_merger m;
+  merger_init(&m, runs, nrun);
+  size_t nout = 0;
+  sort_entry e;
+  for (;;) {
+    size_t n = 0;
+    while (n < nwin && merger_next(&m, &e))
+      widx[n++] = e.idx;
+    if (0 == n)
+      break;
+    nout += sort_copy(in, out, widx, n, nout, win, nthreads);
+  }
+  free(m.heap);
+
+  segy_seek(out, segy_trace_offset(out, nout), SEEK_SET);
+  segyfile_free(out);
+  free(widx);
+  free(win);
+  if (!inmemory) {
+    for (int i = 0; i < nrun; i++) {
+      fclose(runs[i].fp);
+      free(runs[i].buf);
+    }
+    free(runs);
+  }
+  free(parts);
+  free(entries);
+  return nout;
+}
@@ -0,0 +1,32 @@
+/* Out-of-core sort of traces by header keys */
+#ifndef _segy_sort_h
+#define _segy_sort_h
+
+#include <stdio.h>
+#include "segy.h"
+
+#define SEGYSORT_MAXKEY 4 /* most keys of one sort */
+
+/** options of segysort, fill with segysort_default first */
+typedef struct {
+  int nkey;                     /* number of sort keys */
+  int keys[SEGYSORT_MAXKEY];    /* header key indexes, most significant first */
+  int order[SEGYSORT_MAXKEY];   /* 1 ascending, -1 descending */
+  size_t membudget;             /* bytes for the key table and the copy buffer */
+  int nthreads;                 /* threads, 0 means all available */
+  const char* tmpdir;           /* directory of the sorted runs, NULL for tmpfile() */
+} segysort_opt;
+
+/*< default options: no key, ascending, 1 GB budget, all threads >*/
+void segysort_default(segysort_opt* opt);
+
+/*< add a key by name to the options, order 1 ascending or -1 descending >*/
+void segysort_addkey(segysort_opt* opt, const char* key, int order);
+
+/*< write the traces of in to out sorted by the keys, equal keys keep the input order
+-- the records are copied raw, without sample or header conversion,
+-- the key table is sorted in memory when it fits half the budget and merged
+-- from sorted runs on disk otherwise, return the number of traces written >*/
+size_t segysort(segyfile in, FILE* out, const segysort_opt* opt);
+
+#endif
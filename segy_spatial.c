@@ -0,0 +1,514 @@
+/* Grid index of source, receiver or CDP coordinates */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_htab.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_spatial.h"
+
+#define SP_MAGIC "ESEGYSP2"
+#define SP_HEADBYTES 112  /* magic, ns, format, ntrace, file size, grid, stamp */
+#define SP_POINTBYTES 24
+#define SP_PERCELL 8     /* traces per cell when the cell size is picked */
+#define SP_CHUNK 4096    /* entries per read or write of the sidecar */
+
+/* header keys of the x and y coordinates of each SEGY_SPATIAL_* */
+static const char* sp_keys[3][2] = {{"sx", "sy"}, {"gx", "gy"}, {"cdpx", "cdpy"}};
+
+typedef struct {
+  int kx, ky, ks;
+  int32_t** tbuf;  /* per thread, 3 columns of the largest batch */
+  size_t* tcap;
+  segy_spatial_point* pts; /* pts[itr], in trace order until sorted into cells */
+} spatial_scan;
+
+static void spatial_batch(const char* buf, size_t stride, size_t itr0, size_t n, void* arg,
+                          int tid) {
+  spatial_scan* sc = (spatial_scan*)arg;
+  if (sc->tcap[tid] < n) {
+    free(sc->tbuf[tid]);
+    sc->tbuf[tid] = (int32_t*)malloc(sizeof(int32_t) * 3 * n);
+    if (!sc->tbuf[tid])
+      errorinfo("malloc failed for spatial index buffers");
+    sc->tcap[tid] = n;
+  }
+  int32_t* x = sc->tbuf[tid];
+  int32_t* y = x + n;
+  int32_t* s = y + n;
+  segy_decode_column(buf, stride, n, sc->kx, x);
+  segy_decode_column(buf, stride, n, sc->ky, y);
+  segy_decode_column(buf, stride, n, sc->ks, s);
+  for (size_t j = 0; j < n; j++) {
+    double f = segyscalar(s[j]);
+    segy_spatial_point* p = sc->pts + itr0 + j;
+    p->x = x[j] * f;
+    p->y = y[j] * f;
+    p->itr = itr0 + j;
+  }
+}
+
+static segy_spatial* spatial_alloc(size_t ntrace, int nx, int ny) {
+  segy_spatial* sp = (segy_spatial*)calloc(1, sizeof(segy_spatial));
+  if (!sp)
+    errorinfo("malloc failed for spatial index");
+  sp->ntrace = ntrace;
+  sp->nx = nx;
+  sp->ny = ny;
+  sp->start = (uint64_t*)calloc((size_t)nx * ny + 1, sizeof(uint64_t));
+  sp->pts = (segy_spatial_point*)malloc(sizeof(segy_spatial_point) * (ntrace ? ntrace : 1));
+  if (!sp->start || !sp->pts)
+    errorinfo("malloc failed for spatial index");
+  return sp;
+}
+
+static size_t spatial_cell(const segy_spatial* sp, double x, double y) {
+  long ix = (long)((x - sp->x0) / sp->cell);
+  long iy = (long)((y - sp->y0) / sp->cell);
+  ix = ix < 0 ? 0 : ix >= sp->nx ? sp->nx - 1 : ix;
+  iy = iy < 0 ? 0 : iy >= sp->ny ? sp->ny - 1 : iy;
+  return (size_t)ix + (size_t)iy * sp->nx;
+}
+
+/* cell side for about SP_PERCELL points per cell, at most 16 cells per point */
+static double spatial_cellsize(double w, double h, size_t n, double cell) {
+  double ncell = n / SP_PERCELL > 0 ? (double)(n / SP_PERCELL) : 1.;
+  if (cell <= 0)
+    cell = w > 0 && h > 0 ? sqrt(w * h / ncell) : (w > h ? w : h) / ncell;
+  if (!(cell > 0))
+    cell = 1;
+  while ((w / cell + 1) * (h / cell + 1) > 16. * n + 16 || w / cell > 1e9 || h / cell > 1e9)
+    cell *= 2;
+  return cell;
+}
+
+segy_spatial* segyspatial_build(segyfile segyf, int which, double cell, int nthreads) {
+  if (which < SEGY_SPATIAL_SOURCE || which > SEGY_SPATIAL_CDP)
+    errorinfo("spatial index: unknown coordinate pair %d", which);
+  size_t n = segyf->ntrace;
+  segy_spatial_point* pts = (segy_spatial_point*)malloc(sizeof(segy_spatial_point) * (n ? n : 1));
+  if (!pts)
+    errorinfo("malloc failed for spatial index");
+
+  nthreads = segy_nthreads(nthreads);
+  spatial_scan sc;
+  sc.kx = segykey(sp_keys[which][0]);
+  sc.ky = segykey(sp_keys[which][1]);
+  sc.ks = segykey("scalco");
+  sc.tbuf = (int32_t**)calloc(nthreads, sizeof(int32_t*));
+  sc.tcap = (size_t*)calloc(nthreads, sizeof(size_t));
+  if (!sc.tbuf || !sc.tcap)
+    errorinfo("malloc failed for spatial index buffers");
+  sc.pts = pts;
+  size_t nscan = segy_scan_headers(segyf, 0, n, nthreads, spatial_batch, &sc);
+  for (int t = 0; t < nthreads; t++)
+    free(sc.tbuf[t]);
+  free(sc.tbuf);
+  free(sc.tcap);
+  if (nscan != n) {
+    warninginfo("spatial index: read %zu of %zu headers", nscan, n);
+    free(pts);
+    return NULL;
+  }
+
+  double x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  if (n > 0) {
+    x0 = x1 = pts[0].x;
+    y0 = y1 = pts[0].y;
+  }
+#pragma omp parallel for num_threads(nthreads) reduction(min : x0, y0) reduction(max : x1, y1)
+  for (size_t i = 0; i < n; i++) {
+    x0 = pts[i].x < x0 ? pts[i].x : x0;
+    y0 = pts[i].y < y0 ? pts[i].y : y0;
+    x1 = pts[i].x > x1 ? pts[i].x : x1;
+    y1 = pts[i].y > y1 ? pts[i].y : y1;
+  }
+  cell = spatial_cellsize(x1 - x0, y1 - y0, n, cell);
+  segy_spatial* sp = spatial_alloc(n, (int)((x1 - x0) / cell) + 1, (int)((y1 - y0) / cell) + 1);
+  sp->which = which;
+  sp->x0 = x0;
+  sp->y0 = y0;
+  sp->x1 = x1;
+  sp->y1 = y1;
+  sp->cell = cell;
+
+  /* counting sort into cells, stable so every cell stays in trace order */
+  size_t ncell = (size_t)sp->nx * sp->ny;
+  uint64_t* start = sp->start;
+#pragma omp parallel for num_threads(nthreads)
+  for (size_t i = 0; i < n; i++) {
+    size_t c = spatial_cell(sp, pts[i].x, pts[i].y);
+#pragma omp atomic
+    start[c + 1]++;
+  }
+  for (size_t c = 0; c < ncell; c++)
+    start[c + 1] += start[c];
+  uint64_t* fill = (uint64_t*)malloc(sizeof(uint64_t) * (ncell ? ncell : 1));
+  if (!fill)
+    errorinfo("malloc failed for spatial index");
+  memcpy(fill, start, sizeof(uint64_t) * ncell);
+  for (size_t i = 0; i < n; i++)
+    sp->pts[fill[spatial_cell(sp, pts[i].x, pts[i].y)]++] = pts[i];
+  free(fill);
+  free(pts);
+  return sp;
+}
+
+/* growable list of trace indexes */
+typedef struct {
+  size_t n, cap;
+  size_t* v;
+} sp_list;
+
+static void sp_push(sp_list* l, size_t itr) {
+  if (l->n == l->cap) {
+    l->cap = l->cap ? 2 * l->cap : 1024;
+    l->v = (size_t*)realloc(l->v, sizeof(size_t) * l->cap);
+    if (!l->v)
+      errorinfo("malloc failed for spatial query");
+  }
+  l->v[l->n++] = itr;
+}
+
+static int sp_cmp(const void* a, const void* b) {
+  size_t x = *(const size_t*)a, y = *(const size_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+/* sort a query result, through a bitmap of all traces when it is a large part of them */
+static size_t sp_finish(const segy_spatial* sp, sp_list* l, size_t** idx) {
+  if (l->n > sp->ntrace / 32) {
+    size_t nw = (sp->ntrace + 63) / 64;
+    uint64_t* bits = (uint64_t*)calloc(nw ? nw : 1, sizeof(uint64_t));
+    if (!bits)
+      errorinfo("malloc failed for spatial query");
+    for (size_t j = 0; j < l->n; j++)
+      bits[l->v[j] >> 6] |= (uint64_t)1 << (l->v[j] & 63);
+    size_t m = 0;
+    for (size_t w = 0; w < nw; w++)
+      for (uint64_t b = bits[w]; b; b &= b - 1)
+        l->v[m++] = w * 64 + (size_t)__builtin_ctzll(b);
+    free(bits);
+  } else {
+    qsort(l->v, l->n, sizeof(size_t), sp_cmp);
+  }
+  *idx = l->v;
+  return l->n;
+}
+
+/* cells [*c0, *c1] covering the coordinates [a0, a1] along one axis, 0 if none */
+static int sp_span(double o, double cell, int nc, double a0, double a1, int* c0, int* c1) {
+  double f0 = floor((a0 - o) / cell), f1 = floor((a1 - o) / cell);
+  if (f1 < 0 || f0 >= nc || a1 < a0)
+    return 0;
+  *c0 = f0 < 0 ? 0 : (int)f0;
+  *c1 = f1 >= nc ? nc - 1 : (int)f1;
+  return 1;
+}
+
+size_t segyspatial_range(const segy_spatial* sp, double x0, double y0, double x1, double y1,
+                         size_t** idx) {
+  sp_list l = {0, 0, NULL};
+  int cx0, cx1, cy0, cy1;
+  if (sp->ntrace && sp_span(sp->x0, sp->cell, sp->nx, x0, x1, &cx0, &cx1) &&
+      sp_span(sp->y0, sp->cell, sp->ny, y0, y1, &cy0, &cy1)) {
+    for (int iy = cy0; iy <= cy1; iy++)
+      for (int ix = cx0; ix <= cx1; ix++) {
+        size_t c = (size_t)ix + (size_t)iy * sp->nx;
+        for (uint64_t j = sp->start[c]; j < sp->start[c + 1]; j++) {
+          const segy_spatial_point* p = sp->pts + j;
+          if (p->x >= x0 && p->x <= x1 && p->y >= y0 && p->y <= y1)
+            sp_push(&l, p->itr);
+        }
+      }
+  }
+  return sp_finish(sp, &l, idx);
+}
+
+/* even-odd rule */
+static int sp_inside(const double* xy, int nvert, double x, double y) {
+  int in = 0;
+  for (int i = 0, j = nvert - 1; i < nvert; j = i++) {
+    double xi = xy[2 * i], yi = xy[2 * i + 1], xj = xy[2 * j], yj = xy[2 * j + 1];
+    if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi)
+      in = !in;
+  }
+  return in;
+}
+
+size_t segyspatial_polygon(const segy_spatial* sp, const double* xy, int nvert,
+                           size_t** idx) {
+  sp_list l = {0, 0, NULL};
+  if (nvert < 3 || 0 == sp->ntrace)
+    return sp_finish(sp, &l, idx);
+  double x0 = xy[0], x1 = xy[0], y0 = xy[1], y1 = xy[1];
+  for (int i = 1; i < nvert; i++) {
+    x0 = fmin(x0, xy[2 * i]);
+    x1 = fmax(x1, xy[2 * i]);
+    y0 = fmin(y0, xy[2 * i + 1]);
+    y1 = fmax(y1, xy[2 * i + 1]);
+  }
+  int cx0, cx1, cy0, cy1;
+  if (sp_span(sp->x0, sp->cell, sp->nx, x0, x1, &cx0, &cx1) &&
+      sp_span(sp->y0, sp->cell, sp->ny, y0, y1, &cy0, &cy1)) {
+    for (int iy = cy0; iy <= cy1; iy++)
+      for (int ix = cx0; ix <= cx1; ix++) {
+        size_t c = (size_t)ix + (size_t)iy * sp->nx;
+        for (uint64_t j = sp->start[c]; j < sp->start[c + 1]; j++) {
+          const segy_spatial_point* p = sp->pts + j;
+          if (sp_inside(xy, nvert, p->x, p->y))
+            sp_push(&l, p->itr);
+        }
+      }
+  }
+  return sp_finish(sp, &l, idx);
+}
+
+/* max-heap of the k best (distance^2, trace) pairs, ties broken by trace */
+typedef struct {
+  int n, k;
+  double* d;
+  size_t* itr;
+} sp_heap;
+
+static int sp_worse(const sp_heap* h, int a, int b) {
+  return h->d[a] > h->d[b] || (h->d[a] == h->d[b] && h->itr[a] > h->itr[b]);
+}
+
+static void sp_swap(sp_heap* h, int a, int b) {
+  double d = h->d[a];
+  size_t t = h->itr[a];
+  h->d[a] = h->d[b];
+  h->itr[a] = h->itr[b];
+  h->d[b] = d;
+  h->itr[b] = t;
+}
+
+static void sp_down(sp_heap* h, int i) {
+  for (;;) {
+    int c = 2 * i + 1;
+    if (c >= h->n)
+      return;
+    if (c + 1 < h->n && sp_worse(h, c + 1, c))
+      c++;
+    if (!sp_worse(h, c, i))
+      return;
+    sp_swap(h, c, i);
+    i = c;
+  }
+}
+
+static void sp_offer(sp_heap* h, double d, size_t itr) {
+  if (h->n < h->k) {
+    int i = h->n++;
+    h->d[i] = d;
+    h->itr[i] = itr;
+    while (i > 0 && sp_worse(h, i, (i - 1) / 2)) {
+      sp_swap(h, i, (i - 1) / 2);
+      i = (i - 1) / 2;
+    }
+  } else if (d < h->d[0] || (d == h->d[0] && itr < h->itr[0])) {
+    h->d[0] = d;
+    h->itr[0] = itr;
+    sp_down(h, 0);
+  }
+}
+
+static void sp_visit(const segy_spatial* sp, sp_heap* h, int ix, int iy, double x, double y) {
+  if (ix < 0 || iy < 0 || ix >= sp->nx || iy >= sp->ny)
+    return;
+  size_t c = (size_t)ix + (size_t)iy * sp->nx;
+  for (uint64_t j = sp->start[c]; j < sp->start[c + 1]; j++) {
+    const segy_spatial_point* p = sp->pts + j;
+    double dx = p->x - x, dy = p->y - y;
+    sp_offer(h, dx * dx + dy * dy, p->itr);
+  }
+}
+
+int segyspatial_nearest(const segy_spatial* sp, double x, double y, int k, size_t* idx,
+                        double* dist) {
+  if (k <= 0 || 0 == sp->ntrace)
+    return 0;
+  sp_heap h;
+  h.n = 0;
+  h.k = k;
+  h.d = (double*)malloc(sizeof(double) * k);
+  h.itr = (size_t*)malloc(sizeof(size_t) * k);
+  if (!h.d || !h.itr)
+    errorinfo("malloc failed for spatial query");
+
+  /* rings of cells around the cell of (x, y), until no unvisited cell can be closer
+     than the k-th point found */
+  size_t c = spatial_cell(sp, x, y);
+  int cx = (int)(c % sp->nx), cy = (int)(c / sp->nx);
+  for (int r = 0;; r++) {
+    if (0 == r) {
+      sp_visit(sp, &h, cx, cy, x, y);
+    } else {
+      for (int ix = cx - r; ix <= cx + r; ix++) {
+        sp_visit(sp, &h, ix, cy - r, x, y);
+        sp_visit(sp, &h, ix, cy + r, x, y);
+      }
+      for (int iy = cy - r + 1; iy <= cy + r - 1; iy++) {
+        sp_visit(sp, &h, cx - r, iy, x, y);
+        sp_visit(sp, &h, cx + r, iy, x, y);
+      }
+    }
+    if (cx - r <= 0 && cy - r <= 0 && cx + r >= sp->nx - 1 && cy + r >= sp->ny - 1)
+      break;
+    double bx0 = sp->x0 + (cx - r) * sp->cell, bx1 = sp->x0 + (cx + r + 1) * sp->cell;
+    double by0 = sp->y0 + (cy - r) * sp->cell, by1 = sp->y0 + (cy + r + 1) * sp->cell;
+    double bound = fmin(fmin(x - bx0, bx1 - x), fmin(y - by0, by1 - y));
+    if (h.n == k && bound > 0 && bound * bound >= h.d[0])
+      break;
+  }
+
+  int m = h.n;
+  for (int i = m - 1; i >= 0; i--) {
+    idx[i] = h.itr[0];
+    if (dist)
+      dist[i] = sqrt(h.d[0]);
+    h.n--;
+    sp_swap(&h, 0, h.n);
+    sp_down(&h, 0);
+  }
+  free(h.d);
+  free(h.itr);
+  return m;
+}
+
+static uint64_t sp_filesize(segyfile segyf) {
+  int64_t size = segyio_size(segyf->io);
+  return size > 0 ? (uint64_t)size : 0;
+}
+
+int segyspatial_save(const segy_spatial* sp, segyfile segyf, const char* path) {
+  FILE* fp = fopen(path, "wb");
+  if (!fp) {
+    warninginfo("spatial index: cannot create %s", path);
+    return 0;
+  }
+  char head[SP_HEADBYTES];
+  memcpy(head, SP_MAGIC, 8);
+  put32(head + 8, (uint32_t)segyf->ns);
+  put32(head + 12, (uint32_t)segyf->format);
+  put64(head + 16, (uint64_t)sp->ntrace);
+  put64(head + 24, sp_filesize(segyf));
+  put32(head + 32, (uint32_t)sp->which);
+  put32(head + 36, (uint32_t)sp->nx);
+  put32(head + 40, (uint32_t)sp->ny);
+  put32(head + 44, 0);
+  put64f(head + 48, sp->x0);
+  put64f(head + 56, sp->y0);
+  put64f(head + 64, sp->x1);
+  put64f(head + 72, sp->y1);
+  put64f(head + 80, sp->cell);
+  segy_stamp(segyf, head + 88);
+  int ok = 1 == fwrite(head, SP_HEADBYTES, 1, fp);
+
+  char* rec = (char*)malloc(SP_CHUNK * SP_POINTBYTES);
+  if (!rec)
+    errorinfo("malloc failed for spatial index");
+  size_t nstart = (size_t)sp->nx * sp->ny + 1;
+  for (size_t i0 = 0; ok && i0 < nstart; i0 += SP_CHUNK) {
+    size_t m = nstart - i0 < SP_CHUNK ? nstart - i0 : SP_CHUNK;
+    for (size_t j = 0; j < m; j++)
+      put64(rec + j * 8, sp->start[i0 + j]);
+    ok = m == fwrite(rec, 8, m, fp);
+  }
+  for (size_t i0 = 0; ok && i0 < sp->ntrace; i0 += SP_CHUNK) {
+    size_t m = sp->ntrace - i0 < SP_CHUNK ? sp->ntrace - i0 : SP_CHUNK;
+    for (size_t j = 0; j < m; j++) {
+      const segy_spatial_point* p = sp->pts + i0 + j;
+      char* q = rec + j * SP_POINTBYTES;
+      put64f(q, p->x);
+      put64f(q + 8, p->y);
+      put64(q + 16, p->itr);
+    }
+    ok = m == fwrite(rec, SP_POINTBYTES, m, fp);
+  }
+  free(rec);
+  if (fclose(fp))
+    ok = 0;
+  if (!ok)
+    warninginfo("spatial index: error writing %s", path);
+  return ok;
+}
+
+segy_spatial* segyspatial_load(const char* path, segyfile segyf) {
+  FILE* fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+  char head[SP_HEADBYTES];
+  if (1 != fread(head, SP_HEADBYTES, 1, fp) || memcmp(head, SP_MAGIC, 8) ||
+      (int)get32(head + 8) != segyf->ns || (int)get32(head + 12) != segyf->format ||
+      get64(head + 16) != segyf->ntrace || get64(head + 24) != sp_filesize(segyf) ||
+      get32(head + 32) > SEGY_SPATIAL_CDP || (int)get32(head + 36) <= 0 ||
+      (int)get32(head + 40) <= 0 || !segy_stamp_match(segyf, head + 88)) {
+    fclose(fp);
+    return NULL;
+  }
+
+  segy_spatial* sp = spatial_alloc(segyf->ntrace, (int)get32(head + 36), (int)get32(head + 40));
+  sp->which = (int)get32(head + 32);
+  sp->x0 = get64f(head + 48);
+  sp->y0 = get64f(head + 56);
+  sp->x1 = get64f(head + 64);
+  sp->y1 = get64f(head + 72);
+  sp->cell = get64f(head + 80);
+
+  char* rec = (char*)malloc(SP_CHUNK * SP_POINTBYTES);
+  if (!rec)
+    errorinfo("malloc failed for spatial index");
+  size_t nstart = (size_t)sp->nx * sp->ny + 1;
+  int ok = 1;
+  for (size_t i0 = 0; ok && i0 < nstart; i0 += SP_CHUNK) {
+    size_t m = nstart - i0 < SP_CHUNK ? nstart - i0 : SP_CHUNK;
+    ok = m == fread(rec, 8, m, fp);
+    for (size_t j = 0; ok && j < m; j++)
+      sp->start[i0 + j] = get64(rec + j * 8);
+  }
+  for (size_t i0 = 0; ok && i0 < sp->ntrace; i0 += SP_CHUNK) {
+    size_t m = sp->ntrace - i0 < SP_CHUNK ? sp->ntrace - i0 : SP_CHUNK;
+    ok = m == fread(rec, SP_POINTBYTES, m, fp);
+    for (size_t j = 0; ok && j < m; j++) {
+      segy_spatial_point* p = sp->pts + i0 + j;
+      const char* q = rec + j * SP_POINTBYTES;
+      p->x = get64f(q);
+      p->y = get64f(q + 8);
+      p->itr = get64(q + 16);
+      ok = p->itr < sp->ntrace;
+    }
+  }
+  free(rec);
+  fclose(fp);
+  ok = ok && 0 == sp->start[0] && sp->start[nstart - 1] == sp->ntrace;
+  for (size_t c = 0; ok && c + 1 < nstart; c++)
+    ok = sp->start[c] <= sp->start[c + 1];
+  if (!ok) {
+    segyspatial_free(sp);
+    return NULL;
+  }
+  return sp;
+}
+
+void segyspatial_free(segy_spatial* sp) {
+  if (sp) {
+    free(sp->start);
+    free(sp->pts);
+    free(sp);
+  }
+}
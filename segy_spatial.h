@@ -0,0 +1,63 @@
+/* Grid index of source, receiver or CDP coordinates */
+#ifndef _segy_spatial_h
+#define _segy_spatial_h
+
+#include <stdint.h>
+#include "segy.h"
+
+enum {
+  SEGY_SPATIAL_SOURCE = 0,   /* sx, sy */
+  SEGY_SPATIAL_RECEIVER = 1, /* gx, gy */
+  SEGY_SPATIAL_CDP = 2,      /* cdpx, cdpy */
+};
+
+/** a trace at its coordinates, scalco applied */
+typedef struct {
+  double x;
+  double y;
+  uint64_t itr;
+} segy_spatial_point;
+
+/** uniform grid over the bounding box, the points of a cell are in trace order */
+typedef struct {
+  int which;      // SEGY_SPATIAL_*
+  size_t ntrace;  // traces indexed
+  double x0, y0;  // lower left corner of the grid
+  double x1, y1;  // upper right corner of the points
+  double cell;    // side of a square cell
+  int nx, ny;     // cells along x and y
+  uint64_t* start;          // points of cell ix + iy * nx are pts[start[c], start[c + 1])
+  segy_spatial_point* pts;  // pts[ntrace]
+} segy_spatial;
+
+/*< index the coordinates of all traces in one parallel header pass, cell is the
+-- cell side (0 picks about 8 traces per cell) >*/
+segy_spatial* segyspatial_build(segyfile segyf, int which, double cell, int nthreads);
+
+/*< traces with x0 <= x <= x1 and y0 <= y <= y1, ascending in *idx (malloc'ed,
+-- free it), ready for segyread_tracelist; return their number >*/
+size_t segyspatial_range(const segy_spatial* sp, double x0, double y0, double x1, double y1,
+                         size_t** idx);
+
+/*< traces inside the polygon xy[2 * nvert] (x, y pairs, even-odd rule), ascending
+-- in *idx like segyspatial_range >*/
+size_t segyspatial_polygon(const segy_spatial* sp, const double* xy, int nvert,
+                           size_t** idx);
+
+/*< the k traces nearest to (x, y), nearest first in idx[k] and their distances in
+-- dist[k] (may be NULL); return the number found, below k for small files >*/
+int segyspatial_nearest(const segy_spatial* sp, double x, double y, int k, size_t* idx,
+                        double* dist);
+
+/*< write the index to a sidecar file, return 1 on success >*/
+int segyspatial_save(const segy_spatial* sp, segyfile segyf, const char* path);
+
+/*< read a sidecar written by segyspatial_save, return NULL if it is missing or
+-- does not match segyf (ns, format, trace count, file size or the stamp of its
+-- headers, inode and modification time) >*/
+segy_spatial* segyspatial_load(const char* path, segyfile segyf);
+
+/*< free the index >*/
+void segyspatial_free(segy_spatial* sp);
+
+#endif
@@ -0,0 +1,488 @@
+/* Splitting one SEGY file into many by a trace header key */
+/*
+  Copyright (C) 2025 China University of Mining and Technology-Beijing
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+*/
+
+/* The calling thread reads large batches of records and appends each run of records
+   with the same output to the buffer of that output. A full buffer becomes a job: the
+   records and their offset in the output, which is known from the traces routed before
+   them, so the writer threads never wait on each other. Writers open outputs through
+   an LRU list that closes the least recently used idle file at maxopen. When the
+   buffered and queued bytes pass the budget the fullest buffer is queued early, and the
+   reader waits while half of the budget is queued. */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segy.h"
+#include "segy_internal.h"
+#include "segy_io.h"
+#include "segy_split.h"
+
+#define SPLIT_BUDGET ((size_t)256 << 20) /* default bytes buffered */
+#define SPLIT_MAXOPEN 64                 /* default open outputs */
+#define SPLIT_CHUNK ((size_t)4 << 20)    /* an output buffer is written at this size */
+#define SPLIT_READ ((size_t)8 << 20)     /* bytes read from the input at a time */
+
+typedef struct split_out {
+  long long value;
+  char* path;
+  size_t ntrace;                /* traces routed, buffered ones included */
+  char* buf;                    /* the reader's buffer */
+  size_t len, cap;
+  segy_io* io;                  /* open file, under the LRU lock */
+  int pin;                      /* writers using io */
+  int created;                  /* the file and its headers exist */
+  struct split_out* prev;       /* LRU list of open files, most recent first */
+  struct split_out* next;
+} split_out;
+
+typedef struct split_job {
+  struct split_job* next;
+  split_out* out;
+  char* buf;
+  size_t len;
+  int64_t off;
+} split_job;
+
+typedef struct {
+  segyfile in;
+  segy_split_opts o;
+  size_t chunk;                 /* whole records */
+  char* head;                   /* bytes of in before the first trace */
+  size_t headlen;
+
+  split_out** outs;
+  size_t nout, capout;
+  split_out** hash;             /* value to output, open addressing */
+  size_t hcap;
+  size_t buffered;              /* bytes allocated for the reader's buffers */
+
+  pthread_mutex_t qlock;
+  pthread_cond_t qwork;         /* a job was queued or the writers should quit */
+  pthread_cond_t qdone;         /* a job was written */
+  split_job* qhead;
+  split_job* qtail;
+  size_t queued;                /* bytes in queued and running jobs */
+  int quit;
+
+  pthread_mutex_t lrulock;
+  split_out lru;                /* sentinel */
+  int nopen;
+
+  uint64_t nwrite, nopens;
+  int failed;
+} split_ctx;
+
+void segysplit_opts_init(segy_split_opts* o, int key) {
+  memset(o, 0, sizeof(*o));
+  o->key = key;
+  o->path = "split_%d.segy";
+}
+
+/* path with the first %d, %5d or %05d of pattern replaced by v */
+static char* split_path(const char* pattern, long long v) {
+  const char* p = pattern;
+  while ((p = strchr(p, '%'))) {
+    const char* q = p + 1;
+    while (*q >= '0' && *q <= '9')
+      q++;
+    if ('d' == *q)
+      break;
+    p = '%' == p[1] ? p + 2 : p + 1;
+  }
+  size_t n = strlen(pattern) + 32;
+  char* s = (char*)malloc(n);
+  if (!s)
+    errorinfo("malloc failed for split output name");
+  if (!p) {
+    snprintf(s, n, "%s.%lld", pattern, v);
+    return s;
+  }
+  char fmt[16];
+  const char* q = strchr(p, 'd');
+  size_t flen = (size_t)(q - p) < sizeof(fmt) - 4 ? (size_t)(q - p) : sizeof(fmt) - 4;
+  memcpy(fmt, p, flen);
+  memcpy(fmt + flen, "lld", 4);
+  int m = snprintf(s, n, "%.*s", (int)(p - pattern), pattern);
+  m += snprintf(s + m, n - m, fmt, v);
+  snprintf(s + m, n - m, "%s", q + 1);
+  return s;
+}
+
+static inline size_t split_slot(long long v, size_t cap) {
+  uint64_t h = (uint64_t)v * 0x9e3779b97f4a7c15ULL;
+  return (size_t)(h >> 17) & (cap - 1);
+}
+
+/* the output of value v, made on first use */
+static split_out* split_find(split_ctx* c, long long v) {
+  size_t i = split_slot(v, c->hcap);
+  while (c->hash[i]) {
+    if (c->hash[i]->value == v)
+      return c->hash[i];
+    i = (i + 1) & (c->hcap - 1);
+  }
+  split_out* o = (split_out*)calloc(1, sizeof(split_out));
+  if (!o)
+    errorinfo("malloc failed for split output");
+  o->value = v;
+  o->path = split_path(c->o.path, v);
+  if (c->nout == c->capout) {
+    c->capout = c->capout ? 2 * c->capout : 256;
+    c->outs = (split_out**)realloc(c->outs, sizeof(split_out*) * c->capout);
+    if (!c->outs)
+      errorinfo("malloc failed for split outputs");
+  }
+  c->outs[c->nout++] = o;
+  c->hash[i] = o;
+
+  if (2 * c->nout > c->hcap) {
+    size_t cap = 2 * c->hcap;
+    split_out** h = (split_out**)calloc(cap, sizeof(split_out*));
+    if (!h)
+      errorinfo("malloc failed for split outputs");
+    for (size_t k = 0; k < c->nout; k++) {
+      size_t j = split_slot(c->outs[k]->value, cap);
+      while (h[j])
+        j = (j + 1) & (cap - 1);
+      h[j] = c->outs[k];
+    }
+    free(c->hash);
+    c->hash = h;
+    c->hcap = cap;
+  }
+  return o;
+}
+
+static void lru_unlink(split_out* o) {
+  o->prev->next = o->next;
+  o->next->prev = o->prev;
+}
+
+static void lru_front(split_ctx* c, split_out* o) {
+  o->prev = &c->lru;
+  o->next = c->lru.next;
+  c->lru.next->prev = o;
+  c->lru.next = o;
+}
+
+/* open o for a writer, closing idle files past maxopen; a new file gets the headers */
+static segy_io* split_acquire(split_ctx* c, split_out* o) {
+  pthread_mutex_lock(&c->lrulock);
+  if (o->io) {
+    lru_unlink(o);
+  } else {
+    for (split_out* v = c->lru.prev; c->nopen >= c->o.maxopen && v != &c->lru;) {
+      split_out* prev = v->prev;
+      if (0 == v->pin) {
+        lru_unlink(v);
+        segyio_close(v->io);
+        v->io = NULL;
+        c->nopen--;
+      }
+      v = prev;
+    }
+    o->io = segyio_open(o->path, o->created ? "r+" : "w");
+    if (o->io) {
+      c->nopen++;
+      c->nopens++;
+      if (!o->created && !segyio_write_at(o->io, c->head, c->headlen, 0)) {
+        warninginfo("split: cannot write the headers of %s", o->path);
+        segyio_close(o->io);
+        o->io = NULL;
+        c->nopen--;
+      } else {
+        o->created = 1;
+      }
+    }
+    if (!o->io) {
+      pthread_mutex_unlock(&c->lrulock);
+      return NULL;
+    }
+  }
+  lru_front(c, o);
+  o->pin++;
+  pthread_mutex_unlock(&c->lrulock);
+  return o->io;
+}
+
+static void split_release(split_ctx* c, split_out* o) {
+  pthread_mutex_lock(&c->lrulock);
+  o->pin--;
+  pthread_mutex_unlock(&c->lrulock);
+}
+
+static void* split_writer(void* arg) {
+  split_ctx* c = (split_ctx*)arg;
+  for (;;) {
+    pthread_mutex_lock(&c->qlock);
+    while (!c->qhead && !c->quit)
+      pthread_cond_wait(&c->qwork, &c->qlock);
+    split_job* j = c->qhead;
+    if (!j) {
+      pthread_mutex_unlock(&c->qlock);
+      break;
+    }
+    c->qhead = j->next;
+    if (!c->qhead)
+      c->qtail = NULL;
+    pthread_mutex_unlock(&c->qlock);
+
+    segy_io* io = split_acquire(c, j->out);
+    int ok = io && segyio_write_at(io, j->buf, j->len, j->off);
+    if (io)
+      split_release(c, j->out);
+    if (!ok)
+      warninginfo("split: cannot write %s", j->out->path);
+
+    pthread_mutex_lock(&c->qlock);
+    c->queued -= j->len;
+    c->nwrite++;
+    c->failed |= !ok;
+    pthread_cond_signal(&c->qdone);
+    pthread_mutex_unlock(&c->qlock);
+    free(j->buf);
+    free(j);
+  }
+  return NULL;
+}
+
+/* hand the buffer of o to the writers */
+static void split_queue(split_ctx* c, split_out* o) {
+  split_job* j = (split_job*)malloc(sizeof(split_job));
+  if (!j)
+    errorinfo("malloc failed for split job");
+  j->next = NULL;
+  j->out = o;
+  j->buf = o->buf;
+  j->len = o->len;
+  j->off = (int64_t)(c->headlen + o->ntrace * c->in->nsegy - o->len);
+  c->buffered -= o->cap;
+  o->buf = NULL;
+  o->len = o->cap = 0;
+
+  pthread_mutex_lock(&c->qlock);
+  if (c->qtail)
+    c->qtail->next = j;
+  else
+    c->qhead = j;
+  c->qtail = j;
+  c->queued += j->len;
+  pthread_cond_signal(&c->qwork);
+  pthread_mutex_unlock(&c->qlock);
+}
+
+/* append n bytes of whole records to the buffer of o */
+static void split_append(split_ctx* c, split_out* o, const char* src, size_t n) {
+  size_t nsegy = c->in->nsegy;
+  while (n > 0) {
+    size_t m = c->chunk - o->len < n ? c->chunk - o->len : n;
+    if (o->len + m > o->cap) {
+      size_t cap = 2 * o->cap > o->len + m ? 2 * o->cap : o->len + m;
+      cap = cap < c->chunk ? cap : c->chunk;
+      o->buf = (char*)realloc(o->buf, cap);
+      if (!o->buf)
+        errorinfo("malloc failed for split buffer");
+      c->buffered += cap - o->cap;
+      o->cap = cap;
+    }
+    memcpy(o->buf + o->len, src, m);
+    o->len += m;
+    o->ntrace += m / nsegy;
+    src += m;
+    n -= m;
+    if (o->len == c->chunk)
+      split_queue(c, o);
+  }
+}
+
+/* keep the buffered and queued bytes in the budget */
+static void split_budget(split_ctx* c) {
+  for (;;) {
+    pthread_mutex_lock(&c->qlock);
+    size_t queued = c->queued;
+    if (c->buffered + queued <= c->o.membudget) {
+      pthread_mutex_unlock(&c->qlock);
+      return;
+    }
+    if (queued >= c->o.membudget / 2 || 0 == c->buffered) {
+      pthread_cond_wait(&c->qdone, &c->qlock);
+      pthread_mutex_unlock(&c->qlock);
+      continue;
+    }
+    pthread_mutex_unlock(&c->qlock);
+    split_out* big = NULL;
+    for (size_t i = 0; i < c->nout; i++)
+      if (c->outs[i]->len > 0 && (!big || c->outs[i]->len > big->len))
+        big = c->outs[i];
+    if (!big)
+      return;
+    split_queue(c, big);
+  }
+}
+
+/* the final binary header (ntrpr) and close every output */
+static void split_finish(split_ctx* c) {
+  int kntr = segybhkey("ntrpr");
+  for (size_t i = 0; i < c->nout; i++) {
+    split_out* o = c->outs[i];
+    if (c->o.width <= 0 && o->created) {
+      char bh[SEGY_BHNBYTES];
+      int bhead[SEGY_BHNKEYS];
+      memcpy(bh, c->head + SEGY_EBCBYTES, SEGY_BHNBYTES);
+      segy2bhead(bh, bhead, SEGY_BHNKEYS);
+      bhead[kntr] = o->ntrace <= 32767 ? (int)o->ntrace : 0;
+      bhead2segy(bh, bhead, SEGY_BHNKEYS);
+      if (!o->io)
+        o->io = segyio_open(o->path, "r+");
+      if (!o->io || !segyio_write_at(o->io, bh, SEGY_BHNBYTES, SEGY_EBCBYTES)) {
+        warninginfo("split: cannot write the binary header of %s", o->path);
+        c->failed = 1;
+      }
+    }
+    segyio_close(o->io);
+    o->io = NULL;
+  }
+}
+
+segy_split* segysplit_run(segyfile in, const segy_split_opts* opts) {
+  split_ctx c;
+  memset(&c, 0, sizeof(c));
+  c.in = in;
+  c.o = *opts;
+  if (c.o.key < 0 || c.o.key >= SEGY_THNKEYS)
+    errorinfo("split: no trace header key %d", c.o.key);
+  if (!c.o.path)
+    c.o.path = "split_%d.segy";
+  if (0 == c.o.membudget)
+    c.o.membudget = SPLIT_BUDGET;
+  int nthreads = segy_nthreads(c.o.nthreads);
+  if (c.o.maxopen <= 0)
+    c.o.maxopen = SPLIT_MAXOPEN;
+  if (c.o.maxopen <= nthreads)
+    c.o.maxopen = nthreads + 1;
+
+  size_t nsegy = in->nsegy;
+  c.chunk = c.o.membudget / 16 < SPLIT_CHUNK ? c.o.membudget / 16 : SPLIT_CHUNK;
+  c.chunk = c.chunk / nsegy > 0 ? c.chunk / nsegy * nsegy : nsegy;
+  c.headlen = (size_t)segy_trace_offset(in, 0);
+  c.head = (char*)malloc(c.headlen);
+  c.hcap = 1024;
+  c.hash = (split_out**)calloc(c.hcap, sizeof(split_out*));
+  if (!c.head || !c.hash)
+    errorinfo("malloc failed for split");
+  if (!segy_read_at(in, c.head, c.headlen, 0))
+    errorinfo("split: cannot read the headers of the input");
+  c.lru.prev = c.lru.next = &c.lru;
+  pthread_mutex_init(&c.qlock, NULL);
+  pthread_cond_init(&c.qwork, NULL);
+  pthread_cond_init(&c.qdone, NULL);
+  pthread_mutex_init(&c.lrulock, NULL);
+
+  pthread_t* th = (pthread_t*)malloc(sizeof(pthread_t) * nthreads);
+  if (!th)
+    errorinfo("malloc failed for split writers");
+  for (int t = 0; t < nthreads; t++)
+    if (pthread_create(th + t, NULL, split_writer, &c))
+      errorinfo("split: cannot start writer %d", t);
+
+  size_t batch = SPLIT_READ / nsegy > 0 ? SPLIT_READ / nsegy : 1;
+  char* buf = (char*)malloc(batch * nsegy);
+  int32_t* val = (int32_t*)malloc(sizeof(int32_t) * batch);
+  long long* cls = (long long*)malloc(sizeof(long long) * batch);
+  if (!buf || !val || !cls)
+    errorinfo("malloc failed for split");
+  segyio_hint(in->io, (int64_t)c.headlen, (int64_t)(in->ntrace * nsegy), SEGY_IO_SEQUENTIAL);
+
+  size_t nrouted = 0;
+  for (size_t itr0 = 0; itr0 < in->ntrace; itr0 += batch) {
+    size_t nb = in->ntrace - itr0 < batch ? in->ntrace - itr0 : batch;
+    pthread_mutex_lock(&c.qlock);
+    int failed = c.failed;
+    pthread_mutex_unlock(&c.qlock);
+    if (failed)
+      break;
+    if (nb != segyread_traces_raw(in, itr0, nb, buf)) {
+      warninginfo("split: cannot read traces %zu to %zu", itr0, itr0 + nb);
+      pthread_mutex_lock(&c.qlock);
+      c.failed = 1;
+      pthread_mutex_unlock(&c.qlock);
+      break;
+    }
+    segy_decode_column(buf, nsegy, nb, c.o.key, val);
+    for (size_t j = 0; j < nb; j++)
+      cls[j] = c.o.width > 0 ? (long long)floor((val[j] - c.o.origin) / c.o.width) : val[j];
+    for (size_t j = 0; j < nb;) {
+      size_t k = 1;
+      while (j + k < nb && cls[j + k] == cls[j])
+        k++;
+      split_append(&c, split_find(&c, cls[j]), buf + j * nsegy, k * nsegy);
+      split_budget(&c);
+      j += k;
+    }
+    nrouted += nb;
+  }
+  free(buf);
+  free(val);
+  free(cls);
+
+  for (size_t i = 0; i < c.nout; i++)
+    if (c.outs[i]->len > 0)
+      split_queue(&c, c.outs[i]);
+  pthread_mutex_lock(&c.qlock);
+  c.quit = 1;
+  pthread_cond_broadcast(&c.qwork);
+  pthread_mutex_unlock(&c.qlock);
+  for (int t = 0; t < nthreads; t++)
+    pthread_join(th[t], NULL);
+  free(th);
+  split_finish(&c);
+
+  segy_split* s = (segy_split*)calloc(1, sizeof(segy_split));
+  if (!s)
+    errorinfo("malloc failed for split");
+  s->nout = c.nout;
+  s->out = (segy_split_output*)malloc(sizeof(segy_split_output) * (c.nout ? c.nout : 1));
+  if (!s->out)
+    errorinfo("malloc failed for split");
+  for (size_t i = 0; i < c.nout; i++) {
+    split_out* o = c.outs[i];
+    s->out[i].value = o->value;
+    s->out[i].ntrace = o->ntrace;
+    s->out[i].path = o->path;
+    free(o->buf);
+    free(o);
+  }
+  s->ntrace = nrouted;
+  s->nwrite = c.nwrite;
+  s->nopen = c.nopens;
+  s->failed = c.failed;
+
+  free(c.outs);
+  free(c.hash);
+  free(c.head);
+  pthread_mutex_destroy(&c.qlock);
+  pthread_cond_destroy(&c.qwork);
+  pthread_cond_destroy(&c.qdone);
+  pthread_mutex_destroy(&c.lrulock);
+  return s;
+}
+
+void segysplit_free(segy_split* s) {
+  if (s) {
+    for (size_t i = 0; i < s->nout; i++)
+      free(s->out[i].path);
+    free(s->out);
+    free(s);
+  }
+}
@@ -0,0 +1,48 @@
+/* Splitting one SEGY file into many by a trace header key */
+#ifndef _segy_split_h
+#define _segy_split_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "segy.h"
+
+/** how traces are routed */
+typedef struct {
+  int key;            // header key deciding the output
+  double width;       // > 0: one output per class floor((value - origin) / width),
+  double origin;      //   0: one output per key value
+  const char* path;   // output names, the first %d (or %05d ...) is the value or class
+  size_t membudget;   // bytes of records buffered for all outputs, 0 means 256MB
+  int maxopen;        // open output files at a time, 0 means 64
+  int nthreads;       // writer threads, 0 for all cores
+} segy_split_opts;
+
+/** one output file */
+typedef struct {
+  long long value;    // key value or class
+  size_t ntrace;      // traces written
+  char* path;
+} segy_split_output;
+
+/** outputs in the order they first got a trace */
+typedef struct {
+  size_t nout;
+  segy_split_output* out;
+  size_t ntrace;      // traces routed
+  uint64_t nwrite;    // write calls
+  uint64_t nopen;     // file opens, above nout when outputs were closed to stay in maxopen
+  int failed;         // an output could not be written
+} segy_split;
+
+/*< default options for key: one output per value named "split_%d.segy" >*/
+void segysplit_opts_init(segy_split_opts* o, int key);
+
+/*< copy every trace record of in, undecoded, to the output of its key; each output
+-- gets the text and binary headers of in, with ntrpr set to its trace count when
+-- there is one output per value; return the outputs >*/
+segy_split* segysplit_run(segyfile in, const segy_split_opts* o);
+
+/*< free the result of segysplit_run >*/
+void segysplit_free(segy_split* s);
+
+#endif